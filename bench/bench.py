@@ -0,0 +1,127 @@
+#!/usr/bin/env python
+# Measures the throughput of the compiler on generated corpora of increasing
+# size (see generate_corpus.py);
+#
+#   bench.py --compiler build/src/Compiler.exe --sizes 100,1000 output_dir
+#
+# Per size the compiler is run twice; once plainly, for the time, memory and
+# AST census of each phase (--stats-file, --ast-stats), and once with
+# --profile-grammar, for the token count and lexing time (the profiled run
+# is slower, so its timings are not used otherwise).
+import os
+import re
+import sys
+import json
+import argparse
+import subprocess
+
+import generate_corpus
+
+def java_files(directory):
+    files = []
+    for root, dirs, names in os.walk(directory):
+        for name in names:
+            if name.endswith(".java"):
+                files.append(os.path.join(root, name))
+    return sorted(files)
+
+def exit_code(status):
+    '''
+    The exit code of a wait status, as subprocess has it; negative for a
+    signal
+    '''
+    return os.WEXITSTATUS(status) if os.WIFEXITED(status) else -os.WTERMSIG(status)
+
+def run(command, output):
+    '''
+    Run command with stdout to output, and return its exit code and peak
+    resident memory in KiB
+    '''
+    process = subprocess.Popen(command, stdout = output, stderr = subprocess.STDOUT)
+    pid, status, usage = os.wait4(process.pid, 0)
+    process.returncode = exit_code(status)
+    return process.returncode, usage.ru_maxrss
+
+def bench_size(args, classes):
+    corpus = os.path.join(args.output, "corpus-%d" % classes)
+    files, lines, size = generate_corpus.generate(corpus, classes, args.members, args.depth, args.imports)
+    inputs = java_files(corpus)
+
+    # The plain run
+    stats_file = os.path.join(args.output, "stats-%d.json" % classes)
+    ast_file = os.path.join(args.output, "ast-%d.json" % classes)
+    with open(os.devnull, "w") as devnull:
+        status, peak_rss_kib = run([args.compiler, "--stats-file", stats_file, "--ast-stats", ast_file] + inputs, devnull)
+    phase_seconds = {}
+    if status == 0:
+        with open(stats_file) as stats_input:
+            phases = json.load(stats_input)["phases"]
+        phase_seconds = dict((phase["phase"], phase["wall_seconds"]) for phase in phases)
+    # A syntax error stops the compile early
+    if "ast-stats" not in phase_seconds:
+        sys.stderr.write("The compiler failed on %s, see --members\n" % corpus)
+        sys.exit(1)
+    with open(ast_file) as ast_input:
+        nodes = sum(kind["count"] for kind in json.load(ast_input)["kinds"])
+
+    # The profiled run
+    profile_file = os.path.join(args.output, "profile-%d.txt" % classes)
+    with open(profile_file, "w") as profile_output:
+        run([args.compiler, "--profile-grammar", "--stop-after", "parse"] + inputs, profile_output)
+    with open(profile_file) as profile_input:
+        match = re.search(r"Tokens \((\d+) in total, ([0-9.]+) ms lexing\)", profile_input.read())
+    tokens = int(match.group(1))
+    lexing_seconds = float(match.group(2)) / 1000
+
+    parse_seconds = phase_seconds["parse"]
+    return {
+        "classes": classes,
+        "files": files,
+        "lines": lines,
+        "bytes": size,
+        "tokens": tokens,
+        "nodes": nodes,
+        "lexing_mb_per_second": size / 1e6 / lexing_seconds if lexing_seconds > 0 else 0,
+        "tokens_per_second": tokens / lexing_seconds if lexing_seconds > 0 else 0,
+        "nodes_per_second": nodes / parse_seconds if parse_seconds > 0 else 0,
+        "peak_rss_kib": peak_rss_kib,
+        "phase_seconds": phase_seconds,
+    }
+
+def print_results(results):
+    phase_names = []
+    for result in results:
+        for name in result["phase_seconds"]:
+            if name not in phase_names:
+                phase_names.append(name)
+
+    header = "%8s %8s %10s %10s %12s %12s %10s" % ("classes", "files", "MB", "lex MB/s", "tokens/s", "nodes/s", "peak MiB")
+    for name in phase_names:
+        header += " %12s" % (name + " s")
+    print(header)
+    for result in results:
+        line = "%8d %8d %10.3f %10.2f %12.0f %12.0f %10.1f" % (result["classes"], result["files"], result["bytes"] / 1e6,
+                                                              result["lexing_mb_per_second"], result["tokens_per_second"],
+                                                              result["nodes_per_second"], result["peak_rss_kib"] / 1024.0)
+        for name in phase_names:
+            line += " %12.4f" % result["phase_seconds"].get(name, 0)
+        print(line)
+
+def main():
+    parser = argparse.ArgumentParser(description = "Benchmark the compiler on generated corpora")
+    parser.add_argument("output", help = "directory for the corpora and results")
+    parser.add_argument("--compiler", default = "build/src/Compiler.exe", help = "the compiler to measure")
+    parser.add_argument("--sizes", default = "10,100,1000", help = "comma seperated numbers of types per corpus")
+    # The grammar does not parse member declarations yet, so only headers by default
+    parser.add_argument("--members", type = int, default = 0, help = "number of fields and methods per class")
+    parser.add_argument("--depth", type = int, default = 3, help = "nesting depth of statements in method bodies")
+    parser.add_argument("--imports", type = int, default = 4, help = "number of imports (fan-out) per type")
+    args = parser.parse_args()
+
+    results = [bench_size(args, int(size)) for size in args.sizes.split(",")]
+    print_results(results)
+    with open(os.path.join(args.output, "results.json"), "w") as output:
+        json.dump(results, output, indent = 2)
+
+if __name__ == "__main__":
+    main()
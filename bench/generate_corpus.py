@@ -0,0 +1,267 @@
+#!/usr/bin/env python
+# Generates a synthetic, but valid, Joos program of configurable scale;
+#
+#   generate_corpus.py --classes N --members M --depth D --imports K output_dir
+#
+# The output only depends upon the arguments (and the seed), such that runs
+# on different machines or revisions measure the same input.
+import os
+import random
+import argparse
+
+# Generated types are spread over packages of this many types each
+types_per_package = 32
+
+class Type:
+    def __init__(self, index, kind, package, field_count):
+        self.index = index
+        # 'interface', 'abstract' or 'final'
+        self.kind = kind
+        self.package = package
+        self.name = ("I" if kind == 'interface' else "C") + str(index)
+        self.extends = None
+        self.implements = []
+        self.imports = []
+        self.on_demand = []
+        self.methods = []
+        self.field_count = field_count
+
+    def qualified_name(self):
+        return self.package + "." + self.name
+
+    def is_class(self):
+        return self.kind != 'interface'
+
+    def interface_methods(self):
+        # The methods of the interfaces this type implements (or extends),
+        # interfaces may be reached more than once
+        methods = []
+        for interface in self.implements:
+            for name in interface.methods + interface.interface_methods():
+                if name not in methods:
+                    methods.append(name)
+        return methods
+
+class Writer:
+    def __init__(self):
+        self.lines = []
+        self.indent = 0
+
+    def line(self, text):
+        self.lines.append("    " * self.indent + text if text else "")
+
+    def open(self, text):
+        self.line(text)
+        self.line("{")
+        self.indent += 1
+
+    def close(self, text = "}"):
+        self.indent -= 1
+        self.line(text)
+
+    def text(self):
+        return "\n".join(self.lines) + "\n"
+
+def plan_types(rng, args):
+    '''
+    Decide the kind, package and supertypes of every type; supertypes always
+    have a lower index, so the hierarchy is acyclic.
+    '''
+    types = []
+    for index in range(args.classes):
+        roll = rng.random()
+        if index > 0 and roll < 0.15:
+            kind = 'interface'
+        elif roll < 0.5:
+            kind = 'abstract'
+        else:
+            kind = 'final'
+        package = "p" + str(index // types_per_package)
+        t = Type(index, kind, package, args.members // 3)
+        interfaces = [s for s in types if s.kind == 'interface']
+        if kind == 'interface':
+            if interfaces and rng.random() < 0.5:
+                t.implements = [rng.choice(interfaces)]
+            t.methods = ["%s_m%d" % (t.name.lower(), n) for n in range(args.members // 4)]
+        else:
+            bases = [s for s in types if s.kind == 'abstract']
+            if bases and rng.random() < 0.7:
+                t.extends = rng.choice(bases)
+            if interfaces and rng.random() < 0.5:
+                t.implements = rng.sample(interfaces, min(len(interfaces), rng.randint(1, 2)))
+        types.append(t)
+
+    # Pick the imports; supertypes in other packages must be imported, the
+    # remaining fan-out goes to random classes, whose static methods we'll call
+    classes = [t for t in types if t.is_class()]
+    for t in types:
+        wanted = [s for s in [t.extends] + t.implements if s is not None]
+        if classes:
+            wanted += [rng.choice(classes) for n in range(args.imports)]
+        for s in wanted:
+            if s is t or s in t.imports:
+                continue
+            if s.package != t.package and rng.random() < 0.2:
+                if s.package not in t.on_demand:
+                    t.on_demand.append(s.package)
+            t.imports.append(s)
+    return types
+
+def expression(rng, t, locals_, depth):
+    '''
+    An int expression over the locals, fields and imported static methods
+    '''
+    roll = rng.random()
+    if depth <= 0 or roll < 0.3:
+        if locals_ and rng.random() < 0.7:
+            return rng.choice(locals_)
+        return str(rng.randint(0, 100))
+    if roll < 0.6:
+        operator = rng.choice(["+", "-", "*"])
+        return "%s %s %s" % (expression(rng, t, locals_, depth - 1), operator, expression(rng, t, locals_, depth - 1))
+    if roll < 0.75:
+        return "(%s)" % expression(rng, t, locals_, depth - 1)
+    callees = [s for s in t.imports if s.is_class()]
+    if roll < 0.9 and callees:
+        return "%s.identity(%s)" % (rng.choice(callees).name, expression(rng, t, locals_, depth - 1))
+    if t.field_count > 0:
+        return "this.f%d" % rng.randint(0, t.field_count - 1)
+    return "0"
+
+def condition(rng, t, locals_, depth):
+    operator = rng.choice(["<", ">", "<=", ">=", "==", "!="])
+    return "%s %s %s" % (expression(rng, t, locals_, depth), operator, expression(rng, t, locals_, depth))
+
+def statements(rng, w, t, locals_, depth, counter):
+    '''
+    A few statements, nesting blocks until depth runs out
+    '''
+    locals_ = list(locals_)
+    for n in range(rng.randint(2, 4)):
+        roll = rng.random()
+        if depth > 0 and roll < 0.2:
+            w.open("if (%s)" % condition(rng, t, locals_, 1))
+            statements(rng, w, t, locals_, depth - 1, counter)
+            w.close()
+            w.open("else")
+            statements(rng, w, t, locals_, depth - 1, counter)
+            w.close()
+        elif depth > 0 and roll < 0.35:
+            counter[0] += 1
+            variable = "i%d" % counter[0]
+            w.open("for (int %s = 0; %s < %d; %s = %s + 1)" % (variable, variable, rng.randint(1, 10), variable, variable))
+            statements(rng, w, t, locals_ + [variable], depth - 1, counter)
+            w.close()
+        elif depth > 0 and roll < 0.45:
+            counter[0] += 1
+            variable = "w%d" % counter[0]
+            w.line("int %s = 0;" % variable)
+            w.open("while (%s < %d)" % (variable, rng.randint(1, 10)))
+            w.line("%s = %s + 1;" % (variable, variable))
+            statements(rng, w, t, locals_ + [variable], depth - 1, counter)
+            w.close()
+            locals_.append(variable)
+        elif locals_ and roll < 0.7:
+            w.line("%s = %s;" % (rng.choice(locals_), expression(rng, t, locals_, 2)))
+        else:
+            counter[0] += 1
+            variable = "v%d" % counter[0]
+            w.line("int %s = %s;" % (variable, expression(rng, t, locals_, 2)))
+            locals_.append(variable)
+
+def method(rng, w, t, name, body_depth, counter):
+    w.open("public int %s(int a, int b)" % name)
+    statements(rng, w, t, ["a", "b"], body_depth, counter)
+    w.line("return %s;" % expression(rng, t, ["a", "b"], 1))
+    w.close()
+
+def generate_type(rng, t, args):
+    w = Writer()
+    w.line("package %s;" % t.package)
+    w.line("")
+    for package in t.on_demand:
+        w.line("import %s.*;" % package)
+    for s in t.imports:
+        if s.package != t.package and s.package not in t.on_demand:
+            w.line("import %s;" % s.qualified_name())
+    w.line("")
+
+    if t.kind == 'interface':
+        header = "public interface %s" % t.name
+        if t.implements:
+            header += " extends " + ", ".join(s.name for s in t.implements)
+        w.open(header)
+        for name in t.methods:
+            w.line("public int %s(int a, int b);" % name)
+        w.close()
+        return w.text()
+
+    header = "public %s class %s" % (t.kind, t.name)
+    if t.extends:
+        header += " extends " + t.extends.name
+    if t.implements:
+        header += " implements " + ", ".join(s.name for s in t.implements)
+    w.open(header)
+
+    # Members; a third fields, the rest methods, besides the constructor,
+    # the static method other classes call, and the interface methods.
+    # Without members only the headers are generated (the grammar does not
+    # parse member declarations yet)
+    counter = [0]
+    if args.members > 0:
+        for n in range(t.field_count):
+            w.line("protected int f%d = %d;" % (n, rng.randint(0, 100)))
+        w.line("")
+        w.open("public %s()" % t.name)
+        w.close()
+        w.line("")
+        w.open("public static int identity(int a)")
+        w.line("return a;")
+        w.close()
+        for n in range(args.members - t.field_count):
+            w.line("")
+            method(rng, w, t, "m%d" % n, args.depth, counter)
+        for name in t.interface_methods():
+            w.line("")
+            method(rng, w, t, name, args.depth, counter)
+    w.close()
+    return w.text()
+
+def generate(output, classes, members, depth, imports, seed = 1):
+    '''
+    Write the corpus to output, and return its number of files, lines and bytes
+    '''
+    args = argparse.Namespace(classes = classes, members = members, depth = depth, imports = imports)
+    rng = random.Random(seed)
+    types = plan_types(rng, args)
+
+    files = 0
+    lines = 0
+    size = 0
+    for t in types:
+        directory = os.path.join(output, t.package)
+        if not os.path.isdir(directory):
+            os.makedirs(directory)
+        contents = generate_type(rng, t, args)
+        with open(os.path.join(directory, t.name + ".java"), "w") as output_file:
+            output_file.write(contents)
+        files += 1
+        lines += contents.count("\n")
+        size += len(contents)
+    return files, lines, size
+
+def main():
+    parser = argparse.ArgumentParser(description = "Generate a synthetic Joos corpus")
+    parser.add_argument("output", help = "directory to write the corpus to")
+    parser.add_argument("--classes", type = int, default = 100, help = "number of types (classes and interfaces)")
+    parser.add_argument("--members", type = int, default = 0, help = "number of fields and methods per class (the grammar does not parse members yet, hence none by default)")
+    parser.add_argument("--depth", type = int, default = 3, help = "nesting depth of statements in method bodies")
+    parser.add_argument("--imports", type = int, default = 4, help = "number of imports (fan-out) per type")
+    parser.add_argument("--seed", type = int, default = 1, help = "seed for the random choices")
+    args = parser.parse_args()
+
+    files, lines, size = generate(args.output, args.classes, args.members, args.depth, args.imports, args.seed)
+    print("Generated %d files, %d lines, %d bytes in %s" % (files, lines, size, args.output))
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,234 @@
+#!/usr/bin/env python
+# Runs the compiler on worst-case inputs of growing size, fits the runtime
+# curve of each phase per input family, and fails if any phase scales worse
+# than O(n log n);
+#
+#   stress.py --compiler build/src/Compiler.exe --scale 0.1 output_dir
+#
+# Lexing is timed by the token counting pass of --profile-grammar. Every
+# input must compile; a compile failing, or a family too fast to fit any
+# phase to, is a failure, as it would otherwise pass without measuring.
+import os
+import re
+import sys
+import json
+import math
+import argparse
+
+import bench
+
+# Points faster than this are mostly noise, and left out of the fit
+minimum_seconds = 0.002
+# Slack on the allowed exponent, for noise
+tolerance = 0.15
+
+def repeat_to(text, size):
+    return (text * (size // len(text) + 1))[:size]
+
+# Generators return the source of a file, or a list of sources; imports must
+# resolve, so those importing other types return the files declaring those
+def large_file(n):
+    # n bytes of imports (of the type itself) and comments
+    chunk = "import big.Big;\n// comment\nimport big.*;\n/* block */\n"
+    return "package big;\n" + chunk * (n // len(chunk)) + "public final class Big {}\n"
+
+def long_identifier(n):
+    # In the package name, as the type name must match the file name
+    return "package " + repeat_to("Identifier", n) + ";\npublic final class Long {}\n"
+
+def many_imports(n):
+    # Every import names a distinct type, spread over packages of 100 each
+    imports = "".join("import p%d.T%d;\n" % (i // 100, i) for i in range(n))
+    imported = ["package p%d;\npublic final class T%d {}\n" % (i // 100, i) for i in range(n)]
+    return ["package many;\n" + imports + "public final class Imports {}\n"] + imported
+
+def block_comment(n):
+    return "/*" + repeat_to(" * comment\n", n) + "*/\npublic final class Comment {}\n"
+
+def qualified_name(n):
+    name = ".".join("q%d" % i for i in range(n))
+    return "package " + name + ";\nimport " + name + ".*;\npublic final class Qualified {}\n"
+
+def interface_chain(n):
+    # Each interface extending the one before, and a class implementing the
+    # last; too dense for interface buckets
+    interfaces = ["package chain;\npublic interface I0 {}\n"]
+    interfaces += ["package chain;\npublic interface I%d extends I%d {}\n" % (i, i - 1) for i in range(1, n)]
+    return ["package chain;\npublic final class Chain implements I%d {}\n" % (n - 1)] + interfaces
+
+# These need the grammar to parse member declarations, which it does not yet;
+# move them to the families once it does
+def long_string(n):
+    return "public final class Strings { String s = \"" + repeat_to("string literal ", n) + "\"; }\n"
+
+def deep_array(n):
+    # Exercises build_array_typeexp
+    return "public final class Arrays { int" + "[]" * n + " a; }\n"
+
+pending_families = [
+    ("long_string",     long_string,     1000 * 1000),
+    ("deep_array",      deep_array,      100 * 1000),
+]
+
+# Name, generator, and largest size; runs are at 1/16th, 1/8th, ... of it
+families = [
+    ("large_file",      large_file,      100 * 1000 * 1000),
+    ("long_identifier", long_identifier, 1000 * 1000),
+    ("many_imports",    many_imports,    100 * 1000),
+    ("block_comment",   block_comment,   100 * 1000 * 1000),
+    ("qualified_name",  qualified_name,  100 * 1000),
+    ("interface_chain", interface_chain, 100 * 1000),
+]
+
+def manifest_quote(argument):
+    '''
+    The argument, double quoted for the manifest, with quotes and backslashes escaped
+    '''
+    return '"' + argument.replace("\\", "\\\\").replace('"', '\\"') + '"'
+
+def run_compile(args, arguments, input_files, output):
+    '''
+    Compile through a batch manifest, as there may be too many input files
+    for a command line; returns the exit code
+    '''
+    manifest = os.path.join(args.output, "manifest")
+    with open(manifest, "w") as programs:
+        programs.write(" ".join(manifest_quote(a) for a in arguments + input_files) + "\n")
+    status, peak_rss_kib = bench.run([args.compiler, "--batch", manifest], output)
+    return status
+
+def measure(args, name, generate, n):
+    '''
+    The seconds spent per phase (and lexing) on the input of size n, and the
+    exit code of the first compile failing, or 0
+    '''
+    # Types must be declared in a file of their own name
+    sources = generate(n)
+    if not isinstance(sources, list):
+        sources = [sources]
+    input_directory = os.path.join(args.output, "%s-%d" % (name, n))
+    if not os.path.isdir(input_directory):
+        os.makedirs(input_directory)
+    input_files = []
+    for source in sources:
+        type_name = re.search(r"(class|interface) (\w+)", source).group(2)
+        input_files.append(os.path.join(input_directory, type_name + ".java"))
+        with open(input_files[-1], "w") as output:
+            output.write(source)
+
+    seconds = {}
+    # The plain run, for the phases
+    stats_file = os.path.join(args.output, "%s-%d.json" % (name, n))
+    if os.path.exists(stats_file):
+        os.remove(stats_file)
+    with open(os.devnull, "w") as devnull:
+        status = run_compile(args, ["--stats-file", stats_file], input_files, devnull)
+    if status == 0:
+        with open(stats_file) as stats_input:
+            for phase in json.load(stats_input)["phases"]:
+                seconds[phase["phase"]] = phase["wall_seconds"]
+    # The profiled run, for lexing
+    profile_file = os.path.join(args.output, "%s-%d.txt" % (name, n))
+    if status == 0:
+        with open(profile_file, "w") as profile_output:
+            status = run_compile(args, ["--profile-grammar", "--stop-after", "parse"], input_files, profile_output)
+    if status == 0:
+        with open(profile_file) as profile_input:
+            match = re.search(r"Tokens \((\d+) in total, ([0-9.]+) ms lexing\)", profile_input.read())
+        if match:
+            seconds["lex"] = float(match.group(2)) / 1000
+
+    for input_file in input_files:
+        os.remove(input_file)
+    os.rmdir(input_directory)
+    return seconds, status
+
+def fit_exponent(points):
+    '''
+    Least squares fit of log(seconds) = k * log(n) + c, returning k
+    '''
+    xs = [math.log(n) for n, t in points]
+    ys = [math.log(t) for n, t in points]
+    mean_x = sum(xs) / len(xs)
+    mean_y = sum(ys) / len(ys)
+    variance = sum((x - mean_x) ** 2 for x in xs)
+    covariance = sum((x - mean_x) * (y - mean_y) for x, y in zip(xs, ys))
+    return covariance / variance
+
+def n_log_n_exponent(smallest, largest):
+    '''
+    The exponent an O(n log n) curve appears to have between the two sizes
+    '''
+    return 1 + math.log(math.log(largest) / math.log(smallest)) / math.log(largest / float(smallest))
+
+def main():
+    parser = argparse.ArgumentParser(description = "Check the compiler scales on pathological inputs")
+    parser.add_argument("output", help = "directory for the inputs and results")
+    parser.add_argument("--compiler", default = "build/src/Compiler.exe", help = "the compiler to measure")
+    parser.add_argument("--scale", type = float, default = 1.0, help = "multiply the input sizes by this")
+    parser.add_argument("--families", default = ",".join(f[0] for f in families), help = "comma seperated families to run")
+    args = parser.parse_args()
+
+    # Paths in the manifest would be relative to the directory it's in
+    args.output = os.path.abspath(args.output)
+    if not os.path.isdir(args.output):
+        os.makedirs(args.output)
+
+    selected = args.families.split(",")
+    results = []
+    failed = False
+    print("%-16s %-14s %10s %10s %10s  %s" % ("family", "phase", "largest n", "exponent", "allowed", "result"))
+    for name, generate, largest in families:
+        if name not in selected:
+            continue
+        largest = max(16, int(largest * args.scale))
+        sizes = [largest // 16, largest // 8, largest // 4, largest // 2, largest]
+        measured = []
+        for n in sizes:
+            seconds, status = measure(args, name, generate, n)
+            if status != 0:
+                verdict = "FAIL, compile of n = %d exited with %d" % (n, status)
+                print("%-16s %-14s %10d %10s %10s  %s" % (name, "-", largest, "-", "-", verdict))
+                results.append({ "family": name, "result": verdict })
+                failed = True
+                break
+            measured.append((n, seconds))
+        if len(measured) < len(sizes):
+            continue
+
+        phases = []
+        for n, seconds in measured:
+            for phase in seconds:
+                if phase not in phases:
+                    phases.append(phase)
+        fitted = False
+        for phase in phases:
+            points = [(n, seconds[phase]) for n, seconds in measured if seconds.get(phase, 0) >= minimum_seconds]
+            result = { "family": name, "phase": phase, "points": [(n, seconds.get(phase)) for n, seconds in measured] }
+            if len(points) < 3:
+                verdict = "too fast to fit"
+                print("%-16s %-14s %10d %10s %10s  %s" % (name, phase, largest, "-", "-", verdict))
+            else:
+                fitted = True
+                exponent = fit_exponent(points)
+                allowed = n_log_n_exponent(points[0][0], points[-1][0]) + tolerance
+                verdict = "ok" if exponent <= allowed else "FAIL, worse than O(n log n)"
+                failed = failed or exponent > allowed
+                result["exponent"] = exponent
+                result["allowed"] = allowed
+                print("%-16s %-14s %10d %10.2f %10.2f  %s" % (name, phase, largest, exponent, allowed, verdict))
+            result["result"] = verdict
+            results.append(result)
+        # A family must measure something; raise the scale, if it's too fast
+        if not fitted:
+            verdict = "FAIL, too few points to fit any phase"
+            print("%-16s %-14s %10d %10s %10s  %s" % (name, "-", largest, "-", "-", verdict))
+            results.append({ "family": name, "result": verdict })
+            failed = True
+
+    with open(os.path.join(args.output, "results.json"), "w") as output:
+        json.dump(results, output, indent = 2)
+    sys.exit(1 if failed else 0)
+
+if __name__ == "__main__":
+    main()
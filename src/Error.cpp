@@ -99,5 +99,30 @@ namespace Error
         : Generic_Error(std::string("Syntax Error"), raw_input_start, raw_input_end, begin)
     {
     }
+
+    Serialization_Error::Serialization_Error(std::string reason)
+        : Generic_Error(std::string("Serialization Error: ").append(reason))
+    {
+    }
+
+    Weeding_Error::Weeding_Error(std::string reason)
+        : Generic_Error(std::string("Weeding Error: ").append(reason))
+    {
+    }
+
+    Environment_Error::Environment_Error(std::string reason)
+        : Generic_Error(std::string("Environment Error: ").append(reason))
+    {
+    }
+
+    Hierarchy_Error::Hierarchy_Error(std::string reason)
+        : Generic_Error(std::string("Hierarchy Error: ").append(reason))
+    {
+    }
+
+    Type_Error::Type_Error(std::string reason)
+        : Generic_Error(std::string("Type Error: ").append(reason))
+    {
+    }
 }
 
@@ -27,6 +27,31 @@ namespace Error
         Syntax_Error();
         Syntax_Error(std::string::iterator raw_input_start, std::string::iterator raw_input_end, std::string::iterator begin);
     };
+
+    struct Serialization_Error : Generic_Error
+    {
+        Serialization_Error(std::string reason);
+    };
+
+    struct Weeding_Error : Generic_Error
+    {
+        Weeding_Error(std::string reason);
+    };
+
+    struct Environment_Error : Generic_Error
+    {
+        Environment_Error(std::string reason);
+    };
+
+    struct Hierarchy_Error : Generic_Error
+    {
+        Hierarchy_Error(std::string reason);
+    };
+
+    struct Type_Error : Generic_Error
+    {
+        Type_Error(std::string reason);
+    };
 }
 
 #endif //_ERROR_HPP
@@ -50,8 +50,8 @@ namespace Lexer
     // lex is the lexer (token definition instance) needed to invoke the lexical analyzer
     void debug_lexer(std::string filename, std::string file_contents)
     {
-        // Instance the lexer
-        Lexer::lexer lex;
+        // Instance the lexer; once per thread, as it's expensive to construct
+        static thread_local Lexer::lexer lex;
         token_collector parse;
 
         // tokenize the given string, the bound functor gets invoked for each of 
@@ -39,7 +39,7 @@ namespace visitor_galore
     }
 
     template<typename T, typename... Fs, typename... variant_types>
-    T run_invoker(algebraic_datatype<variant_types...> variant, visitor_t<T, Fs...> visitor)
+    T run_invoker(algebraic_datatype<variant_types...> const& variant, visitor_t<T, Fs...> visitor)
     {
         return boost::apply_visitor(visitor, variant);
     }
@@ -67,8 +67,8 @@ namespace visitor_galore
 #define Match(X, RETURN_TYPE) \
     [&]() \
     { \
-        auto hidden_variable = X; \
-        return visitor_galore::run_invoker(X, visitor_galore::make_visitor<RETURN_TYPE>([](){}
+        auto const& hidden_variable = X; \
+        return visitor_galore::run_invoker(hidden_variable, visitor_galore::make_visitor<RETURN_TYPE>([](){}
 #define EndMatch \
     )); \
     }();
@@ -19,6 +19,9 @@ namespace qi      = boost::spirit::qi;
 #include "Tokens.hpp"
 #include "ast.hpp"
 #include "ast_helper.hpp"
+#include "ast_names.hpp"
+#include "grammar_profile.hpp"
+#include "weeder.hpp"
 
 namespace boost { namespace spirit { namespace traits {
 
@@ -40,13 +43,13 @@ namespace Parser
     {
         if(vec.size() == 0)
         {
-            return Ast::name_simple { Ast::identifier{str} };
+            return Ast::make_simple_name(Ast::identifier{str});
         }
         else
         {
             std::list<Ast::identifier> qualified_name { begin(vec), end(vec) };
             qualified_name.insert(begin(qualified_name), {str});
-            return Ast::name_qualified{ qualified_name };
+            return Ast::make_qualified_name(qualified_name);
         }
     }
     BOOST_PHOENIX_ADAPT_FUNCTION(Ast::name, build_name_, build_name, 2)
@@ -62,37 +65,53 @@ namespace Parser
             Ast::identifier class_name = qualified_name.back();
             qualified_name.pop_back();
 
-            return { Ast::name_qualified { qualified_name }, class_name };
+            return { Ast::make_qualified_name(qualified_name), class_name };
         } else
         {
-            return { Ast::name_qualified { { } }, { "" } };
+            return { Ast::name_qualified(Ast::root_name_id), { "" } };
         }
     }
     BOOST_PHOENIX_ADAPT_FUNCTION(Ast::import_declaration_single, build_single_import_, build_single_import, 2)
 
     Ast::type_declaration_class build_class_declaration(bool is_final, bool is_abstract, const std::string& name, Ast::namedtype extends, std::list<Ast::namedtype> implements, std::list<Ast::declaration> class_body)
     {
-        return { is_final, is_abstract, Ast::identifier{name}, extends, implements, class_body };
+        Ast::type_declaration_class decl { is_final, is_abstract, Ast::identifier{name}, extends, implements, class_body };
+        // Weed the class and its members, while we have them at hand
+        Weeder::check_class(decl);
+        return decl;
     }
     BOOST_PHOENIX_ADAPT_FUNCTION(Ast::type_declaration_class, build_class_declaration_, build_class_declaration, 6)
 
     Ast::type_declaration_interface build_interface_declaration(std::string name, std::list<Ast::namedtype> extends, std::list<Ast::declaration> interface_body)
     {
-        return { Ast::identifier { name }, extends, interface_body };
+        Ast::type_declaration_interface decl { Ast::identifier { name }, extends, interface_body };
+        // Weed the interface and its members, while we have them at hand
+        Weeder::check_interface(decl);
+        return decl;
     }
     BOOST_PHOENIX_ADAPT_FUNCTION(Ast::type_declaration_interface, build_interface_declaration_, build_interface_declaration, 3)
 
     Ast::namedtype build_class_extends(boost::optional<Ast::namedtype> extends_option)
     {
-        static const Ast::name_qualified default_ { { {"java"}, {"lang"}, {"Object"} } };
+        static const Ast::name_qualified default_ = Ast::make_qualified_name({ {"java"}, {"lang"}, {"Object"} });
         return extends_option? *extends_option : default_;
     }
     BOOST_PHOENIX_ADAPT_FUNCTION(Ast::namedtype, build_class_extends_, build_class_extends, 1)
 
     Ast::type_expression_tarray build_array_typeexp(Ast::type_expression typeexp, unsigned num_brackets)
     {
-        Ast::type_expression_tarray value { typeexp }; // Create the inner-most array
-        return num_brackets <= 1? value : build_array_typeexp(value, num_brackets-1);
+        Ast::type_expression_tarray value; // Create the outer-most array
+        // Build the dimensions top-down, such that no subtree is ever copied,
+        // and such that we do not recurse once per pair of brackets.
+        Ast::type_expression* innermost = &value.type;
+        for(unsigned n = 1; n < num_brackets; n++)
+        {
+            *innermost = Ast::type_expression_tarray();
+            innermost = &boost::get<Ast::type_expression_tarray>(*innermost).type;
+        }
+        // Finally put the element type, inside the inner-most array
+        *innermost = typeexp;
+        return value;
     }
     BOOST_PHOENIX_ADAPT_FUNCTION(Ast::type_expression_tarray, build_array_typeexp_, build_array_typeexp, 2)
 
@@ -102,8 +121,9 @@ namespace Parser
     template <typename Iterator>
         struct java_grammar : qi::grammar<Iterator, Ast::source_file()>
     {
+        // If profile is set, every rule records its counters (see grammar_profile.hpp)
         template <typename TokenDef>
-            java_grammar(TokenDef const& tok)
+            java_grammar(TokenDef const& tok, bool profile = false)
             : java_grammar::base_type(start)
             {
                 start = source_file  > qi::eoi
@@ -220,8 +240,58 @@ namespace Parser
                 name = 
                     (tok.identifier >> *(qi::raw_token(DOT) >> tok.identifier))
                     [ qi::_val = build_name_(qi::_1, qi::_2) ];
+
+                if(profile)
+                {
+                    profile_rule(start, "start");
+                    profile_rule(source_file, "source_file");
+                    profile_rule(optional_package, "optional_package");
+                    profile_rule(package, "package");
+                    profile_rule(imports, "imports");
+                    profile_rule(import_on_demand, "import_on_demand");
+                    profile_rule(import_single, "import_single");
+                    profile_rule(import, "import");
+                    profile_rule(type, "type");
+                    profile_rule(class_type, "class_type");
+                    profile_rule(interface_type, "interface_type");
+                    profile_rule(class_body, "class_body");
+                    profile_rule(interface_body, "interface_body");
+                    profile_rule(class_extends_decl, "class_extends_decl");
+                    profile_rule(implements_decl, "implements_decl");
+                    profile_rule(interface_extends_decl, "interface_extends_decl");
+                    profile_rule(typename_list, "typename_list");
+                    profile_rule(member_decl, "member_decl");
+                    profile_rule(interface_member_declaration, "interface_member_declaration");
+                    profile_rule(implicit_method_declaration, "implicit_method_declaration");
+                    profile_rule(method_declaration, "method_declaration");
+                    profile_rule(constructor_declaration, "constructor_declaration");
+                    profile_rule(field_declaration, "field_declaration");
+                    profile_rule(typeexp, "typeexp");
+                    profile_rule(reference_typeexp, "reference_typeexp");
+                    profile_rule(primitive_typeexp, "primitive_typeexp");
+                    profile_rule(named_typeexp, "named_typeexp");
+                    profile_rule(n_empty_brackets, "n_empty_brackets");
+                    profile_rule(element_type, "element_type");
+                    profile_rule(array_typeexp, "array_typeexp");
+                    profile_rule(empty_brackets, "empty_brackets");
+                    profile_rule(access, "access");
+                    profile_rule(name, "name");
+                }
             }  
 
+        // Name the rule, and attach the profiler to it; rules which are not
+        // defined (yet) are left alone, as the profiler would make them callable
+        template <typename Rule>
+            void profile_rule(Rule& rule, char const* rule_name)
+            {
+                if(!rule.f)
+                {
+                    return;
+                }
+                rule.name(rule_name);
+                qi::debug(rule, Profile::rule_profiler(rule_name));
+            }
+
         qi::rule<Iterator, Ast::source_file()> start;
         qi::rule<Iterator, Ast::source_file()> source_file;
         qi::rule<Iterator, Maybe<Ast::package_declaration>()> optional_package;
@@ -29,3 +29,182 @@ std::string find_enum_type(unsigned value)
             return "";
     }
 }
+
+std::string token_name(unsigned value)
+{
+    switch(value)
+    {
+        case END_OF_FILE:
+            return "END_OF_FILE";
+        case ABSTRACT:
+            return "ABSTRACT";
+        case BOOLEAN:
+            return "BOOLEAN";
+        case BREAK:
+            return "BREAK";
+        case BYTE:
+            return "BYTE";
+        case CASE:
+            return "CASE";
+        case CATCH:
+            return "CATCH";
+        case CHAR:
+            return "CHAR";
+        case CLASS:
+            return "CLASS";
+        case CONST:
+            return "CONST";
+        case CONTINUE:
+            return "CONTINUE";
+        case DEFAULT:
+            return "DEFAULT";
+        case DO:
+            return "DO";
+        case DOUBLE:
+            return "DOUBLE";
+        case ELSE:
+            return "ELSE";
+        case EXTENDS:
+            return "EXTENDS";
+        case FINAL:
+            return "FINAL";
+        case FINALLY:
+            return "FINALLY";
+        case FLOAT:
+            return "FLOAT";
+        case FOR:
+            return "FOR";
+        case GOTO:
+            return "GOTO";
+        case IF:
+            return "IF";
+        case IMPLEMENTS:
+            return "IMPLEMENTS";
+        case IMPORT:
+            return "IMPORT";
+        case INSTANCEOF:
+            return "INSTANCEOF";
+        case INT:
+            return "INT";
+        case INTERFACE:
+            return "INTERFACE";
+        case LONG:
+            return "LONG";
+        case NATIVE:
+            return "NATIVE";
+        case NEW:
+            return "NEW";
+        case PACKAGE:
+            return "PACKAGE";
+        case PRIVATE:
+            return "PRIVATE";
+        case PROTECTED:
+            return "PROTECTED";
+        case PUBLIC:
+            return "PUBLIC";
+        case RETURN:
+            return "RETURN";
+        case SHORT:
+            return "SHORT";
+        case STATIC:
+            return "STATIC";
+        case STRICTFP:
+            return "STRICTFP";
+        case SUPER:
+            return "SUPER";
+        case SWITCH:
+            return "SWITCH";
+        case SYNCHRONIZED:
+            return "SYNCHRONIZED";
+        case THIS:
+            return "THIS";
+        case THROW:
+            return "THROW";
+        case THROWS:
+            return "THROWS";
+        case TRANSIENT:
+            return "TRANSIENT";
+        case TRY:
+            return "TRY";
+        case VOID:
+            return "VOID";
+        case VOLATILE:
+            return "VOLATILE";
+        case WHILE:
+            return "WHILE";
+        case TRUE_CONSTANT:
+            return "TRUE_CONSTANT";
+        case FALSE_CONSTANT:
+            return "FALSE_CONSTANT";
+        case NULL_CONSTANT:
+            return "NULL_CONSTANT";
+        case LEFT_PARENTHESE:
+            return "LEFT_PARENTHESE";
+        case RIGHT_PARENTHESE:
+            return "RIGHT_PARENTHESE";
+        case LEFT_BRACE:
+            return "LEFT_BRACE";
+        case RIGHT_BRACE:
+            return "RIGHT_BRACE";
+        case LEFT_BRACKET:
+            return "LEFT_BRACKET";
+        case RIGHT_BRACKET:
+            return "RIGHT_BRACKET";
+        case SEMI_COLON:
+            return "SEMI_COLON";
+        case COMMA:
+            return "COMMA";
+        case DOT:
+            return "DOT";
+        case ASSIGN:
+            return "ASSIGN";
+        case COMPLEMENT:
+            return "COMPLEMENT";
+        case AND_AND:
+            return "AND_AND";
+        case OR_OR:
+            return "OR_OR";
+        case LT:
+            return "LT";
+        case GT:
+            return "GT";
+        case EQ:
+            return "EQ";
+        case LTEQ:
+            return "LTEQ";
+        case GTEQ:
+            return "GTEQ";
+        case NEQ:
+            return "NEQ";
+        case PLUS:
+            return "PLUS";
+        case MINUS:
+            return "MINUS";
+        case STAR:
+            return "STAR";
+        case DIVISION:
+            return "DIVISION";
+        case AND:
+            return "AND";
+        case OR:
+            return "OR";
+        case XOR:
+            return "XOR";
+        case MOD:
+            return "MOD";
+        case PLUS_PLUS:
+            return "PLUS_PLUS";
+        case MINUS_MINUS:
+            return "MINUS_MINUS";
+        case DECIMAL_LITERAL:
+            return "DECIMAL_LITERAL";
+        case CHAR_LITERAL:
+            return "CHAR_LITERAL";
+        case STRING_LITERAL:
+            return "STRING_LITERAL";
+        case IDENTIFIER:
+            return "IDENTIFIER";
+        default:
+            return find_enum_type(value);
+    }
+}
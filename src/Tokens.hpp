@@ -172,5 +172,7 @@ constexpr TypesStart getOperationType(unsigned value)
 #include <string>
 
 std::string find_enum_type(unsigned value);
+// The name of the token, i.e. "LEFT_BRACE"
+std::string token_name(unsigned value);
 
 #endif //_TOKENS_HPP
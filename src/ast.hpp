@@ -9,6 +9,7 @@
 #include <string>
 #include <list>
 #include <utility>
+#include <cstdint>
 
 #include "Match/algebraic_datatype.hpp"
 
@@ -26,14 +27,25 @@ namespace Ast
         std::string identifier_string;
     };
 
+    // Names are interned into a global table (see ast_names.hpp), such that
+    // equality of names is an integer comparison of their ids, and a name in
+    // the tree is only its id; the components are kept once, in the table.
+    using name_id = std::uint32_t;
+
+    // Whether a name is simple or qualified matters to resolution, hence two
+    // kinds of names; default constructed, both are the empty (root) name
     struct name_simple final
     {
-        identifier name;
+        name_simple() : id(0) {}
+        explicit name_simple(name_id id) : id(id) {}
+        name_id id;
     };
 
     struct name_qualified final
     {
-        std::list<identifier> name;
+        name_qualified() : id(0) {}
+        explicit name_qualified(name_id id) : id(id) {}
+        name_id id;
     };
 
     using name      = algebraic_datatype<name_simple, name_qualified>;
@@ -159,7 +171,21 @@ namespace Ast
         name ambiguous;
     };
 
+    // A simple name resolved to a local variable (or formal parameter), by
+    // its slot in the frame of the method (see ast_locals.hpp)
+    using local_slot = std::uint32_t;
+
+    struct lvalue_local final
+    {
+        identifier name;
+        local_slot slot;
+    };
+
+    // Assignment and increment targets; names, until resolved to locals
+    // (see ast_locals.hpp), or fields
     using lvalue = algebraic_datatype<
+        lvalue_ambiguous_name,
+        lvalue_local,
         algebraic_recursive<lvalue_non_static_field>,
         algebraic_recursive<lvalue_array>>;
 
@@ -220,6 +246,7 @@ namespace Ast
         expression_null,
         expression_this,
         lvalue_ambiguous_name,
+        lvalue_local,
         // Recursive members
         algebraic_recursive<expression_binop>,
         algebraic_recursive<expression_unop>,
@@ -231,20 +258,13 @@ namespace Ast
         algebraic_recursive<expression_parentheses>,
         algebraic_recursive<lvalue_non_static_field>,
         algebraic_recursive<lvalue_array>,
-        algebraic_recursive<expression_binop>,
-        algebraic_recursive<expression_unop>,
-        algebraic_recursive<expression_static_invoke>,
-        algebraic_recursive<expression_non_static_invoke>,
-        algebraic_recursive<expression_simple_invoke>,
-        algebraic_recursive<expression_ambiguous_invoke>,
         algebraic_recursive<expression_new>,
         algebraic_recursive<expression_new_array>,
         algebraic_recursive<expression_lvalue>,
         algebraic_recursive<expression_assignment>,
         algebraic_recursive<expression_incdec>,
         algebraic_recursive<expression_cast>,
-        algebraic_recursive<expression_ambiguous_cast>,
-        algebraic_recursive<expression_instance_of>
+        algebraic_recursive<expression_ambiguous_cast>
         >;
 
     struct lvalue_non_static_field final
@@ -475,10 +495,19 @@ namespace Ast
         access_public, 
         access_protected>;
 
-    using formal_parameter = std::pair<expression, identifier>;
+    using formal_parameter = std::pair<type_expression, identifier>;
 
+    // The owners of initializers and bodies tear them down iteratively (see
+    // dismantle in ast_traversal.hpp), as they may be nested arbitrarily deep
     struct field_declaration
     {
+        field_declaration() = default;
+        field_declaration(field_declaration const&) = default;
+        field_declaration(field_declaration&&) = default;
+        field_declaration& operator=(field_declaration const&) = default;
+        field_declaration& operator=(field_declaration&&) = default;
+        ~field_declaration();
+
         access access_type;
         bool is_static;
         bool is_final;
@@ -489,6 +518,13 @@ namespace Ast
 
     struct method_declaration
     {
+        method_declaration() = default;
+        method_declaration(method_declaration const&) = default;
+        method_declaration(method_declaration&&) = default;
+        method_declaration& operator=(method_declaration const&) = default;
+        method_declaration& operator=(method_declaration&&) = default;
+        ~method_declaration();
+
         access access_type;
         bool is_static;
         bool is_final;
@@ -502,6 +538,13 @@ namespace Ast
 
     struct constructor_declaration
     {
+        constructor_declaration() = default;
+        constructor_declaration(constructor_declaration const&) = default;
+        constructor_declaration(constructor_declaration&&) = default;
+        constructor_declaration& operator=(constructor_declaration const&) = default;
+        constructor_declaration& operator=(constructor_declaration&&) = default;
+        ~constructor_declaration();
+
         access access_type;
         identifier name;
         std::list<formal_parameter> formal_parameters;
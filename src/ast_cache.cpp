@@ -0,0 +1,148 @@
+#include "ast_cache.hpp"
+
+#include "ast_serialize.hpp"
+#include "Error.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// The build of the compiler (set by the build from the grammar and ast
+// sources), as a changed grammar may parse the same contents differently
+#ifndef JOOS_BUILD_ID
+#define JOOS_BUILD_ID __DATE__ " " __TIME__
+#endif
+
+namespace Ast
+{
+    namespace
+    {
+        // 64-bit FNV-1a
+        std::uint64_t fnv1a(std::string const& data, std::uint64_t hash = 14695981039346656037ULL)
+        {
+            for(char c : data)
+            {
+                hash ^= static_cast<unsigned char>(c);
+                hash *= 1099511628211ULL;
+            }
+            return hash;
+        }
+
+        std::string to_hex(std::uint64_t value)
+        {
+            const char digits[] = "0123456789abcdef";
+            std::string output(16, '0');
+            for(unsigned x = 0; x < 16; x++)
+            {
+                output[15 - x] = digits[value & 0xF];
+                value >>= 4;
+            }
+            return output;
+        }
+
+        // Closes a file descriptor when leaving scope
+        struct file_descriptor
+        {
+            int fd;
+
+            ~file_descriptor()
+            {
+                if(fd >= 0)
+                {
+                    close(fd);
+                }
+            }
+        };
+    }
+
+    std::uint64_t content_hash(std::string const& file_contents)
+    {
+        return fnv1a(file_contents);
+    }
+
+    parse_cache::parse_cache(std::string directory)
+        : directory(std::move(directory))
+    {
+        // It's okay if it already exists; if it can't be created, loads and
+        // stores will simply fail
+        mkdir(this->directory.c_str(), 0777);
+    }
+
+    std::string parse_cache::entry_path(std::string const& file_contents) const
+    {
+        // Key on the format version and the build as well, such that entries
+        // written by other versions of the compiler are never read
+        std::uint64_t hash = fnv1a(std::to_string(serialization_version));
+        hash = fnv1a(JOOS_BUILD_ID, hash);
+        hash = fnv1a(file_contents, hash);
+        // Include the size, to make collisions even less likely
+        return directory + "/" + to_hex(hash) + "-" + to_hex(file_contents.size()) + ".jast";
+    }
+
+    Maybe<source_file> parse_cache::load(std::string const& filename, std::string const& file_contents) const
+    {
+        file_descriptor file{ open(entry_path(file_contents).c_str(), O_RDONLY) };
+        if(file.fd < 0)
+        {
+            return Maybe<source_file>();
+        }
+        struct stat info;
+        if(fstat(file.fd, &info) != 0 || info.st_size == 0)
+        {
+            return Maybe<source_file>();
+        }
+        // Map the entry, and read the ast directly from the mapping
+        std::size_t size = static_cast<std::size_t>(info.st_size);
+        void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file.fd, 0);
+        if(mapping == MAP_FAILED)
+        {
+            return Maybe<source_file>();
+        }
+        Maybe<source_file> sf;
+        try
+        {
+            sf = deserialize(static_cast<char const*>(mapping), size);
+        }
+        catch(Error::Serialization_Error&)
+        {
+            // A corrupt entry is a cache miss; it'll be overwritten by store
+        }
+        munmap(mapping, size);
+        // The entry may have been saved for a copy of the file
+        if(sf)
+        {
+            sf->name = filename;
+        }
+        return sf;
+    }
+
+    void parse_cache::store(std::string const& file_contents, source_file const& sf) const
+    {
+        std::string data;
+        serialize(sf, data);
+        // Write to a temporary file, and rename it into place, such that
+        // concurrent compilers never see a partially written entry; the
+        // temporary is unique per process, and per store within it, as
+        // threads may store the same contents at once
+        static std::atomic<unsigned long> stores(0);
+        std::string path = entry_path(file_contents);
+        std::string temporary = path + ".tmp" + std::to_string(getpid()) + "." + std::to_string(stores++);
+        std::FILE* file = std::fopen(temporary.c_str(), "wb");
+        if(file == nullptr)
+        {
+            return;
+        }
+        bool written = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+        written = (std::fclose(file) == 0) && written;
+        if(written == false || std::rename(temporary.c_str(), path.c_str()) != 0)
+        {
+            std::remove(temporary.c_str());
+        }
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef _COMPILER_AST_CACHE_HPP
+#define _COMPILER_AST_CACHE_HPP
+
+#include "ast.hpp"
+
+#include <cstdint>
+#include <string>
+
+/************************************************************************/
+/** {2 On-disk cache of parsed source files}                            */
+/************************************************************************/
+// Entries are keyed by a hash of the file contents (and the serialization
+// version and the build of the compiler), such that unchanged files skip
+// lexing and parsing entirely, and are instead memory mapped and deserialized.
+// As equal contents share an entry, the name of the file is not taken from it.
+namespace Ast
+{
+    /** A 64-bit hash of file contents (FNV-1a), used to detect changed files */
+    std::uint64_t content_hash(std::string const& file_contents);
+
+    class parse_cache
+    {
+        public:
+            // Creates the directory, if it does not exist
+            explicit parse_cache(std::string directory);
+
+            // The cached ast for the contents, if any (corrupt entries are ignored),
+            // named filename
+            Maybe<source_file> load(std::string const& filename, std::string const& file_contents) const;
+            // Save the ast for the contents; failing to do so is not an error
+            void store(std::string const& file_contents, source_file const& sf) const;
+
+        private:
+            std::string entry_path(std::string const& file_contents) const;
+
+            std::string directory;
+    };
+}
+
+#endif //_COMPILER_AST_CACHE_HPP
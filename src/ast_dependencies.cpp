@@ -0,0 +1,501 @@
+#include "ast_dependencies.hpp"
+
+#include "ast_cache.hpp"
+#include "ast_helper.hpp"
+#include "ast_names.hpp"
+#include "ast_traversal.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <unistd.h>
+
+namespace Ast
+{
+    namespace
+    {
+        const std::string header = "jast-dependencies 3";
+
+        // Record a referenced name; any name may turn out to name a type
+        void add_reference(unit_dependencies& unit, name const& navn)
+        {
+            Match(navn, void)
+                Case(const name_simple& navn)
+                {
+                    unit.simple_names.push_back(navn.id);
+                }
+                Case(const name_qualified& navn)
+                {
+                    unit.types.push_back(navn.id);
+                    // The first component is resolved like a simple name
+                    name_id first = navn.id;
+                    while(name_length(first) > 1)
+                    {
+                        first = name_parent(first);
+                    }
+                    unit.simple_names.push_back(first);
+                }
+            EndMatch;
+        }
+
+        void add_reference(unit_dependencies& unit, type_expression const& type)
+        {
+            // Peel off the array dimensions
+            type_expression const* walk = &type;
+            while(type_expression_tarray const* array = boost::get<type_expression_tarray>(walk))
+            {
+                walk = &array->type;
+            }
+            if(type_expression_named const* named = boost::get<type_expression_named>(walk))
+            {
+                add_reference(unit, named->type);
+            }
+        }
+
+        void add_references(unit_dependencies& unit, std::list<namedtype> const& names)
+        {
+            for(namedtype const& navn : names)
+            {
+                add_reference(unit, navn);
+            }
+        }
+
+        // The name an assignment or increment targets; the other lvalues are
+        // made of expressions, which are walked
+        void add_reference(unit_dependencies& unit, lvalue const& variable)
+        {
+            if(lvalue_ambiguous_name const* ambiguous = boost::get<lvalue_ambiguous_name>(&variable))
+            {
+                add_reference(unit, ambiguous->ambiguous);
+            }
+        }
+
+        // The names in expressions and statements, found by walking them
+        traversal reference_collector(unit_dependencies& unit)
+        {
+            traversal collector;
+            collector.enter_expression = [&unit](expression const& exp)
+            {
+                if(lvalue_ambiguous_name const* ambiguous = boost::get<lvalue_ambiguous_name>(&exp))
+                {
+                    add_reference(unit, ambiguous->ambiguous);
+                }
+                else if(expression_ambiguous_invoke const* invoke = boost::get<expression_ambiguous_invoke>(&exp))
+                {
+                    add_reference(unit, invoke->ambiguous);
+                }
+                else if(expression_static_invoke const* invoke = boost::get<expression_static_invoke>(&exp))
+                {
+                    add_reference(unit, invoke->type);
+                }
+                else if(expression_new const* creation = boost::get<expression_new>(&exp))
+                {
+                    add_reference(unit, creation->type);
+                }
+                else if(expression_new_array const* creation = boost::get<expression_new_array>(&exp))
+                {
+                    add_reference(unit, creation->type);
+                }
+                else if(expression_cast const* cast = boost::get<expression_cast>(&exp))
+                {
+                    add_reference(unit, cast->type);
+                }
+                else if(expression_instance_of const* instance_of = boost::get<expression_instance_of>(&exp))
+                {
+                    add_reference(unit, instance_of->type);
+                }
+                else if(expression_assignment const* assignment = boost::get<expression_assignment>(&exp))
+                {
+                    add_reference(unit, assignment->variable);
+                }
+                else if(expression_incdec const* incdec = boost::get<expression_incdec>(&exp))
+                {
+                    add_reference(unit, incdec->variable);
+                }
+                else if(expression_lvalue const* variable = boost::get<expression_lvalue>(&exp))
+                {
+                    add_reference(unit, variable->variable);
+                }
+            };
+            collector.enter_statement = [&unit](statement const& stm)
+            {
+                if(statement_local_declaration const* local = boost::get<statement_local_declaration>(&stm))
+                {
+                    add_reference(unit, local->type);
+                }
+            };
+            return collector;
+        }
+
+        void add_references(unit_dependencies& unit, std::list<formal_parameter> const& parameters, Maybe<body> const& method_body)
+        {
+            traversal collector = reference_collector(unit);
+            for(formal_parameter const& parameter : parameters)
+            {
+                add_reference(unit, parameter.first);
+            }
+            if(method_body)
+            {
+                traverse(*method_body, collector);
+            }
+        }
+
+        void add_references(unit_dependencies& unit, std::list<declaration> const& members)
+        {
+            for(declaration const& member : members)
+            {
+                Match(member, void)
+                    Case(const declaration_field& field)
+                    {
+                        add_reference(unit, field.decl.type);
+                        if(field.decl.optional_initializer)
+                        {
+                            traverse(*field.decl.optional_initializer, reference_collector(unit));
+                        }
+                    }
+                    Case(const declaration_method& method)
+                    {
+                        add_reference(unit, method.decl.return_type);
+                        add_references(unit, method.decl.throws);
+                        add_references(unit, method.decl.formal_parameters, method.decl.method_body);
+                    }
+                    Case(const declaration_constructor& constructor)
+                    {
+                        add_references(unit, constructor.decl.throws);
+                        add_references(unit, constructor.decl.formal_parameters, constructor.decl.method_body);
+                    }
+                EndMatch;
+            }
+        }
+
+        void sort_unique(std::vector<name_id>& ids)
+        {
+            std::sort(ids.begin(), ids.end());
+            ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+        }
+
+        unit_dependencies unit_from_ast(source_file const& sf, std::string file, std::string const& file_contents)
+        {
+            unit_dependencies unit;
+            unit.file = std::move(file);
+            unit.content_hash = content_hash(file_contents);
+            unit.package = sf.package ? name_to_id(*sf.package) : root_name_id;
+            unit.type = intern_name(unit.package, type_decl_name(sf.type));
+            // java.lang is always imported on demand
+            unit.packages.push_back(intern_name({ identifier("java"), identifier("lang") }));
+            // Explicit imports
+            for(import_declaration const& import : sf.imports)
+            {
+                Match(import, void)
+                    Case(const import_declaration_on_demand& on_demand)
+                    {
+                        unit.packages.push_back(name_to_id(on_demand.import));
+                    }
+                    Case(const import_declaration_single& single)
+                    {
+                        unit.types.push_back(intern_name(name_to_id(single.import), single.class_name.identifier_string));
+                    }
+                EndMatch;
+            }
+            // The names referenced by the declaration, and the bodies
+            Match(sf.type, void)
+                Case(const class_declaration& klass)
+                {
+                    add_reference(unit, klass.extends);
+                    add_references(unit, klass.implements);
+                    add_references(unit, klass.members);
+                }
+                Case(const interface_declaration& interface)
+                {
+                    add_references(unit, interface.extends);
+                    add_references(unit, interface.members);
+                }
+            EndMatch;
+            // A body refers to the same names over and over
+            sort_unique(unit.types);
+            sort_unique(unit.simple_names);
+            return unit;
+        }
+
+        /* *************** Persistence *************** */
+        // Intern a dotted name, as written by name_id_to_string
+        name_id intern_dotted(std::string const& dotted)
+        {
+            name_id id = root_name_id;
+            std::istringstream components(dotted);
+            std::string component;
+            while(std::getline(components, component, '.'))
+            {
+                id = intern_name(id, component);
+            }
+            return id;
+        }
+
+        std::string ids_to_string(std::vector<name_id> const& ids)
+        {
+            std::string output;
+            for(name_id id : ids)
+            {
+                output.append(output.empty() ? "" : ",").append(name_id_to_string(id));
+            }
+            return output;
+        }
+
+        std::vector<name_id> ids_from_string(std::string const& input)
+        {
+            std::vector<name_id> ids;
+            std::istringstream names(input);
+            std::string dotted;
+            while(std::getline(names, dotted, ','))
+            {
+                ids.push_back(intern_dotted(dotted));
+            }
+            return ids;
+        }
+    }
+
+    dependency_graph::dependency_graph(program const& prog, std::vector<std::pair<std::string, std::string>> const& files_contents,
+                                       std::uint64_t library_hash)
+        : library_hash(library_hash)
+    {
+        // The program holds the source files in the order they were given
+        auto file = files_contents.begin();
+        for(source_file const& sf : prog)
+        {
+            unit_list.push_back(unit_from_ast(sf, file->first, file->second));
+            ++file;
+        }
+    }
+
+    std::string dependency_graph::saved_path(std::string const& cache_directory,
+                                             std::vector<std::pair<std::string, std::string>> const& files_contents)
+    {
+        // Named by the files of the program, in any order
+        std::vector<std::string> files;
+        for(auto const& file : files_contents)
+        {
+            files.push_back(file.first);
+        }
+        std::sort(files.begin(), files.end());
+        std::string joined;
+        for(std::string const& file : files)
+        {
+            joined.append(file).append(1, '\n');
+        }
+        std::ostringstream path;
+        path << cache_directory << "/dependencies-" << std::hex << content_hash(joined);
+        return path.str();
+    }
+
+    Maybe<dependency_graph> dependency_graph::load(std::string const& path)
+    {
+        std::ifstream input(path);
+        std::string line;
+        if(!std::getline(input, line) || line != header)
+        {
+            return Maybe<dependency_graph>();
+        }
+        // The library snapshot the graph was built against
+        dependency_graph graph;
+        if(!std::getline(input, line) || line.compare(0, 8, "library\t") != 0)
+        {
+            return Maybe<dependency_graph>();
+        }
+        try
+        {
+            graph.library_hash = std::stoull(line.substr(8), nullptr, 16);
+        }
+        catch(std::logic_error&)
+        {
+            return Maybe<dependency_graph>();
+        }
+        // One unit per line, with tab seperated fields
+        while(std::getline(input, line))
+        {
+            std::istringstream fields(line);
+            std::string file, hash, package, type, types, packages, simple_names;
+            if(!std::getline(fields, file, '\t') || !std::getline(fields, hash, '\t') ||
+               !std::getline(fields, package, '\t') || !std::getline(fields, type, '\t'))
+            {
+                return Maybe<dependency_graph>();
+            }
+            std::getline(fields, types, '\t');
+            std::getline(fields, packages, '\t');
+            std::getline(fields, simple_names, '\t');
+
+            unit_dependencies unit;
+            unit.file = file;
+            try
+            {
+                unit.content_hash = std::stoull(hash, nullptr, 16);
+            }
+            catch(std::logic_error&)
+            {
+                // Not a number (std::invalid_argument), or too large (std::out_of_range)
+                return Maybe<dependency_graph>();
+            }
+            unit.package = intern_dotted(package);
+            unit.type = intern_dotted(type);
+            unit.types = ids_from_string(types);
+            unit.packages = ids_from_string(packages);
+            unit.simple_names = ids_from_string(simple_names);
+            graph.unit_list.push_back(std::move(unit));
+        }
+        return graph;
+    }
+
+    void dependency_graph::save(std::string const& path) const
+    {
+        // Unique per process, and per save within it
+        static std::atomic<unsigned long> saves(0);
+        std::string temporary = path + ".tmp" + std::to_string(getpid()) + "." + std::to_string(saves++);
+        {
+            std::ofstream output(temporary);
+            output << header << '\n';
+            output << "library\t" << std::hex << library_hash << std::dec << '\n';
+            for(unit_dependencies const& unit : unit_list)
+            {
+                output << unit.file << '\t' << std::hex << unit.content_hash << std::dec << '\t'
+                       << name_id_to_string(unit.package) << '\t' << name_id_to_string(unit.type) << '\t'
+                       << ids_to_string(unit.types) << '\t' << ids_to_string(unit.packages) << '\t'
+                       << ids_to_string(unit.simple_names) << '\n';
+            }
+            output.close();
+            if(output.fail())
+            {
+                std::remove(temporary.c_str());
+                return;
+            }
+        }
+        if(std::rename(temporary.c_str(), path.c_str()) != 0)
+        {
+            std::remove(temporary.c_str());
+        }
+    }
+
+    std::set<std::string> dependency_graph::affected_units(dependency_graph const& previous) const
+    {
+        // Index the units by what they depend upon; qualified names by each
+        // of their prefixes, as any of those may be the type, and simple names
+        // by the packages they are looked up in, along with the name itself
+        std::unordered_map<name_id, std::vector<std::size_t>> by_type;
+        std::unordered_map<std::uint64_t, std::vector<std::size_t>> by_simple_name;
+        auto simple_name_key = [](name_id package, name_id simple_name)
+        {
+            return (static_cast<std::uint64_t>(package) << 32) | simple_name;
+        };
+        for(std::size_t x = 0; x < unit_list.size(); x++)
+        {
+            unit_dependencies const& unit = unit_list[x];
+            std::vector<name_id> prefixes;
+            for(name_id type : unit.types)
+            {
+                for(name_id prefix = type; prefix != root_name_id; prefix = name_parent(prefix))
+                {
+                    prefixes.push_back(prefix);
+                }
+            }
+            sort_unique(prefixes);
+            for(name_id prefix : prefixes)
+            {
+                by_type[prefix].push_back(x);
+            }
+            // Types in the same package are visible without imports
+            std::vector<name_id> packages = unit.packages;
+            packages.push_back(unit.package);
+            sort_unique(packages);
+            for(name_id package : packages)
+            {
+                for(name_id simple_name : unit.simple_names)
+                {
+                    by_simple_name[simple_name_key(package, simple_name)].push_back(x);
+                }
+            }
+        }
+
+        // The type and package provided by changed units, both as they are
+        // now and as they were before
+        std::deque<std::pair<name_id, name_id>> worklist;
+        std::set<std::string> affected;
+
+        // Any unit may use the library, so a changed library affects them all
+        if(library_hash != previous.library_hash)
+        {
+            for(unit_dependencies const& unit : unit_list)
+            {
+                affected.insert(unit.file);
+            }
+            return affected;
+        }
+
+        std::unordered_map<std::string, unit_dependencies const*> old_units;
+        for(unit_dependencies const& unit : previous.unit_list)
+        {
+            old_units.emplace(unit.file, &unit);
+        }
+        for(unit_dependencies const& unit : unit_list)
+        {
+            auto old = old_units.find(unit.file);
+            if(old == old_units.end())
+            {
+                affected.insert(unit.file);
+                worklist.emplace_back(unit.type, unit.package);
+                continue;
+            }
+            if(old->second->content_hash != unit.content_hash)
+            {
+                affected.insert(unit.file);
+                worklist.emplace_back(unit.type, unit.package);
+                worklist.emplace_back(old->second->type, old->second->package);
+            }
+            old_units.erase(old);
+        }
+        // Whatever is left, has been removed
+        for(auto& removed : old_units)
+        {
+            worklist.emplace_back(removed.second->type, removed.second->package);
+        }
+
+        // Propagate to dependents, until nothing changes
+        auto visit = [&](std::vector<std::size_t> const& dependents)
+        {
+            for(std::size_t index : dependents)
+            {
+                unit_dependencies const& unit = unit_list[index];
+                if(affected.insert(unit.file).second)
+                {
+                    worklist.emplace_back(unit.type, unit.package);
+                }
+            }
+        };
+        while(worklist.empty() == false)
+        {
+            std::pair<name_id, name_id> provided = worklist.front();
+            worklist.pop_front();
+
+            auto types = by_type.find(provided.first);
+            if(types != by_type.end())
+            {
+                visit(types->second);
+            }
+            // Units referring to the type by its simple name; if no unit has
+            // that as a simple name, there is nothing to find
+            name_id simple_name = find_name(root_name_id, name_component(provided.first));
+            if(simple_name != root_name_id)
+            {
+                auto simple_names = by_simple_name.find(simple_name_key(provided.second, simple_name));
+                if(simple_names != by_simple_name.end())
+                {
+                    visit(simple_names->second);
+                }
+            }
+        }
+        return affected;
+    }
+}
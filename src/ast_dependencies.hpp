@@ -0,0 +1,77 @@
+#ifndef _COMPILER_AST_DEPENDENCIES_HPP
+#define _COMPILER_AST_DEPENDENCIES_HPP
+
+#include "ast.hpp"
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+/************************************************************************/
+/** {2 Dependency graph between compilation units}                      */
+/************************************************************************/
+// Built from the package and import declarations, and the names referenced
+// by each unit, and saved between runs, such that after an edit only the
+// units affected by the changed files need to be recompiled. A simple name
+// depends on the types of that name in the package of the unit, and in the
+// packages it imports on demand; not on every type of those packages.
+// Every unit depends on the standard library snapshot, if any.
+namespace Ast
+{
+    struct unit_dependencies
+    {
+        std::string file;
+        std::uint64_t content_hash;
+        // The package of the unit, root_name_id for the unnamed package
+        name_id package;
+        // The fully qualified name of the declared type
+        name_id type;
+        // Types imported by single-type imports, and names referenced qualified
+        // (which depend on any type named by one of their prefixes)
+        std::vector<name_id> types;
+        // Simple names referenced, including the first components of the
+        // qualified ones
+        std::vector<name_id> simple_names;
+        // Packages imported on demand
+        std::vector<name_id> packages;
+    };
+
+    class dependency_graph
+    {
+        public:
+            dependency_graph() = default;
+            // Build the graph for a program, files_contents as given to generate_ast,
+            // and library_hash the content_hash of the library snapshot, 0 if none
+            dependency_graph(program const& prog, std::vector<std::pair<std::string, std::string>> const& files_contents,
+                             std::uint64_t library_hash = 0);
+
+            // Where the graph of the program made of files_contents is saved, in
+            // cache_directory; programs of other files keep graphs of their own
+            static std::string saved_path(std::string const& cache_directory,
+                                          std::vector<std::pair<std::string, std::string>> const& files_contents);
+
+            // Read a graph saved by save; none if missing or malformed
+            static Maybe<dependency_graph> load(std::string const& path);
+            // Written to a temporary file, and renamed into place, such that
+            // concurrent compilers never see a partially written graph
+            void save(std::string const& path) const;
+
+            // Units which are new, or changed since the previous graph, along
+            // with every unit (transitively) depending on those, or on units
+            // which have since been removed.
+            std::set<std::string> affected_units(dependency_graph const& previous) const;
+
+            std::vector<unit_dependencies> const& units() const
+            {
+                return unit_list;
+            }
+
+        private:
+            std::vector<unit_dependencies> unit_list;
+            std::uint64_t library_hash = 0;
+    };
+}
+
+#endif //_COMPILER_AST_DEPENDENCIES_HPP
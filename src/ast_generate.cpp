@@ -1,22 +1,61 @@
 #include "ast_generate.hpp"
+#include "ast_cache.hpp"
 
 #include "Parser.hpp"
 #include "Lexer.hpp"
 #include "Error.hpp"
+#include "grammar_profile.hpp"
 
 #include "Boost_Spirit_Config.hpp"
 #include <boost/spirit/include/lex_lexertl.hpp>
 
+#include <chrono>
+
 namespace lex = boost::spirit::lex;
 
+namespace
+{
+    // Feeds every token of the file to the profiler, without parsing
+    struct token_counter
+    {
+        template<typename Token>
+        bool operator()(Token const& t) const
+        {
+            Profile::count_token(t.id());
+            return true;
+        }
+    };
+
+    void count_tokens(Lexer::lexer const& lexi, std::string& file_contents)
+    {
+        Lexer::lexer_iterator_type begin = file_contents.begin();
+        Lexer::lexer_iterator_type end   = file_contents.end();
+
+        auto start = std::chrono::steady_clock::now();
+        lex::tokenize(begin, end, lexi, token_counter());
+        auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        Profile::add_lexing_time(nanoseconds);
+    }
+}
+
 namespace Ast
 {
-    Ast::source_file generate_ast(std::string/* filename*/, std::string file_contents)
+    Ast::source_file generate_source_file(std::string filename, std::string file_contents)
     {
-        // We'll instance our lexer
-        Lexer::lexer lexi;
-        // And our parser, based upon our lexer
-        Parser::parser<Lexer::lexer_iterator> parsi(lexi);
+        // We'll instance our lexer, and our parser based upon it; these are
+        // expensive to construct, so they're built once per thread, and kept
+        // warm for every later file (i.e. in the compile server)
+        static thread_local Lexer::lexer lexi;
+        static thread_local Parser::parser<Lexer::lexer_iterator> parsi(lexi);
+        // When profiling, the parser with instrumented rules is used instead
+        Parser::parser<Lexer::lexer_iterator>* parser = &parsi;
+        if(Profile::enabled())
+        {
+            static thread_local Parser::parser<Lexer::lexer_iterator> profiled_parsi(lexi, true);
+            parser = &profiled_parsi;
+            // The token histogram and lexing time come from a pass of its own
+            count_tokens(lexi, file_contents);
+        }
         // Then we'll prepare an output variable
         Ast::source_file source;
         // And we'll prepare our input iterators
@@ -24,11 +63,13 @@ namespace Ast
         Lexer::lexer_iterator_type end   = file_contents.end();
     
         // Now let's run the lexer, and pipe it into the parser, to generate the source_file node.
-        bool b = lex::tokenize_and_parse(begin, end, lexi, parsi, source);
+        Profile::parse_scope profile_scope;
+        bool b = lex::tokenize_and_parse(begin, end, lexi, *parser, source);
         // If we were able to lex and parse
         if(b)
         {
             // Return the parsed ast node
+            source.name = filename;
             return source;
         }
         // Unable to lex and parse == error
@@ -41,8 +82,14 @@ namespace Ast
         }
     }
 
-    Ast::program generate_ast(std::vector<std::pair<std::string, std::string>> files_contents)
+    Ast::program generate_ast(std::vector<std::pair<std::string, std::string>> files_contents, Maybe<std::string> cache_directory)
     {
+        // Prepare the cache (if any)
+        Maybe<parse_cache> cache;
+        if(cache_directory)
+        {
+            cache = parse_cache(*cache_directory);
+        }
         // Prepare the output list
         std::list<source_file> program;
         // Process all arguments
@@ -50,10 +97,27 @@ namespace Ast
         {
             const std::string filename = std::get<0>(file);
             const std::string file_contents = std::get<1>(file);
+            // Check if we've already got this file parsed; unless the grammar
+            // is profiled, as a file loaded from the cache is never parsed
+            Maybe<source_file> cached;
+            if(cache && !Profile::enabled())
+            {
+                cached = cache->load(filename, file_contents);
+            }
+            if(cached)
+            {
+                program.push_back(std::move(*cached));
+                continue;
+            }
             // Generate the source-file for each (parse each)
-            Ast::source_file f = generate_ast(filename, file_contents);
+            Ast::source_file f = generate_source_file(filename, file_contents);
+            // And save it for next time
+            if(cache)
+            {
+                cache->store(file_contents, f);
+            }
             // Add them to the output list
-            program.push_back(f);
+            program.push_back(std::move(f));
         }
         // Return the output list
         return program;
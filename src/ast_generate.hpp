@@ -2,6 +2,7 @@
 #define _AST_GENERATE_HPP
 
 #include "ast.hpp"
+#include "utility.hpp"
 
 #include <vector>
 #include <string>
@@ -9,8 +10,11 @@
 
 namespace Ast
 {
-    Ast::program generate_ast(std::vector<std::pair<std::string, std::string>> files_contents);
-    //Ast::source_file generate_ast(std::string filename, std::string file_contents);
+    // If a cache directory is given, unchanged files are loaded from it,
+    // rather than being lexed and parsed, and newly parsed files are added.
+    Ast::program generate_ast(std::vector<std::pair<std::string, std::string>> files_contents, Maybe<std::string> cache_directory);
+    // Lex and parse a single file, throws Error::Syntax_Error on failure
+    Ast::source_file generate_source_file(std::string filename, std::string file_contents);
 }
 
 #endif //_AST_GENERATE_HPP
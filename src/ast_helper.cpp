@@ -1,4 +1,5 @@
 #include "ast_helper.hpp"
+#include "ast_names.hpp"
 
 #include <cassert>
 
@@ -9,14 +10,28 @@
 
 namespace Ast
 {
+    namespace
+    {
+        // The components of a name, read back from the name table
+        std::list<identifier> components(name_id id)
+        {
+            std::list<identifier> components;
+            for(; id != root_name_id; id = name_parent(id))
+            {
+                components.push_front(identifier(name_component(id)));
+            }
+            return components;
+        }
+    }
+
     std::list<identifier> name_to_identifier_list(name_simple    const& navn)
     {
-        return { navn.name };
+        return components(navn.id);
     }
 
     std::list<identifier> name_to_identifier_list(name_qualified const& navn)
     {
-        return navn.name; 
+        return components(navn.id);
     }
 
     std::list<identifier> name_to_identifier_list(name const& navn)
@@ -37,19 +52,8 @@ namespace Ast
     /** Convert a name to its string representation */
     std::string name_to_string(const name& navn)
     {
-        // Get a list of identifiers
-        std::list<identifier> identifiers = name_to_identifier_list(navn);
-        // Generate output string
-        std::string output_name = "";
-        // Transform list of identifiers into a string
-        for(identifier id : identifiers)
-        {
-            output_name.append(id.identifier_string);
-            output_name.append(".");
-        }
-        // At this point, we've added a "." too much, let's remove it
-        output_name.pop_back();
-        return output_name;
+        // Let the name table build the string, from the interned components
+        return name_id_to_string(name_to_id(navn));
     }
 
     /* exp -> bool */
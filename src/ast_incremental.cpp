@@ -0,0 +1,159 @@
+#include "ast_incremental.hpp"
+
+#include "ast_generate.hpp"
+#include "Lexer.hpp"
+#include "Error.hpp"
+
+#include "Boost_Spirit_Config.hpp"
+#include <boost/spirit/include/lex_lexertl.hpp>
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+namespace Ast
+{
+    namespace
+    {
+        // Lex text from begin, a restart point, appending the tokens to
+        // output, until resynchronized returns true for one (which is left
+        // out); false if the text doesn't lex
+        template<typename Resynchronized>
+        bool lex_from(std::string& text, std::size_t begin, std::vector<source_token>& output, Resynchronized resynchronized)
+        {
+            // Once per thread, as it's expensive to construct
+            static thread_local Lexer::lexer lexi;
+            Lexer::lexer_iterator_type first = text.begin() + static_cast<std::ptrdiff_t>(begin);
+            Lexer::lexer_iterator_type last  = text.end();
+            Lexer::lexer_iterator iter = lexi.begin(first, last);
+            Lexer::lexer_iterator end  = lexi.end();
+            for(; iter != end && token_is_valid(*iter); ++iter)
+            {
+                // Fresh from the lexer, the value of a token is its extent
+                auto const* extent = boost::get<boost::iterator_range<Lexer::lexer_iterator_type>>(&iter->value());
+                if(extent == nullptr)
+                {
+                    return false;
+                }
+                source_token lexed{ static_cast<std::size_t>(extent->begin() - text.begin()),
+                                    static_cast<std::size_t>(extent->end() - text.begin()),
+                                    static_cast<unsigned>(iter->id()) };
+                if(resynchronized(lexed))
+                {
+                    return true;
+                }
+                output.push_back(lexed);
+            }
+            return iter == end;
+        }
+
+        // The start of a '/*' before offset, with none of the characters
+        // ending the block comment pattern (see Lexer.hpp) between it and
+        // offset, if any; the lexer looks ahead through those for the end of
+        // the comment, so an edit at offset may change the tokens from there
+        std::size_t open_comment_before(std::string const& text, std::size_t offset)
+        {
+            std::size_t stop = text.find_last_of("(*/)", offset == 0 ? 0 : offset - 1);
+            if(offset == 0 || stop == std::string::npos || text[stop] != '*' || stop == 0 || text[stop - 1] != '/')
+            {
+                return std::string::npos;
+            }
+            return stop - 1;
+        }
+    }
+
+    incremental_source_file::incremental_source_file(std::string filename, std::string file_contents)
+        : filename(std::move(filename)), text(std::move(file_contents))
+    {
+        tree = generate_source_file(this->filename, text);
+        if(lex_from(text, 0, tokens, [](source_token const&){ return false; }) == false)
+        {
+            throw Error::Syntax_Error();
+        }
+    }
+
+    bool incremental_source_file::apply_edit(std::size_t offset, std::size_t removed, std::string const& inserted)
+    {
+        if(offset > text.size() || removed > text.size() - offset)
+        {
+            throw std::out_of_range("Edit outside of " + filename);
+        }
+        std::string edited = text;
+        edited.replace(offset, removed, inserted);
+        // The end of the edit, in the old and in the edited text
+        const std::size_t old_edit_end = offset + removed;
+        const std::size_t edit_end = offset + inserted.size();
+
+        // The first token the edit may change; including one ending at the
+        // edit, as it may extend into the inserted text
+        auto ends_before = [](source_token const& t, std::size_t position){ return t.end < position; };
+        auto affected = std::lower_bound(tokens.begin(), tokens.end(), offset, ends_before);
+        // Or a comment opened before it, and reaching up to the edit
+        std::size_t opened = open_comment_before(text, offset);
+        if(opened != std::string::npos)
+        {
+            affected = std::min(affected, std::lower_bound(tokens.begin(), tokens.end(), opened + 1, ends_before));
+        }
+        // The restart point is the end of the token before, where the lexer
+        // starts over, without looking back
+        std::size_t restart = (affected == tokens.begin()) ? 0 : std::prev(affected)->end;
+
+        // Lex until a token matches one after the edit, at the same place in
+        // the unchanged text following it; all later tokens match as well
+        auto old = std::lower_bound(affected, tokens.end(), old_edit_end,
+                                    [](source_token const& t, std::size_t position){ return t.begin < position; });
+        auto resynchronized = [&](source_token const& lexed)
+        {
+            if(lexed.begin < edit_end)
+            {
+                return false;
+            }
+            std::size_t old_begin = lexed.begin - edit_end + old_edit_end;
+            while(old != tokens.end() && old->begin < old_begin)
+            {
+                ++old;
+            }
+            return old != tokens.end() && old->begin == old_begin && old->id == lexed.id &&
+                   old->end - old->begin == lexed.end - lexed.begin;
+        };
+        std::vector<source_token> relexed;
+        bool lexed = lex_from(edited, restart, relexed, resynchronized);
+
+        // Splice the tokens lexed in place of those they replace
+        std::vector<source_token> spliced(tokens.begin(), affected);
+        spliced.insert(spliced.end(), relexed.begin(), relexed.end());
+        for(auto after = old; after != tokens.end(); ++after)
+        {
+            spliced.push_back({ after->begin - old_edit_end + edit_end, after->end - old_edit_end + edit_end, after->id });
+        }
+        // If the tokens are the same, only whitespace or comments changed,
+        // and so did nothing the parser sees
+        auto same_token = [&](source_token const& before, source_token const& now)
+        {
+            return before.id == now.id && before.end - before.begin == now.end - now.begin &&
+                   text.compare(before.begin, before.end - before.begin, edited, now.begin, now.end - now.begin) == 0;
+        };
+        if(lexed && static_cast<std::size_t>(old - affected) == relexed.size() &&
+           std::equal(affected, old, relexed.begin(), same_token))
+        {
+            text = std::move(edited);
+            tokens = std::move(spliced);
+            return false;
+        }
+
+        // Otherwise parse the file again; if it throws, the file is left as it was
+        source_file parsed = generate_source_file(filename, edited);
+        if(lexed == false)
+        {
+            spliced.clear();
+            if(lex_from(edited, 0, spliced, [](source_token const&){ return false; }) == false)
+            {
+                throw Error::Syntax_Error();
+            }
+        }
+        text = std::move(edited);
+        tokens = std::move(spliced);
+        tree = std::move(parsed);
+        return true;
+    }
+}
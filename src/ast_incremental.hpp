@@ -0,0 +1,63 @@
+#ifndef _COMPILER_AST_INCREMENTAL_HPP
+#define _COMPILER_AST_INCREMENTAL_HPP
+
+#include "ast.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/************************************************************************/
+/** {2 Incremental relexing of edited source files}                     */
+/************************************************************************/
+// Keeps the text, the tokens and the ast of a file, for editors and watch
+// modes re-submitting a file after each edit. An edit is lexed again from
+// the nearest restart point before it, that is the end of a token whose
+// lexeme can't have been changed by the edit, until the tokens
+// re-synchronize with the old ones after the edit. If the tokens in between
+// are unchanged (the edit was to whitespace or comments), the ast is kept;
+// otherwise the whole file is parsed again, as the grammar only parses
+// whole files.
+namespace Ast
+{
+    // A token the parser sees (whitespace and comments are skipped), by its
+    // extent in the text, and its id (see Tokens.hpp)
+    struct source_token
+    {
+        std::size_t begin;
+        std::size_t end;
+        unsigned id;
+    };
+
+    class incremental_source_file
+    {
+        public:
+            // Lexes and parses the file, throws Error::Syntax_Error on failure
+            incremental_source_file(std::string filename, std::string file_contents);
+
+            /** Replace removed characters at offset by inserted, and update the
+             *  ast; throws Error::Syntax_Error if the edited file doesn't lex or
+             *  parse, and std::out_of_range if the edit is outside the file,
+             *  leaving the file as it was. Returns whether the file was parsed
+             *  again. */
+            bool apply_edit(std::size_t offset, std::size_t removed, std::string const& inserted);
+
+            source_file const& ast() const
+            {
+                return tree;
+            }
+
+            std::string const& contents() const
+            {
+                return text;
+            }
+
+        private:
+            std::string filename;
+            std::string text;
+            std::vector<source_token> tokens;
+            source_file tree;
+    };
+}
+
+#endif //_COMPILER_AST_INCREMENTAL_HPP
@@ -0,0 +1,224 @@
+#include "ast_locals.hpp"
+#include "ast_helper.hpp"
+
+#include "ast_traversal.hpp"
+#include "Error.hpp"
+
+#include "Match/match.hpp"
+
+#include <unordered_set>
+#include <utility>
+
+#include <boost/variant.hpp>
+
+namespace Ast
+{
+    namespace
+    {
+        std::list<identifier> components(name const& navn)
+        {
+            return
+            Match(navn, std::list<identifier>)
+                Case(const name_simple& navn)
+                {
+                    return name_to_identifier_list(navn);
+                }
+                Case(const name_qualified& navn)
+                {
+                    return name_to_identifier_list(navn);
+                }
+            EndMatch;
+        }
+
+        // The local, followed by field accesses for the remaining components
+        expression local_access(std::list<identifier> const& components, local_slot slot)
+        {
+            auto component = components.begin();
+            expression access = lvalue_local{ *component, slot };
+            for(++component; component != components.end(); ++component)
+            {
+                access = lvalue_non_static_field{ std::move(access), *component };
+            }
+            return access;
+        }
+
+        // Rewrite variable if it's a name starting with a local; the remaining
+        // components are field accesses on it
+        void resolve_lvalue(local_table const& table, lvalue& variable)
+        {
+            if(lvalue_ambiguous_name* ambiguous = boost::get<lvalue_ambiguous_name>(&variable))
+            {
+                std::list<identifier> names = components(ambiguous->ambiguous);
+                Maybe<local_slot> slot = table.find(names.front().identifier_string);
+                if(slot && names.size() == 1)
+                {
+                    variable = lvalue_local{ names.front(), *slot };
+                }
+                else if(slot)
+                {
+                    identifier field = names.back();
+                    names.pop_back();
+                    variable = lvalue_non_static_field{ local_access(names, *slot), field };
+                }
+            }
+        }
+
+        // Rewrite exp if it's a name, or invocation on a name, starting with a
+        // local, or has such a name as its target
+        void resolve_expression(local_table const& table, expression& exp)
+        {
+            if(lvalue_ambiguous_name* ambiguous = boost::get<lvalue_ambiguous_name>(&exp))
+            {
+                std::list<identifier> names = components(ambiguous->ambiguous);
+                Maybe<local_slot> slot = table.find(names.front().identifier_string);
+                if(slot)
+                {
+                    exp = local_access(names, *slot);
+                }
+            }
+            else if(expression_ambiguous_invoke* invoke = boost::get<expression_ambiguous_invoke>(&exp))
+            {
+                std::list<identifier> names = components(invoke->ambiguous);
+                Maybe<local_slot> slot = table.find(names.front().identifier_string);
+                if(slot)
+                {
+                    expression_non_static_invoke call{ local_access(names, *slot), invoke->method_name, std::move(invoke->arguments) };
+                    exp = std::move(call);
+                }
+            }
+            else if(expression_assignment* assignment = boost::get<expression_assignment>(&exp))
+            {
+                resolve_lvalue(table, assignment->variable);
+            }
+            else if(expression_incdec* incdec = boost::get<expression_incdec>(&exp))
+            {
+                resolve_lvalue(table, incdec->variable);
+            }
+            else if(expression_lvalue* variable = boost::get<expression_lvalue>(&exp))
+            {
+                resolve_lvalue(table, variable->variable);
+            }
+        }
+
+        void declare(local_table& table, identifier const& name, std::string const& file)
+        {
+            if(table.find(name.identifier_string))
+            {
+                throw Error::Environment_Error("local variable " + name.identifier_string + " in " + file +
+                                               " is declared while another of the same name is in scope");
+            }
+            table.declare(name.identifier_string);
+        }
+
+        void resolve_members(std::list<declaration>& members, std::string const& file)
+        {
+            for(declaration& member : members)
+            {
+                if(declaration_method* method = boost::get<declaration_method>(&member))
+                {
+                    if(method->decl.method_body)
+                    {
+                        resolve_locals(method->decl.formal_parameters, *method->decl.method_body, file);
+                    }
+                }
+                else if(declaration_constructor* constructor = boost::get<declaration_constructor>(&member))
+                {
+                    if(constructor->decl.method_body)
+                    {
+                        resolve_locals(constructor->decl.formal_parameters, *constructor->decl.method_body, file);
+                    }
+                }
+            }
+        }
+    }
+
+    void local_table::enter_scope()
+    {
+        scopes.push_back(locals.size());
+    }
+
+    void local_table::leave_scope()
+    {
+        locals.resize(scopes.back());
+        scopes.pop_back();
+    }
+
+    local_slot local_table::declare(std::string const& name)
+    {
+        locals.push_back({ name, next_slot });
+        return next_slot++;
+    }
+
+    Maybe<local_slot> local_table::find(std::string const& name) const
+    {
+        // Innermost first
+        for(auto it = locals.rbegin(); it != locals.rend(); ++it)
+        {
+            if(it->name == name)
+            {
+                return it->slot;
+            }
+        }
+        return Maybe<local_slot>();
+    }
+
+    local_slot resolve_locals(std::list<formal_parameter> const& parameters, body& b, std::string const& file)
+    {
+        local_table table;
+        // The parameters are in scope of the whole body
+        table.enter_scope();
+        for(formal_parameter const& parameter : parameters)
+        {
+            declare(table, parameter.second, file);
+        }
+        // Walk the body in order, such that the table holds exactly the
+        // locals in scope at each node; names are rewritten on entering, so
+        // the children of their replacements are walked as well
+        mutable_traversal callbacks;
+        callbacks.enter_statement = [&table, &file](statement& stm)
+        {
+            if(boost::get<statement_block>(&stm))
+            {
+                table.enter_scope();
+            }
+            else if(statement_local_declaration const* local = boost::get<statement_local_declaration>(&stm))
+            {
+                // In scope of its own initializer already
+                declare(table, local->name, file);
+            }
+        };
+        callbacks.leave_statement = [&table](statement& stm)
+        {
+            if(boost::get<statement_block>(&stm))
+            {
+                table.leave_scope();
+            }
+        };
+        // The type of an ambiguous cast names a type, even if a local of
+        // the same name is in scope, so it's left alone
+        std::unordered_set<expression const*> cast_types;
+        callbacks.enter_expression = [&table, &cast_types](expression& exp)
+        {
+            if(expression_ambiguous_cast const* cast = boost::get<expression_ambiguous_cast>(&exp))
+            {
+                cast_types.insert(&cast->type);
+            }
+            else if(cast_types.erase(&exp) == 0)
+            {
+                resolve_expression(table, exp);
+            }
+        };
+        traverse(b, callbacks);
+        table.leave_scope();
+        return table.slots();
+    }
+
+    void resolve_locals(source_file& sf)
+    {
+        // Interfaces have no bodies
+        if(class_declaration* klass = boost::get<class_declaration>(&sf.type))
+        {
+            resolve_members(klass->members, sf.name);
+        }
+    }
+}
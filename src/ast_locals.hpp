@@ -0,0 +1,71 @@
+#ifndef _COMPILER_AST_LOCALS_HPP
+#define _COMPILER_AST_LOCALS_HPP
+
+#include "ast.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/************************************************************************/
+/** {2 Resolution of local variables}                                   */
+/************************************************************************/
+// Every formal parameter and local variable of a method is given a slot as
+// it's declared; the parameters first, then the locals in the order they
+// are declared. Names referring to a local are rewritten to its slot, once,
+// such that the later phases never look up locals by name again;
+//
+//  'x'         becomes lvalue_local x
+//  'x.f.g'     becomes the field accesses (x).f.g
+//
+// both as expressions and as the targets of assignments and increments;
+//  'x.m(...)'  becomes the non static invocation (x).m(...)
+//
+// Names not referring to a local are left ambiguous, for disambiguation.
+namespace Ast
+{
+    /** {3 Symbol table} */
+    // A flat stack of the locals in scope; entering a block remembers the
+    // height of the stack, and leaving it pops the locals of the block.
+    class local_table
+    {
+        public:
+            void enter_scope();
+            void leave_scope();
+
+            /** Declare a local in the innermost scope, giving it the next
+             *  slot; the caller checks for clashes using find */
+            local_slot declare(std::string const& name);
+            /** The slot of the innermost local named name, if any */
+            Maybe<local_slot> find(std::string const& name) const;
+
+            /** The number of slots given out, that is the size of the frame */
+            local_slot slots() const
+            {
+                return next_slot;
+            }
+
+        private:
+            struct local
+            {
+                std::string name;
+                local_slot slot;
+            };
+
+            std::vector<local> locals;
+            // The height of locals when entering each scope
+            std::vector<std::size_t> scopes;
+            local_slot next_slot = 0;
+    };
+
+    /** {3 Resolution} */
+    /** Resolve the locals of a method body, rewriting the names referring to
+     *  them. Throws Error::Environment_Error if two locals (or parameters) of
+     *  the same name are in scope at once, naming file in the error.
+     *  Returns the number of slots */
+    local_slot resolve_locals(std::list<formal_parameter> const& parameters, body& b, std::string const& file);
+    /** Resolve the locals of every method and constructor of sf */
+    void resolve_locals(source_file& sf);
+}
+
+#endif //_COMPILER_AST_LOCALS_HPP
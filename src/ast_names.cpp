@@ -0,0 +1,337 @@
+#include "ast_names.hpp"
+
+#include "Match/match.hpp"
+
+#include <atomic>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Ast
+{
+    namespace
+    {
+        // A node in the trie; the root has no component, and is its own parent.
+        // Everything but the links to children is fixed once the node is added.
+        struct name_node
+        {
+            name_id parent;
+            unsigned length;
+            std::string component;
+            // Children are kept as an intrusive list, 0 (the root) meaning none
+            std::atomic<name_id> first_child;
+            name_id last_child;
+            std::atomic<name_id> next_sibling;
+        };
+
+        // Edges of the trie are looked up by (parent, component)
+        using name_edge = std::pair<name_id, std::string>;
+
+        struct name_edge_hash
+        {
+            std::size_t operator()(name_edge const& edge) const
+            {
+                return std::hash<std::string>()(edge.second) * 31 + edge.first;
+            }
+        };
+
+        // Nodes are kept in chunks which never move, such that the queries can
+        // read them without taking a lock (as the type table does); an id is
+        // only handed out after its node has been written
+        const std::size_t chunk_bits = 12;
+        const std::size_t chunk_size = std::size_t(1) << chunk_bits;
+        const std::size_t max_chunks = std::size_t(1) << 16;
+
+        // The edges are split into stripes by hash, each with a lock of its
+        // own, such that looking up names which are already there (by far
+        // the common case) rarely waits on another thread
+        const std::size_t edge_stripes = 64;
+
+        struct edge_stripe
+        {
+            std::mutex lock;
+            std::unordered_map<name_edge, name_id, name_edge_hash> edges;
+        };
+
+        struct name_table
+        {
+            // Taken to add nodes (after the lock of the stripe of the edge)
+            std::mutex lock;
+            std::size_t size;
+            std::unique_ptr<std::atomic<name_node*>[]> chunks;
+            std::vector<std::unique_ptr<name_node[]>> owned_chunks;
+            edge_stripe stripes[edge_stripes];
+
+            name_table()
+                : size(0), chunks(new std::atomic<name_node*>[max_chunks])
+            {
+                for(std::size_t n = 0; n < max_chunks; n++)
+                {
+                    chunks[n].store(nullptr, std::memory_order_relaxed);
+                }
+                push_back(root_name_id, 0, "");
+            }
+
+            edge_stripe& stripe(name_edge const& edge)
+            {
+                return stripes[name_edge_hash()(edge) % edge_stripes];
+            }
+
+            // Requires the lock to be held
+            name_id push_back(name_id parent, unsigned length, std::string const& component)
+            {
+                std::size_t chunk = size >> chunk_bits;
+                if(chunk == max_chunks)
+                {
+                    throw std::length_error("Name table is full");
+                }
+                if((size & (chunk_size - 1)) == 0)
+                {
+                    owned_chunks.emplace_back(new name_node[chunk_size]);
+                    chunks[chunk].store(owned_chunks.back().get(), std::memory_order_release);
+                }
+                name_node& added = chunks[chunk].load(std::memory_order_relaxed)[size & (chunk_size - 1)];
+                added.parent = parent;
+                added.length = length;
+                added.component = component;
+                added.first_child.store(root_name_id, std::memory_order_relaxed);
+                added.last_child = root_name_id;
+                added.next_sibling.store(root_name_id, std::memory_order_relaxed);
+                return static_cast<name_id>(size++);
+            }
+        };
+
+        name_table& table()
+        {
+            static name_table names;
+            return names;
+        }
+
+        // Lock free, ids are only obtained once their node is written
+        name_node& node(name_id id)
+        {
+            name_node* chunk = table().chunks[id >> chunk_bits].load(std::memory_order_acquire);
+            return chunk[id & (chunk_size - 1)];
+        }
+    }
+
+    name_id intern_name(name_id parent, std::string const& component)
+    {
+        name_table& names = table();
+        name_edge edge(parent, component);
+        edge_stripe& stripe = names.stripe(edge);
+        std::lock_guard<std::mutex> stripe_guard(stripe.lock);
+        // Check if we've already got it
+        auto found = stripe.edges.find(edge);
+        if(found != stripe.edges.end())
+        {
+            return found->second;
+        }
+        // If not, add a new node below parent
+        name_id id;
+        {
+            std::lock_guard<std::mutex> guard(names.lock);
+            name_node& parent_node = node(parent);
+            id = names.push_back(parent, parent_node.length + 1, component);
+            // And link it into the parents list of children, once it's written
+            if(parent_node.first_child.load(std::memory_order_relaxed) == root_name_id)
+            {
+                parent_node.first_child.store(id, std::memory_order_release);
+            }
+            else
+            {
+                node(parent_node.last_child).next_sibling.store(id, std::memory_order_release);
+            }
+            parent_node.last_child = id;
+        }
+        stripe.edges.emplace(std::move(edge), id);
+        return id;
+    }
+
+    name_id intern_name(std::list<identifier> const& components)
+    {
+        name_id id = root_name_id;
+        for(auto& component : components)
+        {
+            id = intern_name(id, component.identifier_string);
+        }
+        return id;
+    }
+
+    name_id find_name(name_id parent, std::string const& component)
+    {
+        name_table& names = table();
+        name_edge edge(parent, component);
+        edge_stripe& stripe = names.stripe(edge);
+        std::lock_guard<std::mutex> stripe_guard(stripe.lock);
+        auto found = stripe.edges.find(edge);
+        return found != stripe.edges.end() ? found->second : root_name_id;
+    }
+
+    name_simple make_simple_name(identifier component)
+    {
+        return name_simple(intern_name(root_name_id, component.identifier_string));
+    }
+
+    name_qualified make_qualified_name(std::list<identifier> const& components)
+    {
+        return name_qualified(intern_name(components));
+    }
+
+    name_id name_to_id(name const& navn)
+    {
+        return
+        Match(navn, name_id)
+            Case(const name_simple& navn)
+            {
+                return navn.id;
+            }
+            Case(const name_qualified& navn)
+            {
+                return navn.id;
+            }
+        EndMatch;
+    }
+
+    bool same_name(name const& navn1, name const& navn2)
+    {
+        return name_to_id(navn1) == name_to_id(navn2);
+    }
+
+    name_id name_parent(name_id id)
+    {
+        return node(id).parent;
+    }
+
+    std::string const& name_component(name_id id)
+    {
+        return node(id).component;
+    }
+
+    unsigned name_length(name_id id)
+    {
+        return node(id).length;
+    }
+
+    std::string name_id_to_string(name_id id)
+    {
+        // Find the length of the output, such that we only allocate once
+        std::size_t size = 0;
+        for(name_id walk = id; walk != root_name_id; walk = node(walk).parent)
+        {
+            size += node(walk).component.size() + 1;
+        }
+        if(size == 0)
+        {
+            return "";
+        }
+        // Fill in the components back to front, seperated by dots
+        std::string output_name(size - 1, '.');
+        std::size_t end = output_name.size();
+        for(name_id walk = id; walk != root_name_id; walk = node(walk).parent)
+        {
+            std::string const& component = node(walk).component;
+            end -= component.size();
+            output_name.replace(end, component.size(), component);
+            // Skip the dot
+            end -= (end == 0 ? 0 : 1);
+        }
+        return output_name;
+    }
+
+    bool name_has_prefix(name_id id, name_id prefix)
+    {
+        // Walk up from id, until we're at the length of the prefix
+        unsigned prefix_length = node(prefix).length;
+        if(node(id).length < prefix_length)
+        {
+            return false;
+        }
+        while(node(id).length > prefix_length)
+        {
+            id = node(id).parent;
+        }
+        return id == prefix;
+    }
+
+    bool name_in_package(name_id id, name_id package)
+    {
+        return id != root_name_id && name_parent(id) == package;
+    }
+
+    std::vector<name_id> name_children(name_id id)
+    {
+        // Children added while we walk the list may or may not be included
+        std::vector<name_id> children;
+        for(name_id child = node(id).first_child.load(std::memory_order_acquire); child != root_name_id;
+            child = node(child).next_sibling.load(std::memory_order_acquire))
+        {
+            children.push_back(child);
+        }
+        return children;
+    }
+
+    std::size_t name_count()
+    {
+        name_table& names = table();
+        std::lock_guard<std::mutex> guard(names.lock);
+        return names.size;
+    }
+
+    void truncate_names(std::size_t count)
+    {
+        name_table& names = table();
+        std::lock_guard<std::mutex> guard(names.lock);
+        if(count == 0 || count >= names.size)
+        {
+            return;
+        }
+        // Drop the edges to the names
+        for(edge_stripe& stripe : names.stripes)
+        {
+            for(auto it = stripe.edges.begin(); it != stripe.edges.end();)
+            {
+                it = (it->second >= count) ? stripe.edges.erase(it) : std::next(it);
+            }
+        }
+        // Children are linked in the order they were interned, so the names
+        // dropped are at the end of each list
+        for(name_id id = 0; id < count; id++)
+        {
+            name_node& kept = node(id);
+            name_id first = kept.first_child.load(std::memory_order_relaxed);
+            if(first >= count)
+            {
+                kept.first_child.store(root_name_id, std::memory_order_relaxed);
+                kept.last_child = root_name_id;
+                continue;
+            }
+            if(first == root_name_id)
+            {
+                continue;
+            }
+            name_id last = first;
+            name_id next = node(last).next_sibling.load(std::memory_order_relaxed);
+            while(next != root_name_id && next < count)
+            {
+                last = next;
+                next = node(last).next_sibling.load(std::memory_order_relaxed);
+            }
+            node(last).next_sibling.store(root_name_id, std::memory_order_relaxed);
+            kept.last_child = last;
+        }
+        // And the chunks no longer used
+        std::size_t chunks = (count + chunk_size - 1) >> chunk_bits;
+        for(std::size_t chunk = chunks; chunk < names.owned_chunks.size(); chunk++)
+        {
+            names.chunks[chunk].store(nullptr, std::memory_order_relaxed);
+        }
+        names.owned_chunks.resize(chunks);
+        names.size = count;
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef _COMPILER_AST_NAMES_HPP
+#define _COMPILER_AST_NAMES_HPP
+
+#include "ast.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/************************************************************************/
+/** {2 Global table of interned qualified names}                        */
+/************************************************************************/
+// Every qualified name is a node in a trie of its components, such that
+// 'java.lang.Object' is the child 'Object' of 'java.lang', which is the child
+// 'lang' of 'java', which is the child 'java' of the root. Each node is
+// identified by a name_id, and a given name is only ever stored once.
+//
+// The table is read-mostly; the queries below take no lock, and looking up
+// an edge only locks one of a number of stripes, so concurrent phases can
+// query names freely. Only adding a name takes the lock of the whole table.
+namespace Ast
+{
+    /** The root of the trie, that is the empty name (the unnamed package) */
+    const name_id root_name_id = 0;
+
+    /** {3 Interning} */
+    /** Get the id of a name, interning it, if it's not already there */
+    name_id intern_name(name_id parent, std::string const& component);
+    name_id intern_name(std::list<identifier> const& components);
+    /** Get the id of a name, if it's there, or root_name_id if not; unlike
+     *  intern_name, this never adds to the table */
+    name_id find_name(name_id parent, std::string const& component);
+
+    /** {3 Construction helpers} */
+    /** Build names, interning their components */
+    name_simple make_simple_name(identifier component);
+    name_qualified make_qualified_name(std::list<identifier> const& components);
+
+    /** {3 Queries} */
+    /** Get the id of a name */
+    name_id name_to_id(name const& navn);
+    /** Compare two names, by their ids */
+    bool same_name(name const& navn1, name const& navn2);
+
+    /** Get the name without its last component, i.e. the enclosing package */
+    name_id name_parent(name_id id);
+    /** Get the last component of a name */
+    std::string const& name_component(name_id id);
+    /** Get the number of components in a name */
+    unsigned name_length(name_id id);
+    /** Convert an interned name to its dotted string representation */
+    std::string name_id_to_string(name_id id);
+
+    /** Whether prefix is a (not necessarily proper) prefix of id */
+    bool name_has_prefix(name_id id, name_id prefix);
+    /** Whether id is directly inside package, as 'import package.*;' sees it */
+    bool name_in_package(name_id id, name_id package);
+    /** Get the names directly inside a name, in the order they were interned */
+    std::vector<name_id> name_children(name_id id);
+
+    /** {3 Truncation} */
+    /** Get the number of names in the table; later names get larger ids */
+    std::size_t name_count();
+    /** Drop the names interned after the first count, such that a long
+     *  running process doesn't grow the table without bound; no other thread
+     *  may use the table meanwhile, and the ids dropped may not be used again */
+    void truncate_names(std::size_t count);
+}
+
+#endif //_COMPILER_AST_NAMES_HPP
@@ -1,432 +1,683 @@
 #include "ast_pp.hpp"
 #include "ast_helper.hpp"
+#include "ast_traversal.hpp"
 #include "utility.hpp"
+#include "trace.hpp"
 
 // Enable declarations in case clauses, which are disabled by default
 #define XTL_CLAUSE_DECL 1
 
-#include <iostream>
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstdio>
+#include <initializer_list>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
 
 namespace Ast
 {
-    // Type expressions
-    void pretty_print(type_expression const& type)
+    namespace
     {
-        ApplyForAll(type, void, pretty_print);
-    }
+        // Visitor forwarding to the pretty_print overload, of the alternative held
+        struct pretty_print_visitor : boost::static_visitor<void>
+        {
+            output_sink& out;
 
-    void pretty_print(type_expression_base const& type)
-    {
-        std::cout << base_type_to_string(type);
-    }
+            pretty_print_visitor(output_sink& out)
+                : out(out)
+            {
+            }
 
-    void pretty_print(type_expression_tarray const& type)
-    {
-        pretty_print(type.type);
-        std::cout << "[]";
-    }
+            template<typename T>
+            void operator()(T const& alternative) const
+            {
+                pretty_print(alternative, out);
+            }
+        };
 
-    void pretty_print(type_expression_named const& type)
-    {
-        std::cout << name_to_string(type.type);
+        template<typename... Ts>
+        void print_alternative(algebraic_datatype<Ts...> const& variant, output_sink& out)
+        {
+            pretty_print_visitor visitor(out);
+            boost::apply_visitor(visitor, variant);
+        }
     }
 
-    // L-Value
-    void pretty_print(lvalue const& lvalue)
+    // Type expressions
+    void pretty_print(type_expression const& type, output_sink& out)
     {
-        ApplyForAll(lvalue, void, pretty_print);
+        print_alternative(type, out);
     }
 
-    void pretty_print(lvalue_non_static_field const& lvalue)
+    void pretty_print(type_expression_base const& type, output_sink& out)
     {
-        pretty_print(lvalue.exp);
-        std::cout << "." << lvalue.name.identifier_string;
+        out << base_type_to_string(type);
     }
 
-    void pretty_print(lvalue_array const& lvalue)
+    void pretty_print(type_expression_tarray const& type, output_sink& out)
     {
-        pretty_print(lvalue.array_exp);
-        std::cout << "[";
-        pretty_print(lvalue.index_exp);
-        std::cout << "]";
+        pretty_print(type.type, out);
+        out << "[]";
     }
 
-    void pretty_print(lvalue_ambiguous_name const& lvalue)
+    void pretty_print(type_expression_named const& type, output_sink& out)
     {
-        std::cout << name_to_string(lvalue.ambiguous);
+        out << name_to_string(type.type);
     }
-    
+
     // Expressions
-    void pretty_print(expression const& exp)
+    namespace
     {
-        ApplyForAll(exp, void, pretty_print);
-    }
+        // The text around the children of a node; before the first child
+        // (prefix), between children (infix, before the child-th child), and
+        // after the last child (suffix). The children are those visited by
+        // traverse, i.e. the children of an lvalue are those of its owner.
+        enum class part
+        {
+            prefix,
+            infix,
+            suffix
+        };
 
-    void pretty_print(expression_binop const& exp)
-    {
-        pretty_print(exp.operand1);
-        std::cout << " " << binop_to_string(exp.operatur) << " ";
-        pretty_print(exp.operand2);
-    }
+        // The number of children of an lvalue, as visited by traverse
+        struct lvalue_children : boost::static_visitor<std::size_t>
+        {
+            std::size_t operator()(lvalue_non_static_field const&) const { return 1; }
+            std::size_t operator()(lvalue_array const&) const { return 2; }
+            std::size_t operator()(lvalue_ambiguous_name const&) const { return 0; }
+            std::size_t operator()(lvalue_local const&) const { return 0; }
+        };
+
+        // Print the part of a node
+        struct expression_layout : boost::static_visitor<void>
+        {
+            output_sink& out;
+            part what;
+            std::size_t child;
 
-    void pretty_print(expression_unop const& exp)
-    {
-        std::cout << unop_to_string(exp.operatur);
-        pretty_print(exp.operand);
-    }
+            expression_layout(output_sink& out, part what, std::size_t child)
+                : out(out), what(what), child(child)
+            {
+            }
 
-    void pretty_print(expression_integer_constant const& exp)
-    {
-        std::cout << exp.value;
-    }
+            void leaf(std::string const& text) const
+            {
+                if(what == part::prefix)
+                {
+                    out << text;
+                }
+            }
 
-    void pretty_print(expression_character_constant const& exp)
-    {
-        std::cout << exp.value;
-    }
+            // Arguments are separated by commas, and parenthesized
+            void arguments(std::string const& open) const
+            {
+                out << (what == part::prefix ? open : what == part::infix ? ", " : ")");
+            }
 
-    void pretty_print(expression_string_constant const& exp)
-    {
-        std::cout << exp.value;
-    }
+            // Leafs, which only have a prefix
+            void operator()(expression_integer_constant const& exp) const
+            {
+                leaf(exp.value);
+            }
 
-    void pretty_print(expression_boolean_constant const& exp)
-    {
-        if(exp.value)
-        {
-            std::cout << "true";
-        }
-        else
-        {
-            std::cout << "false";
-        }
-    }
+            void operator()(expression_string_constant const& exp) const
+            {
+                leaf(exp.value);
+            }
 
-    void pretty_print(expression_null const&)
-    {
-        std::cout << "null";
-    }
+            void operator()(expression_boolean_constant const& exp) const
+            {
+                leaf(exp.value ? "true" : "false");
+            }
 
-    void pretty_print(expression_this const&)
-    {
-        std::cout << "this";
-    }
+            void operator()(expression_null const&) const
+            {
+                leaf("null");
+            }
 
-    void pretty_print(expression_static_invoke const& exp)
-    {
-        std::cout << name_to_string(exp.type) << ".";
-        std::cout << exp.method_name.identifier_string;
-        std::cout << "(";
-        //TODO: argument list
-        std::cout << ")";
-    }
+            void operator()(expression_this const&) const
+            {
+                leaf("this");
+            }
 
-    void pretty_print(expression_non_static_invoke const& exp)
-    {
-        pretty_print(exp.context);
-        std::cout << ".";
-        std::cout << exp.method_name.identifier_string;
-        std::cout << "(";
-        //TODO: argument list
-        std::cout << ")";
-    }
+            // L-Values
+            void operator()(lvalue_ambiguous_name const& lvalue) const
+            {
+                if(what == part::prefix)
+                {
+                    out << name_to_string(lvalue.ambiguous);
+                }
+            }
 
-    void pretty_print(expression_simple_invoke const& exp)
-    {
-        std::cout << exp.method_name.identifier_string;
-        std::cout << "(";
-        //TODO: argument list
-        std::cout << ")";
-    }
+            void operator()(lvalue_local const& lvalue) const
+            {
+                if(what == part::prefix)
+                {
+                    out << lvalue.name.identifier_string;
+                }
+            }
 
-    void pretty_print(expression_ambiguous_invoke const& exp)
-    {
-        std::cout << name_to_string(exp.ambiguous) << ".";
-        std::cout << exp.method_name.identifier_string;
-        std::cout << "(";
-        //TODO: argument list
-        std::cout << ")";
-    }
+            void operator()(lvalue_non_static_field const& lvalue) const
+            {
+                if(what == part::suffix)
+                {
+                    out << "." << lvalue.name.identifier_string;
+                }
+            }
 
-    void pretty_print(expression_new const& exp)
-    {
-        std::cout << "new ";
-        pretty_print(exp.type);
-        std::cout << "(";
-        //TODO: argument list
-        std::cout << ")";
-    }
+            void operator()(lvalue_array const&) const
+            {
+                if(what != part::prefix)
+                {
+                    out << (what == part::infix ? "[" : "]");
+                }
+            }
 
-    void pretty_print(expression_new_array const& exp)
-    {
-        std::cout << "new ";
-        pretty_print(exp.type);
-        std::cout << "[]";
-        std::cout << "(";
-        //TODO: argument list
-        std::cout << ")";
-    }
+            // Operators
+            void operator()(expression_binop const& exp) const
+            {
+                if(what == part::infix)
+                {
+                    out << " " << binop_to_string(exp.operatur) << " ";
+                }
+            }
 
-    void pretty_print(expression_lvalue const& exp)
-    {
-        pretty_print(exp.variable);
-    }
+            void operator()(expression_unop const& exp) const
+            {
+                if(what == part::prefix)
+                {
+                    out << unop_to_string(exp.operatur);
+                }
+            }
 
-    void pretty_print(expression_assignment const& exp)
-    {
-        pretty_print(exp.variable);
-        std::cout << " = ";
-        pretty_print(exp.value);
-    }
+            void operator()(expression_lvalue const& exp) const
+            {
+                boost::apply_visitor(*this, exp.variable);
+            }
 
-    void pretty_print(expression_incdec const& exp)
-    {
-        Match(exp.operatur, void)
-            Case(inc_dec_op_preinc const&)  
-            { 
-                std::cout << "++";
-                pretty_print(exp.variable); 
+            void operator()(expression_assignment const& exp) const
+            {
+                // The value is the child after those of the variable
+                std::size_t variable_children = boost::apply_visitor(lvalue_children(), exp.variable);
+                if(what == part::suffix)
+                {
+                    return;
+                }
+                if(what == part::infix && child < variable_children)
+                {
+                    boost::apply_visitor(*this, exp.variable);
+                    return;
+                }
+                if(what == part::prefix)
+                {
+                    boost::apply_visitor(*this, exp.variable);
+                }
+                if((what == part::prefix) == (variable_children == 0))
+                {
+                    boost::apply_visitor(expression_layout(out, part::suffix, 0), exp.variable);
+                    out << " = ";
+                }
             }
-            Case(inc_dec_op_predec const&)  
+
+            void operator()(expression_incdec const& exp) const
             {
-                std::cout << "--"; 
-                pretty_print(exp.variable); 
-            } 
-            Case(inc_dec_op_postinc const&) 
+                bool prefix_operator = boost::get<inc_dec_op_preinc>(&exp.operatur) || boost::get<inc_dec_op_predec>(&exp.operatur);
+                bool increment = boost::get<inc_dec_op_preinc>(&exp.operatur) || boost::get<inc_dec_op_postinc>(&exp.operatur);
+                if(what == part::prefix && prefix_operator)
+                {
+                    out << (increment ? "++" : "--");
+                }
+                boost::apply_visitor(*this, exp.variable);
+                if(what == part::suffix && !prefix_operator)
+                {
+                    out << (increment ? "++" : "--");
+                }
+            }
+
+            // Invocations
+            void operator()(expression_static_invoke const& exp) const
             {
-                pretty_print(exp.variable); 
-                std::cout << "++"; 
-            } 
-            Case(inc_dec_op_postdec const&) 
+                arguments(name_to_string(exp.type) + "." + exp.method_name.identifier_string + "(");
+            }
+
+            void operator()(expression_non_static_invoke const& exp) const
             {
-                pretty_print(exp.variable); 
-                std::cout << "--"; 
+                // The first child is the context, the arguments follow
+                std::string open = "." + exp.method_name.identifier_string + "(";
+                if(what == part::prefix)
+                {
+                    return;
+                }
+                if(what == part::infix)
+                {
+                    out << (child == 1 ? open : ", ");
+                    return;
+                }
+                out << (exp.arguments.empty() ? open + ")" : ")");
             }
-        EndMatch;
-    }
 
-    void pretty_print(expression_cast const& exp)
-    {
-        std::cout << "(";
-        pretty_print(exp.type);
-        std::cout << ")";
-        std::cout << " ";
-        pretty_print(exp.value);
-    }
+            void operator()(expression_simple_invoke const& exp) const
+            {
+                arguments(exp.method_name.identifier_string + "(");
+            }
 
-    void pretty_print(expression_ambiguous_cast const& exp)
-    {
-        std::cout << "(";
-        pretty_print(exp.type);
-        std::cout << ")";
-        std::cout << " ";
-        pretty_print(exp.value);
-    }
+            void operator()(expression_ambiguous_invoke const& exp) const
+            {
+                arguments(name_to_string(exp.ambiguous) + "." + exp.method_name.identifier_string + "(");
+            }
 
-    void pretty_print(expression_instance_of const& exp)
-    {
-        pretty_print(exp.value);
-        std::cout << " instanceof ";
-        pretty_print(exp.type);
+            // Instance creation
+            void operator()(expression_new const& exp) const
+            {
+                if(what == part::prefix)
+                {
+                    out << "new ";
+                    pretty_print(exp.type, out);
+                }
+                arguments("(");
+            }
+
+            // The empty dimensions right before the given-th dimension which
+            // is given, or after the last one, if there's no such
+            static std::size_t empty_dimensions(expression_new_array const& exp, std::size_t given)
+            {
+                std::size_t empty = 0;
+                std::size_t seen = 0;
+                for(auto& dimension : exp.arguments)
+                {
+                    if(!dimension)
+                    {
+                        empty++;
+                    }
+                    else if(seen++ == given)
+                    {
+                        return empty;
+                    }
+                    else
+                    {
+                        empty = 0;
+                    }
+                }
+                return empty;
+            }
+
+            void operator()(expression_new_array const& exp) const
+            {
+                // The children are the size, then the dimensions given; the
+                // empty dimensions aren't visited, so are printed around them
+                if(what == part::prefix)
+                {
+                    out << "new ";
+                    pretty_print(exp.type, out);
+                    out << "[";
+                    return;
+                }
+                out << "]";
+                std::size_t empty = empty_dimensions(exp, what == part::infix ? child - 1 : exp.arguments.size());
+                for(std::size_t n = 0; n < empty; n++)
+                {
+                    out << "[]";
+                }
+                if(what == part::infix)
+                {
+                    out << "[";
+                }
+            }
+
+            // Casts and instanceof
+            void operator()(expression_cast const& exp) const
+            {
+                if(what == part::prefix)
+                {
+                    out << "(";
+                    pretty_print(exp.type, out);
+                    out << ") ";
+                }
+            }
+
+            void operator()(expression_ambiguous_cast const&) const
+            {
+                // The type is the first child
+                if(what != part::suffix)
+                {
+                    out << (what == part::prefix ? "(" : ") ");
+                }
+            }
+
+            void operator()(expression_instance_of const& exp) const
+            {
+                if(what == part::suffix)
+                {
+                    out << " instanceof ";
+                    pretty_print(exp.type, out);
+                }
+            }
+
+            void operator()(expression_parentheses const&) const
+            {
+                if(what != part::infix)
+                {
+                    out << (what == part::prefix ? "(" : ")");
+                }
+            }
+        };
     }
 
-    void pretty_print(expression_parentheses const& exp)
+    void pretty_print(expression const& exp, output_sink& out)
     {
-        std::cout << "(";
-        pretty_print(exp.inside);
-        std::cout << ")";
+        // Print the parts of each node, as the traversal enters, moves
+        // between and leaves its children; keeping the nodes entered and
+        // the number of children seen so far on the heap, rather than
+        // recursing on the native stack
+        std::vector<std::pair<expression const*, std::size_t>> entered;
+        traversal printer;
+        printer.enter_expression = [&](expression const& node)
+        {
+            if(entered.empty() == false)
+            {
+                std::pair<expression const*, std::size_t>& parent = entered.back();
+                if(parent.second > 0)
+                {
+                    boost::apply_visitor(expression_layout(out, part::infix, parent.second), *parent.first);
+                }
+                parent.second++;
+            }
+            boost::apply_visitor(expression_layout(out, part::prefix, 0), node);
+            entered.emplace_back(&node, 0);
+        };
+        printer.leave_expression = [&](expression const& node)
+        {
+            boost::apply_visitor(expression_layout(out, part::suffix, 0), node);
+            entered.pop_back();
+        };
+        traverse(exp, printer);
     }
 
     // Statements
-    void pretty_print(statement const& stm)
+    namespace
     {
-        ApplyForAll(stm, void, pretty_print);
-    }
-
-    void pretty_print(statement_expression const& stm)
+        // A part of a statement yet to be printed; either text, an expression
+        // or a substatement
+        struct statement_part
+        {
+            char const* text;
+            expression const* exp;
+            statement const* stm;
+        };
+
+        // Prints compound statements by pushing their parts on a stack, the
+        // last pushed printed first, rather than recursing into the
+        // substatements; the others print as they are
+        class statement_printer : public boost::static_visitor<void>
+        {
+            public:
+                explicit statement_printer(output_sink& out)
+                    : out(out)
+                {
+                }
+
+                void print(statement const& stm)
+                {
+                    parts.push_back(substatement_part(stm));
+                    run();
+                }
+
+                template<typename T>
+                void print(T const& stm)
+                {
+                    (*this)(stm);
+                    run();
+                }
+
+                void operator()(statement_if_then const& stm)
+                {
+                    push({ text_part("if( "), expression_part(stm.condition), text_part(")\n"), substatement_part(stm.true_statement) });
+                }
+
+                void operator()(statement_if_then_else const& stm)
+                {
+                    push({ text_part("if( "), expression_part(stm.condition), text_part(")\n"), substatement_part(stm.true_statement),
+                           text_part("\nelse\n"), substatement_part(stm.false_statement) });
+                }
+
+                void operator()(statement_while const& stm)
+                {
+                    push({ text_part("while( "), expression_part(stm.condition), text_part(")\n"), substatement_part(stm.loop_statement) });
+                }
+
+                void operator()(statement_block const& stm)
+                {
+                    parts.push_back(text_part("}\n"));
+                    for(auto substm = stm.body.rbegin(); substm != stm.body.rend(); ++substm)
+                    {
+                        parts.push_back(substatement_part(*substm));
+                    }
+                    parts.push_back(text_part("{\n"));
+                }
+
+                template<typename T>
+                void operator()(T const& stm)
+                {
+                    pretty_print(stm, out);
+                }
+
+            private:
+                void run()
+                {
+                    while(parts.empty() == false)
+                    {
+                        statement_part next = parts.back();
+                        parts.pop_back();
+                        if(next.text)
+                        {
+                            out << next.text;
+                        }
+                        else if(next.exp)
+                        {
+                            pretty_print(*next.exp, out);
+                        }
+                        else
+                        {
+                            boost::apply_visitor(*this, *next.stm);
+                        }
+                    }
+                }
+
+                static statement_part text_part(char const* text)
+                {
+                    return { text, nullptr, nullptr };
+                }
+
+                static statement_part expression_part(expression const& exp)
+                {
+                    return { nullptr, &exp, nullptr };
+                }
+
+                static statement_part substatement_part(statement const& stm)
+                {
+                    return { nullptr, nullptr, &stm };
+                }
+
+                // In reverse, such that they're printed in order
+                void push(std::initializer_list<statement_part> in_order)
+                {
+                    parts.insert(parts.end(), std::reverse_iterator<statement_part const*>(in_order.end()),
+                                 std::reverse_iterator<statement_part const*>(in_order.begin()));
+                }
+
+                output_sink& out;
+                std::vector<statement_part> parts;
+        };
+    }
+
+    void pretty_print(statement const& stm, output_sink& out)
+    {
+        statement_printer printer(out);
+        printer.print(stm);
+    }
+
+    void pretty_print(statement_expression const& stm, output_sink& out)
     {
         // Print the expression
-        pretty_print(stm.value);
+        pretty_print(stm.value, out);
         // Add a ";" as this is a statement.
-        std::cout << ";";
+        out << ";";
     }
 
-    void pretty_print(statement_if_then const& stm)
+    void pretty_print(statement_if_then const& stm, output_sink& out)
     {
-        // Print the condition
-        std::cout << "if( ";
-        pretty_print(stm.condition);
-        std::cout << ")";
-        // Print a newline for the 'If' body
-        std::cout << std::endl;
-        // Print the body
-        pretty_print(stm.true_statement);
+        // 'if( condition)', a newline, and the body
+        statement_printer printer(out);
+        printer.print(stm);
     }
 
-    void pretty_print(statement_if_then_else const& stm)
+    void pretty_print(statement_if_then_else const& stm, output_sink& out)
     {
-        // Print the condition
-        std::cout << "if( ";
-        pretty_print(stm.condition);
-        std::cout << ")";
-        // Print a newline for the 'If' body
-        std::cout << std::endl;
-        // Print the true_body
-        pretty_print(stm.true_statement);
-        // Print the else,
-        std::cout << std::endl << "else" << std::endl;
-        // Print the false_body
-        pretty_print(stm.false_statement);
+        // As above, followed by 'else' on a line of its own, and the false body
+        statement_printer printer(out);
+        printer.print(stm);
     }
 
-    void pretty_print(statement_while const& stm)
+    void pretty_print(statement_while const& stm, output_sink& out)
     {
-        // Print the condition
-        std::cout << "while( ";
-        pretty_print(stm.condition);
-        std::cout << ")";
-        // Print a newline for the 'If' body
-        std::cout << std::endl;
-        // Print the body
-        pretty_print(stm.loop_statement);
+        // 'while( condition)', a newline, and the body
+        statement_printer printer(out);
+        printer.print(stm);
     }
 
-    void pretty_print(statement_empty const&)
+    void pretty_print(statement_empty const&, output_sink& out)
     {
         // Empty statement, simply print the semicolon
-        std::cout << ";";
+        out << ";";
     }
 
-    void pretty_print(statement_block const& stm)
+    void pretty_print(statement_block const& stm, output_sink& out)
     {
-        // Print the block start, brace
-        std::cout << "{" << std::endl;
-        // Print all the statments in the body
-        for(auto& substm : stm.body) 
-        {
-	        pretty_print(substm);
-        }
-        // Print the block end, brace
-        std::cout << "}" << std::endl;
+        // The statements, between braces on lines of their own
+        statement_printer printer(out);
+        printer.print(stm);
     }
 
-    void pretty_print(statement_void_return const&)
+    void pretty_print(statement_void_return const&, output_sink& out)
     {
-        std::cout << "return;";
+        out << "return;";
     }
 
-    void pretty_print(statement_value_return const& stm)
+    void pretty_print(statement_value_return const& stm, output_sink& out)
     {
-        std::cout << "return ";
-        pretty_print(stm.value);
-        std::cout << ";";
+        out << "return ";
+        pretty_print(stm.value, out);
+        out << ";";
     }
     
-    void pretty_print(statement_local_declaration const& stm)
+    void pretty_print(statement_local_declaration const& stm, output_sink& out)
     {
-        pretty_print(stm.type);
-        std::cout << " ";
-        std::cout << stm.name.identifier_string;
+        pretty_print(stm.type, out);
+        out << " ";
+        out << stm.name.identifier_string;
         if (stm.optional_initializer)
         {
-            std::cout << " ";
-            pretty_print(*stm.optional_initializer);
+            out << " ";
+            pretty_print(*stm.optional_initializer, out);
         }
-        std::cout << ";";
+        out << ";";
     }
 
-    void pretty_print(statement_throw const& stm)
+    void pretty_print(statement_throw const& stm, output_sink& out)
     {
-        std::cout << "throw ";
-        pretty_print(stm.throwee);
-        std::cout << ";";
+        out << "throw ";
+        pretty_print(stm.throwee, out);
+        out << ";";
     }
 
-    void pretty_print(statement_super_call const&)
+    void pretty_print(statement_super_call const&, output_sink& out)
     {
-        std::cout << "super(";
+        out << "super(";
         // TODO: Implementation of expression list
-        std::cout << ");";
+        out << ");";
     }
     
-    void pretty_print(statement_this_call const&)
+    void pretty_print(statement_this_call const&, output_sink& out)
     {
-        std::cout << "this(";
+        out << "this(";
         // TODO: Implementation of expression list
-        std::cout << ");";
+        out << ");";
     }
 
     // Declarations
-    void pretty_print(declaration const& decl)
+    void pretty_print(declaration const& decl, output_sink& out)
     {
-        ApplyForAll(decl, void, pretty_print);
+        print_alternative(decl, out);
     }
 
-    void pretty_print(declaration_field const& field)
+    void pretty_print(declaration_field const& field, output_sink& out)
     {
-        field_declaration info = field.decl;
+        field_declaration const& info = field.decl;
         // Print our access modifier
-        std::cout << access_to_string(info.access_type) << " ";
+        out << access_to_string(info.access_type) << " ";
         // Print static, if we are
         if(info.is_static)
         {
-            std::cout << "static ";
+            out << "static ";
         }
         // Print final, if we are
         if(info.is_final)
         {
-            std::cout << "final ";
+            out << "final ";
         }
         // Pretty print the type
-        pretty_print(info.type);
-        std::cout << " ";
+        pretty_print(info.type, out);
+        out << " ";
         // Print the name of the field
-        std::cout << info.name.identifier_string;
+        out << info.name.identifier_string;
         // Print the intializer if any
         if (info.optional_initializer)
         {
-            std::cout << " = ";
-            pretty_print(*info.optional_initializer);
+            out << " = ";
+            pretty_print(*info.optional_initializer, out);
         }
-        std::cout << ";";
+        out << ";";
         // Newline for less messy'ness
-        std::cout << std::endl;
+        out << '\n';
     }
 
-    void pretty_print(declaration_method const& method)
+    void pretty_print(declaration_method const& method, output_sink& out)
     {
-        method_declaration info = method.decl;
+        method_declaration const& info = method.decl;
         // Print our access modifier
-        std::cout << access_to_string(info.access_type) << " ";
+        out << access_to_string(info.access_type) << " ";
         // Print static, if we are
         if(info.is_static)
         {
-            std::cout << "static ";
+            out << "static ";
         }
         // Print final, if we are
         if(info.is_final)
         {
-            std::cout << "final ";
+            out << "final ";
         }
         // Print abstract, if we are
         if(info.is_abstract)
         {
-            std::cout << "abstract ";
+            out << "abstract ";
         }
         // Pretty print the return-type
-        pretty_print(info.return_type);
-        std::cout << " ";
+        pretty_print(info.return_type, out);
+        out << " ";
         // Print the name of the function
-        std::cout << info.name.identifier_string;
+        out << info.name.identifier_string;
         // Print parameteres, incapsulated in braces
-        std::cout << "(";
+        out << "(";
         // TODO: Handle parameters
-        std::cout << ")";
+        out << ")";
         // Print throws
         if(info.throws.empty() == false)
         {
-            //std::cout << " throws " << concat(info.throws, name_to_string, ", "); // TODO FIXME
+            out << " throws ";
+            concat(out, info.throws, name_to_string, ", ");
         }
         // Print body (if any)
         if (info.method_body)
@@ -434,193 +685,233 @@ namespace Ast
             body const& method_body = *info.method_body;
 
             // Print spacing, before body
-            std::cout << std::endl;
+            out << '\n';
             // Print body opening brace
-            std::cout << "{" << std::endl;
+            out << "{" << '\n';
             // Print statements one at a time
             for(auto& substm : method_body) 
             {
-                pretty_print(substm);
+                pretty_print(substm, out);
             }
             // Print body closing brace
-            std::cout << "}" << std::endl;
+            out << "}" << '\n';
         }
         else
         {
-            std::cout << ";";
+            out << ";";
         }
         // Newline for less messy'ness
-        std::cout << std::endl;
+        out << '\n';
     }
 
-    void pretty_print(declaration_constructor const& constructor)
+    void pretty_print(declaration_constructor const& constructor, output_sink& out)
     {
-        constructor_declaration info = constructor.decl;
+        constructor_declaration const& info = constructor.decl;
         // Print our access modifier
-        std::cout << access_to_string(info.access_type) << " ";
+        out << access_to_string(info.access_type) << " ";
         // Print the name of the function
-        std::cout << info.name.identifier_string;
+        out << info.name.identifier_string;
         // Print parameteres, incapsulated in braces
-        std::cout << "(";
+        out << "(";
         // TODO: Handle parameters
-        std::cout << ")";
+        out << ")";
         // Print throws
         if(info.throws.empty() == false)
         {
-            //std::cout << " throws " << concat(info.throws, name_to_string, ", "); // TODO FIXME
+            out << " throws ";
+            concat(out, info.throws, name_to_string, ", ");
         }
         // Print spacing, before body
-        std::cout << std::endl;
+        out << '\n';
         // Print body (if any)
         if(info.method_body)
         {
             body const& method_body = *info.method_body;
             // Print spacing, before body
-            std::cout << std::endl;
+            out << '\n';
             // Print body opening brace
-            std::cout << "{" << std::endl;
+            out << "{" << '\n';
             // Print statements one at a time
             for(auto& substm : method_body) 
             {
-                pretty_print(substm);
+                pretty_print(substm, out);
             }
             // Print body closing brace
-            std::cout << "}" << std::endl;
+            out << "}" << '\n';
         }
         else
         {
-            std::cout << ";";
+            out << ";";
         }
         // Newline for less messy'ness
-        std::cout << std::endl;
+        out << '\n';
     }
 
     // Type declarations
-    void pretty_print(type_declaration const& type_decl)
+    void pretty_print(type_declaration const& type_decl, output_sink& out)
     {
-        ApplyForAll(type_decl, void, pretty_print);
+        print_alternative(type_decl, out);
     }
 
-    void pretty_print(type_declaration_class const& klass)
+    void pretty_print(type_declaration_class const& klass, output_sink& out)
     {
         // Get the info struct
-        class_declaration info = klass;
+        class_declaration const& info = klass;
         // Always public
-        std::cout << "public ";
+        out << "public ";
         // Print final, if we are
         if(info.is_final)
         {
-            std::cout << "final ";
+            out << "final ";
         }
         // Print abstract, if we are
         if(info.is_abstract)
         {
-            std::cout << "abstract ";
+            out << "abstract ";
         }
         // Print the 'class' keyword, the class name, and the class we extend
         // (in non inheriting classes this will be java.lang.Object).
-        std::cout << "class " << info.name.identifier_string << " extends " << name_to_string(info.extends);
+        out << "class " << info.name.identifier_string << " extends " << name_to_string(info.extends);
         // If we're implementing anything
         if(info.implements.empty() == false)
         {
             // Then write out the 'implements' keyword, and a comma seperated
             // list of implements 
-            //std::cout << " implements " << concat(info.implements, name_to_string, ", ");  // TODO FIXME
+            out << " implements ";
+            concat(out, info.implements, name_to_string, ", ");
         }
         // Newline because we like allman style
-        std::cout << std::endl;
+        out << '\n';
         // Start brace, and newline
-        std::cout << "{" << std::endl;
+        out << "{" << '\n';
         // Print all members
         for(auto& mem : info.members) 
         {
-	        pretty_print(mem);
+	        pretty_print(mem, out);
         }
         // End brace, and newline
-        std::cout << "}" << std::endl;
+        out << "}" << '\n';
     }
 
-    void pretty_print(type_declaration_interface const& interface)
+    void pretty_print(type_declaration_interface const& interface, output_sink& out)
     {
         // Get the info struct
-        interface_declaration info = interface;
+        interface_declaration const& info = interface;
         // Always public
-        std::cout << "public ";
+        out << "public ";
         // Print the 'interface' keyword, and the interface name
-        std::cout << "interface " << info.name.identifier_string;
+        out << "interface " << info.name.identifier_string;
         // If we're extend anything
         if(info.extends.empty() == false)
         {
             // Then write out the 'extends' keyword, and a comma seperated
             // list of extends 
-            //std::cout << " extends " << concat(info.extends, name_to_string, ", "); // TODO FIXME
+            out << " extends ";
+            concat(out, info.extends, name_to_string, ", ");
         }
         // Newline because we like allman style
-        std::cout << std::endl;
+        out << '\n';
         // Start brace, and newline
-        std::cout << "{" << std::endl;
+        out << "{" << '\n';
         // Print all members
         for(auto& mem : info.members) 
         {
-	        pretty_print(mem);
+	        pretty_print(mem, out);
         }
         // End brace, and newline
-        std::cout << "}" << std::endl;
+        out << "}" << '\n';
     }
 
     // Import declarations
-    void pretty_print(import_declaration const& import)
+    void pretty_print(import_declaration const& import, output_sink& out)
     {
-        ApplyForAll(import, void, pretty_print);
+        print_alternative(import, out);
     }
 
-    void pretty_print(import_declaration_on_demand const& import)
+    void pretty_print(import_declaration_on_demand const& import, output_sink& out)
     {
         name const& import_name = import.import;
-        std::cout << "import " << name_to_string(import_name) << ".*;" << std::endl;
+        out << "import " << name_to_string(import_name) << ".*;" << '\n';
     }
 
-    void pretty_print(import_declaration_single const& import)
+    void pretty_print(import_declaration_single const& import, output_sink& out)
     {
         name const& import_name = import.import;
-        std::cout << "import " << name_to_string(import_name) << "." << import.class_name.identifier_string << ";" << std::endl;
+        out << "import " << name_to_string(import_name) << "." << import.class_name.identifier_string << ";" << '\n';
     }
 
     // Package declaration
-    void pretty_print(package_declaration const& package)
+    void pretty_print(package_declaration const& package, output_sink& out)
     {
-        std::cout << "package " << name_to_string(package) << ";" << std::endl;
+        out << "package " << name_to_string(package) << ";" << '\n';
     }
 
     // Source file
-    void pretty_print(source_file const& sf)
+    void pretty_print(source_file const& sf, output_sink& out)
     {
         // Start marker
-        std::cout << ">>>> File: " << sf.name << " Start <<<<" << std::endl;
+        out << ">>>> File: " << sf.name << " Start <<<<" << '\n';
 
         // Print package declaration if any
         if(sf.package) 
-	    pretty_print(*sf.package);
+	    pretty_print(*sf.package, out);
         // Print imports
         for(auto& i : sf.imports)
         {
-            pretty_print(i);
+            pretty_print(i, out);
         }
         // Print the type, inside the file
-        pretty_print(sf.type);
+        pretty_print(sf.type, out);
         
         // End Marker
-        std::cout << ">>>> File: " << sf.name << " End <<<<" << std::endl;
+        out << ">>>> File: " << sf.name << " End <<<<" << '\n';
     }
 
     // Program
-    void pretty_print(program const& prog)
+    void pretty_print(program const& prog, output_sink& out)
     {
-        std::cout << " *** " << "pretty printing Ast::program" << " *** " << std::endl;
-        // Pretty print each source file in program
+        out << " *** " << "pretty printing Ast::program" << " *** " << '\n';
+        // Index the source files, and prepare a buffer for each
+        std::vector<source_file const*> files;
         for(auto& file : prog)
         {
-            pretty_print(file);
+            files.push_back(&file);
+        }
+        std::vector<std::string> buffers(files.size());
+        // Pretty print each source file in program, into its own buffer;
+        // workers pick the next unprinted file, until there's none left
+        std::atomic<std::size_t> next_file(0);
+        auto worker = [&]()
+        {
+            for(std::size_t n = next_file++; n < files.size(); n = next_file++)
+            {
+                Trace::span span("pretty print", "pool", files[n]->name);
+                output_sink file_out(buffers[n]);
+                pretty_print(*files[n], file_out);
+            }
+        };
+        std::size_t num_workers = std::min<std::size_t>(std::max(std::thread::hardware_concurrency(), 1u), files.size());
+        std::vector<std::thread> workers;
+        for(std::size_t n = 1; n < num_workers; n++)
+        {
+            workers.emplace_back(worker);
+        }
+        // This thread works too
+        worker();
+        for(auto& thread : workers)
+        {
+            thread.join();
+        }
+        // Finally write out the buffers, in order
+        for(auto& buffer : buffers)
+        {
+            out << buffer;
         }
     }
+
+    void pretty_print(program const& prog)
+    {
+        output_sink out(stdout);
+        pretty_print(prog, out);
+    }
 }
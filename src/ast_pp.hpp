@@ -2,83 +2,66 @@
 #define _COMPILER_AST_PP_HPP
 
 #include "ast.hpp"
+#include "output_sink.hpp"
 
 namespace Ast
 {
     // Type expressions
-    void pretty_print(type_expression const& type);
-    void pretty_print(type_expression_base const& type);
-    void pretty_print(type_expression_tarray const& type);
-    void pretty_print(type_expression_named const& type);
-    
-    // L-Value
-    void pretty_print(lvalue const& lvalue);
-    void pretty_print(lvalue_non_static_field const& lvalue);
-    void pretty_print(lvalue_array const& lvalue);
-    void pretty_print(lvalue_ambiguous_name const& lvalue);
+    void pretty_print(type_expression const& type, output_sink& out);
+    void pretty_print(type_expression_base const& type, output_sink& out);
+    void pretty_print(type_expression_tarray const& type, output_sink& out);
+    void pretty_print(type_expression_named const& type, output_sink& out);
 
     // Expressions
-    void pretty_print(expression const& exp);
-    void pretty_print(expression_binop const& exp);
-    void pretty_print(expression_unop const& exp);
-    void pretty_print(expression_integer_constant const& exp);
-    void pretty_print(expression_character_constant const& exp);
-    void pretty_print(expression_string_constant const& exp);
-    void pretty_print(expression_boolean_constant const& exp);
-    void pretty_print(expression_null const& exp);
-    void pretty_print(expression_this const& exp);
-    void pretty_print(expression_static_invoke const& exp);
-    void pretty_print(expression_non_static_invoke const& exp);
-    void pretty_print(expression_simple_invoke const& exp);
-    void pretty_print(expression_ambiguous_invoke const& exp);
-    void pretty_print(expression_new const& exp);
-    void pretty_print(expression_new_array const& exp);
-    void pretty_print(expression_lvalue const& exp);
-    void pretty_print(expression_assignment const& exp);
-    void pretty_print(expression_incdec const& exp);
-    void pretty_print(expression_cast const& exp);
-    void pretty_print(expression_ambiguous_cast const& exp);
-    void pretty_print(expression_instance_of const& exp);
-    void pretty_print(expression_parentheses const& exp);
-    
+    // Printed by the iterative traversal (see ast_traversal.hpp), such that
+    // expressions of any depth print without deep recursion
+    void pretty_print(expression const& exp, output_sink& out);
+
     // Statements
-    void pretty_print(statement const& stm);
-    void pretty_print(statement_expression const& stm);
-    void pretty_print(statement_if_then const& stm);
-    void pretty_print(statement_if_then_else const& stm);
-    void pretty_print(statement_while const& stm);
-    void pretty_print(statement_empty const& stm);
-    void pretty_print(statement_block const& stm);
-    void pretty_print(statement_void_return const& stm);
-    void pretty_print(statement_value_return const& stm);
-    void pretty_print(statement_local_declaration const& stm);
-    void pretty_print(statement_throw const& stm);
-    void pretty_print(statement_super_call const& stm);
-    void pretty_print(statement_this_call const& stm);
+    // Compound statements push their parts on a stack of their own, and
+    // expressions print as above, such that nesting of any depth prints
+    // without deep recursion
+    void pretty_print(statement const& stm, output_sink& out);
+    void pretty_print(statement_expression const& stm, output_sink& out);
+    void pretty_print(statement_if_then const& stm, output_sink& out);
+    void pretty_print(statement_if_then_else const& stm, output_sink& out);
+    void pretty_print(statement_while const& stm, output_sink& out);
+    void pretty_print(statement_empty const& stm, output_sink& out);
+    void pretty_print(statement_block const& stm, output_sink& out);
+    void pretty_print(statement_void_return const& stm, output_sink& out);
+    void pretty_print(statement_value_return const& stm, output_sink& out);
+    void pretty_print(statement_local_declaration const& stm, output_sink& out);
+    void pretty_print(statement_throw const& stm, output_sink& out);
+    void pretty_print(statement_super_call const& stm, output_sink& out);
+    void pretty_print(statement_this_call const& stm, output_sink& out);
 
     // Declarations
-    void pretty_print(declaration const& decl);
-    void pretty_print(declaration_field const& field);
-    void pretty_print(declaration_method const& method);
-    void pretty_print(declaration_constructor const& constructor);
+    void pretty_print(declaration const& decl, output_sink& out);
+    void pretty_print(declaration_field const& field, output_sink& out);
+    void pretty_print(declaration_method const& method, output_sink& out);
+    void pretty_print(declaration_constructor const& constructor, output_sink& out);
 
     // Type declarations
-    void pretty_print(type_declaration const& type_decl);
-    void pretty_print(type_declaration_class const& klass);
-    void pretty_print(type_declaration_interface const& interface);
+    void pretty_print(type_declaration const& type_decl, output_sink& out);
+    void pretty_print(type_declaration_class const& klass, output_sink& out);
+    void pretty_print(type_declaration_interface const& interface, output_sink& out);
     
     // Import declarations
-    void pretty_print(import_declaration const& import);
-    void pretty_print(import_declaration_on_demand const& import);
-    void pretty_print(import_declaration_single const& import);
+    void pretty_print(import_declaration const& import, output_sink& out);
+    void pretty_print(import_declaration_on_demand const& import, output_sink& out);
+    void pretty_print(import_declaration_single const& import, output_sink& out);
 
     // Package declaration
-    void pretty_print(package_declaration const& package);
+    void pretty_print(package_declaration const& package, output_sink& out);
 
     // Source file
-    void pretty_print(source_file const& sf);
+    void pretty_print(source_file const& sf, output_sink& out);
 
     // Program
+    // Source files are printed into separate buffers in parallel, and
+    // written to the sink in order.
+    void pretty_print(program const& prog, output_sink& out);
+    // As above, writing to the standard output
     void pretty_print(program const& prog);
 }
 
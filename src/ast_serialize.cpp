@@ -0,0 +1,826 @@
+#include "ast_serialize.hpp"
+
+#include "ast_helper.hpp"
+#include "ast_names.hpp"
+#include "ast_traversal.hpp"
+#include "Error.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+namespace Ast
+{
+    namespace
+    {
+        const char magic[4] = { 'J', 'A', 'S', 'T' };
+
+        /* *************** Archives *************** */
+        // Writes primitives to the end of a string
+        struct writer
+        {
+            std::string& output;
+
+            void varint(std::uint64_t value)
+            {
+                // 7 bits at a time, least significant first, high bit means 'more'
+                while(value >= 0x80)
+                {
+                    output.push_back(static_cast<char>((value & 0x7F) | 0x80));
+                    value >>= 7;
+                }
+                output.push_back(static_cast<char>(value));
+            }
+
+            void boolean(bool& value)
+            {
+                output.push_back(value ? 1 : 0);
+            }
+
+            void string(std::string& value)
+            {
+                varint(value.size());
+                output.append(value);
+            }
+        };
+
+        // Reads primitives from a buffer, checking every read against its end
+        struct reader
+        {
+            char const* current;
+            char const* end;
+
+            std::size_t remaining() const
+            {
+                return static_cast<std::size_t>(end - current);
+            }
+
+            void require(std::size_t bytes) const
+            {
+                if(remaining() < bytes)
+                {
+                    throw Error::Serialization_Error("Unexpected end of input");
+                }
+            }
+
+            unsigned char byte()
+            {
+                require(1);
+                return static_cast<unsigned char>(*current++);
+            }
+
+            std::uint64_t varint()
+            {
+                std::uint64_t value = 0;
+                for(unsigned shift = 0; shift < 64; shift += 7)
+                {
+                    unsigned char b = byte();
+                    value |= static_cast<std::uint64_t>(b & 0x7F) << shift;
+                    if((b & 0x80) == 0)
+                    {
+                        return value;
+                    }
+                }
+                throw Error::Serialization_Error("Malformed integer");
+            }
+
+            // Read the length of a list; every element takes at least a byte
+            std::size_t count()
+            {
+                std::uint64_t size = varint();
+                if(size > remaining())
+                {
+                    throw Error::Serialization_Error("List longer than input");
+                }
+                return static_cast<std::size_t>(size);
+            }
+
+            void boolean(bool& value)
+            {
+                unsigned char b = byte();
+                if(b > 1)
+                {
+                    throw Error::Serialization_Error("Malformed boolean");
+                }
+                value = (b == 1);
+            }
+
+            void string(std::string& value)
+            {
+                std::uint64_t size = varint();
+                require(size);
+                value.assign(current, static_cast<std::size_t>(size));
+                current += size;
+            }
+        };
+
+        /* *************** Primitives *************** */
+        template<typename Archive>
+        void io(Archive& ar, bool& value)
+        {
+            ar.boolean(value);
+        }
+
+        template<typename Archive>
+        void io(Archive& ar, std::string& value)
+        {
+            ar.string(value);
+        }
+
+        template<typename Archive>
+        void io(Archive& ar, identifier& value)
+        {
+            ar.string(value.identifier_string);
+        }
+
+        void io(writer& ar, local_slot& value)
+        {
+            ar.varint(value);
+        }
+
+        void io(reader& ar, local_slot& value)
+        {
+            std::uint64_t slot = ar.varint();
+            if(slot > std::numeric_limits<local_slot>::max())
+            {
+                throw Error::Serialization_Error("Local slot out of range");
+            }
+            value = static_cast<local_slot>(slot);
+        }
+
+        // Tag types (operators, base types, access specifiers) carry no data;
+        // their identity is the variant index.
+        template<typename Archive, typename T>
+        typename std::enable_if<std::is_empty<T>::value>::type io(Archive&, T&)
+        {
+        }
+
+        // Recursive types, written below, but found by the containers
+        void io(writer& ar, type_expression& type);
+        void io(reader& ar, type_expression& type);
+        void io(writer& ar, expression& exp);
+        void io(reader& ar, expression& exp);
+        void io(writer& ar, statement& stm);
+        void io(reader& ar, statement& stm);
+
+        /* *************** Containers *************** */
+        template<typename T>
+        void io(writer& ar, std::list<T>& list)
+        {
+            ar.varint(list.size());
+            for(T& element : list)
+            {
+                io(ar, element);
+            }
+        }
+
+        template<typename T>
+        void io(reader& ar, std::list<T>& list)
+        {
+            std::size_t size = ar.count();
+            for(std::size_t x = 0; x < size; x++)
+            {
+                // Read in place, rather than moving the read element
+                list.emplace_back();
+                io(ar, list.back());
+            }
+        }
+
+        template<typename T>
+        void io(writer& ar, Maybe<T>& maybe)
+        {
+            bool present = static_cast<bool>(maybe);
+            ar.boolean(present);
+            if(present)
+            {
+                io(ar, *maybe);
+            }
+        }
+
+        template<typename T>
+        void io(reader& ar, Maybe<T>& maybe)
+        {
+            bool present;
+            ar.boolean(present);
+            if(present)
+            {
+                maybe = T();
+                io(ar, *maybe);
+            }
+        }
+
+        template<typename Archive, typename T1, typename T2>
+        void io(Archive& ar, std::pair<T1, T2>& pair)
+        {
+            io(ar, pair.first);
+            io(ar, pair.second);
+        }
+
+        /* *************** Variants *************** */
+        struct variant_writer : public boost::static_visitor<void>
+        {
+            writer& ar;
+
+            variant_writer(writer& ar) : ar(ar)
+            {
+            }
+
+            template<typename T>
+            void operator()(T const& alternative) const
+            {
+                // Writing never modifies the tree
+                io(ar, const_cast<T&>(alternative));
+            }
+        };
+
+        template<typename... Ts>
+        void io(writer& ar, algebraic_datatype<Ts...>& variant)
+        {
+            ar.varint(static_cast<std::uint64_t>(variant.which()));
+            boost::apply_visitor(variant_writer(ar), variant);
+        }
+
+        struct variant_reader : public boost::static_visitor<void>
+        {
+            reader& ar;
+
+            variant_reader(reader& ar) : ar(ar)
+            {
+            }
+
+            template<typename T>
+            void operator()(T& alternative) const
+            {
+                io(ar, alternative);
+            }
+        };
+
+        // Construct the default alternative at index, to be read in place
+        template<typename Variant>
+        void construct_alternative(Variant&, std::uint64_t)
+        {
+            throw Error::Serialization_Error("Invalid variant index");
+        }
+
+        template<typename Variant, typename T, typename... Ts>
+        void construct_alternative(Variant& variant, std::uint64_t index)
+        {
+            if(index != 0)
+            {
+                construct_alternative<Variant, Ts...>(variant, index - 1);
+                return;
+            }
+            variant = typename boost::unwrap_recursive<T>::type();
+        }
+
+        template<typename... Ts>
+        void io(reader& ar, algebraic_datatype<Ts...>& variant)
+        {
+            construct_alternative<algebraic_datatype<Ts...>, Ts...>(variant, ar.varint());
+            boost::apply_visitor(variant_reader(ar), variant);
+        }
+
+        /* *************** Names *************** */
+        // Names are written as their components, and re-interned when read
+        void io(writer& ar, name_simple& navn)
+        {
+            identifier component(name_component(navn.id));
+            io(ar, component);
+        }
+
+        void io(reader& ar, name_simple& navn)
+        {
+            identifier component;
+            io(ar, component);
+            navn = make_simple_name(std::move(component));
+        }
+
+        void io(writer& ar, name_qualified& navn)
+        {
+            std::list<identifier> components = name_to_identifier_list(navn);
+            io(ar, components);
+        }
+
+        void io(reader& ar, name_qualified& navn)
+        {
+            std::list<identifier> components;
+            io(ar, components);
+            navn = make_qualified_name(std::move(components));
+        }
+
+        /* *************** Type expressions *************** */
+        // Array types are written as an index per dimension, followed by the
+        // element type, as any variant; but read and written in a loop, such
+        // that deep array types don't recurse
+        template<typename Archive>
+        void io(Archive& ar, type_expression_named& x)
+        {
+            io(ar, x.type);
+        }
+
+        template<typename Archive>
+        void io(Archive& ar, type_expression_tarray& x)
+        {
+            io(ar, x.type);
+        }
+
+        void io(writer& ar, type_expression& type)
+        {
+            type_expression* element = &type;
+            while(type_expression_tarray* array = boost::get<type_expression_tarray>(element))
+            {
+                ar.varint(static_cast<std::uint64_t>(element->which()));
+                element = &array->type;
+            }
+            ar.varint(static_cast<std::uint64_t>(element->which()));
+            boost::apply_visitor(variant_writer(ar), *element);
+        }
+
+        void io(reader& ar, type_expression& type)
+        {
+            type_expression* element = &type;
+            while(true)
+            {
+                std::uint64_t index = ar.varint();
+                construct_alternative<type_expression, type_expression_base, type_expression_named,
+                                      algebraic_recursive<type_expression_tarray>>(*element, index);
+                type_expression_tarray* array = boost::get<type_expression_tarray>(element);
+                if(array == nullptr)
+                {
+                    boost::apply_visitor(variant_reader(ar), *element);
+                    return;
+                }
+                element = &array->type;
+            }
+        }
+
+        /* *************** Expressions and statements *************** */
+        // Nodes are written in the order the traversal (see ast_traversal.hpp)
+        // enters them, each as its index and its fields, but its subtrees;
+        // of lists and optionals of subtrees only the length and presence is
+        // written, as the subtrees follow the node. Reading walks the tree as
+        // it's built; entering a placeholder reads the node over it, after
+        // which the placeholders of its subtrees are entered. Neither
+        // recurses, such that trees of any depth can be cached.
+        template<typename T>
+        void shape(writer& ar, std::list<T>& list)
+        {
+            ar.varint(list.size());
+        }
+
+        template<typename T>
+        void shape(reader& ar, std::list<T>& list)
+        {
+            // Every subtree takes at least a byte
+            list.resize(ar.count());
+        }
+
+        void shape(writer& ar, Maybe<expression>& maybe)
+        {
+            bool present = static_cast<bool>(maybe);
+            ar.boolean(present);
+        }
+
+        void shape(reader& ar, Maybe<expression>& maybe)
+        {
+            bool present;
+            ar.boolean(present);
+            if(present)
+            {
+                maybe = expression();
+            }
+        }
+
+        void shape(writer& ar, std::list<Maybe<expression>>& list)
+        {
+            ar.varint(list.size());
+            for(Maybe<expression>& element : list)
+            {
+                shape(ar, element);
+            }
+        }
+
+        void shape(reader& ar, std::list<Maybe<expression>>& list)
+        {
+            std::size_t size = ar.count();
+            for(std::size_t x = 0; x < size; x++)
+            {
+                list.emplace_back();
+                shape(ar, list.back());
+            }
+        }
+
+        // The fields of each node, but its subtrees; leafs have nothing else
+        template<typename Archive, typename T>
+        typename std::enable_if<std::is_empty<T>::value>::type fields(Archive&, T&)
+        {
+        }
+
+        template<typename Archive, typename... Ts>
+        void fields(Archive& ar, algebraic_datatype<Ts...>& variant);
+
+        template<typename Archive>
+        void fields(Archive& ar, lvalue_ambiguous_name& x)
+        {
+            io(ar, x.ambiguous);
+        }
+
+        template<typename Archive>
+        void fields(Archive& ar, lvalue_local& x)
+        {
+            io(ar, x.name);
+            io(ar, x.slot);
+        }
+
+        template<typename Archive>
+        void fields(Archive& ar, lvalue_non_static_field& x)
+        {
+            io(ar, x.name);
+        }
+
+        template<typename Archive>
+        void fields(Archive&, lvalue_array&)
+        {
+        }
+
+        template<typename Archive>
+        void fields(Archive& ar, expression_integer_constant& x)
+        {
+            io(ar, x.value);
+        }
+
+        template<typename Archive>
+        void fields(Archive& ar, expression_character_constant& x)
+        {
+            io(ar, x.value);
+        }
+
+        template<typename Archive>
+        void fields(Archive& ar, expression_string_constant& x)
+        {
+            io(ar, x.value);
+        }
+
+        template<typename Archive>
+        void fields(Archive& ar, expression_boolean_constant& x)
+        {
+            io(ar, x.value);
+        }
+
+        template<typename Archive>
+        void fields(Archive& ar, expression_binop& x)
+        {
+            io(ar, x.operatur);
+        }
+
+        template<typename Archive>
+        void fields(Archive& ar, expression_unop& x)
+        {
+            io(ar, x.operatur);
+        }
+
+        template<typename Archive>
+        void fields(Archive& ar, expression_static_invoke& x)
+        {
+            io(ar, x.type);
+            io(ar, x.method_name);
+            shape(ar, x.arguments);
+        }
+
+        template<typename Archive>
+        void fields(Archive& ar, expression_non_static_invoke& x)
+        {
+            io(ar, x.method_name);
+            shape(ar, x.arguments);
+        }
+
+        template<typename Archive>
+        void fields(Archive& ar, expression_simple_invoke& x)
+        {
+            io(ar, x.method_name);
+            shape(ar, x.arguments);
+        }
+
+        template<typename Archive>
+        void fields(Archive& ar, expression_ambiguous_invoke& x)
+        {
+            io(ar, x.ambiguous);
+            io(ar, x.method_name);
+            shape(ar, x.arguments);
+        }
+
+        template<typename Archive>
+        void fields(Archive& ar, expression_new& x)
+        {
+            io(ar, x.type);
+            shape(ar, x.arguments);
+        }
+
+        template<typename Archive>
+        void fields(Archive& ar, expression_new_array& x)
+        {
+            io(ar, x.type);
+            shape(ar, x.arguments);
+        }
+
+        template<typename Archive>
+        void fields(Archive& ar, expression_lvalue& x)
+        {
+            fields(ar, x.variable);
+        }
+
+        template<typename Archive>
+        void fields(Archive& ar, expression_assignment& x)
+        {
+            fields(ar, x.variable);
+        }
+
+        template<typename Archive>
+        void fields(Archive& ar, expression_incdec& x)
+        {
+            fields(ar, x.variable);
+            io(ar, x.operatur);
+        }
+
+        template<typename Archive>
+        void fields(Archive& ar, expression_cast& x)
+        {
+            io(ar, x.type);
+        }
+
+        template<typename Archive>
+        void fields(Archive&, expression_ambiguous_cast&)
+        {
+        }
+
+        template<typename Archive>
+        void fields(Archive& ar, expression_instance_of& x)
+        {
+            io(ar, x.type);
+        }
+
+        template<typename Archive>
+        void fields(Archive&, expression_parentheses&)
+        {
+        }
+
+        template<typename Archive>
+        void fields(Archive&, statement_expression&)
+        {
+        }
+
+        template<typename Archive>
+        void fields(Archive&, statement_value_return&)
+        {
+        }
+
+        template<typename Archive>
+        void fields(Archive& ar, statement_local_declaration& x)
+        {
+            io(ar, x.type);
+            io(ar, x.name);
+            shape(ar, x.optional_initializer);
+        }
+
+        template<typename Archive>
+        void fields(Archive&, statement_throw&)
+        {
+        }
+
+        template<typename Archive>
+        void fields(Archive& ar, statement_super_call& x)
+        {
+            shape(ar, x.arguments);
+        }
+
+        template<typename Archive>
+        void fields(Archive& ar, statement_this_call& x)
+        {
+            shape(ar, x.arguments);
+        }
+
+        template<typename Archive>
+        void fields(Archive&, statement_if_then&)
+        {
+        }
+
+        template<typename Archive>
+        void fields(Archive&, statement_if_then_else&)
+        {
+        }
+
+        template<typename Archive>
+        void fields(Archive&, statement_while&)
+        {
+        }
+
+        template<typename Archive>
+        void fields(Archive& ar, statement_block& x)
+        {
+            shape(ar, x.body);
+        }
+
+        // Visitor reading or writing the fields of the alternative held
+        template<typename Archive>
+        struct fields_io : public boost::static_visitor<void>
+        {
+            Archive& ar;
+
+            fields_io(Archive& ar) : ar(ar)
+            {
+            }
+
+            template<typename T>
+            void operator()(T const& alternative) const
+            {
+                // Writing never modifies the tree, reading does
+                fields(ar, const_cast<T&>(alternative));
+            }
+        };
+
+        // A node (or lvalue) is its index, and its fields
+        template<typename... Ts>
+        void fields(writer& ar, algebraic_datatype<Ts...>& variant)
+        {
+            ar.varint(static_cast<std::uint64_t>(variant.which()));
+            boost::apply_visitor(fields_io<writer>(ar), variant);
+        }
+
+        template<typename... Ts>
+        void fields(reader& ar, algebraic_datatype<Ts...>& variant)
+        {
+            construct_alternative<algebraic_datatype<Ts...>, Ts...>(variant, ar.varint());
+            boost::apply_visitor(fields_io<reader>(ar), variant);
+        }
+
+        template<typename Root>
+        void walk(writer& ar, Root& root)
+        {
+            traversal callbacks;
+            callbacks.enter_expression = [&ar](expression const& exp) { fields(ar, const_cast<expression&>(exp)); };
+            callbacks.enter_statement  = [&ar](statement const& stm)  { fields(ar, const_cast<statement&>(stm)); };
+            traverse(static_cast<Root const&>(root), callbacks);
+        }
+
+        template<typename Root>
+        void walk(reader& ar, Root& root)
+        {
+            mutable_traversal callbacks;
+            callbacks.enter_expression = [&ar](expression& exp) { fields(ar, exp); };
+            callbacks.enter_statement  = [&ar](statement& stm)  { fields(ar, stm); };
+            traverse(root, callbacks);
+        }
+
+        void io(writer& ar, expression& exp)
+        {
+            walk(ar, exp);
+        }
+
+        void io(reader& ar, expression& exp)
+        {
+            walk(ar, exp);
+        }
+
+        void io(writer& ar, statement& stm)
+        {
+            walk(ar, stm);
+        }
+
+        void io(reader& ar, statement& stm)
+        {
+            walk(ar, stm);
+        }
+
+        /* *************** Declarations *************** */
+        // Fields are written in declaration order
+        template<typename Archive>
+        void io(Archive& ar, import_declaration_on_demand& x)
+        {
+            io(ar, x.import);
+        }
+
+        template<typename Archive>
+        void io(Archive& ar, import_declaration_single& x)
+        {
+            io(ar, x.import);
+            io(ar, x.class_name);
+        }
+
+        template<typename Archive>
+        void io(Archive& ar, field_declaration& x)
+        {
+            io(ar, x.access_type);
+            io(ar, x.is_static);
+            io(ar, x.is_final);
+            io(ar, x.type);
+            io(ar, x.name);
+            io(ar, x.optional_initializer);
+        }
+
+        template<typename Archive>
+        void io(Archive& ar, method_declaration& x)
+        {
+            io(ar, x.access_type);
+            io(ar, x.is_static);
+            io(ar, x.is_final);
+            io(ar, x.is_abstract);
+            io(ar, x.return_type);
+            io(ar, x.name);
+            io(ar, x.formal_parameters);
+            io(ar, x.throws);
+            io(ar, x.method_body);
+        }
+
+        template<typename Archive>
+        void io(Archive& ar, constructor_declaration& x)
+        {
+            io(ar, x.access_type);
+            io(ar, x.name);
+            io(ar, x.formal_parameters);
+            io(ar, x.throws);
+            io(ar, x.method_body);
+        }
+
+        template<typename Archive>
+        void io(Archive& ar, declaration_field& x)
+        {
+            io(ar, x.decl);
+        }
+
+        template<typename Archive>
+        void io(Archive& ar, declaration_method& x)
+        {
+            io(ar, x.decl);
+        }
+
+        template<typename Archive>
+        void io(Archive& ar, declaration_constructor& x)
+        {
+            io(ar, x.decl);
+        }
+
+        template<typename Archive>
+        void io(Archive& ar, class_declaration& x)
+        {
+            io(ar, x.is_final);
+            io(ar, x.is_abstract);
+            io(ar, x.name);
+            io(ar, x.extends);
+            io(ar, x.implements);
+            io(ar, x.members);
+        }
+
+        template<typename Archive>
+        void io(Archive& ar, interface_declaration& x)
+        {
+            io(ar, x.name);
+            io(ar, x.extends);
+            io(ar, x.members);
+        }
+
+        template<typename Archive>
+        void io(Archive& ar, source_file& x)
+        {
+            io(ar, x.name);
+            io(ar, x.package);
+            io(ar, x.imports);
+            io(ar, x.type);
+        }
+    }
+
+    void serialize(source_file const& sf, std::string& output)
+    {
+        writer ar{ output };
+        // Header
+        output.append(magic, sizeof(magic));
+        ar.varint(serialization_version);
+        // Writing never modifies the tree
+        io(ar, const_cast<source_file&>(sf));
+    }
+
+    source_file deserialize(char const* data, std::size_t size)
+    {
+        reader ar{ data, data + size };
+        // Check the header
+        ar.require(sizeof(magic));
+        if(std::memcmp(ar.current, magic, sizeof(magic)) != 0)
+        {
+            throw Error::Serialization_Error("Not a serialized source file");
+        }
+        ar.current += sizeof(magic);
+        if(ar.varint() != serialization_version)
+        {
+            throw Error::Serialization_Error("Unsupported format version");
+        }
+        // Read the source file
+        source_file sf;
+        io(ar, sf);
+        // There should be nothing left
+        if(ar.remaining() != 0)
+        {
+            throw Error::Serialization_Error("Trailing data after source file");
+        }
+        return sf;
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef _COMPILER_AST_SERIALIZE_HPP
+#define _COMPILER_AST_SERIALIZE_HPP
+
+#include "ast.hpp"
+
+#include <cstddef>
+#include <string>
+
+/************************************************************************/
+/** {2 Compact binary serialization of the AST}                         */
+/************************************************************************/
+// The format is position independent, such that it can be read directly
+// from a memory mapped file; variants are stored as their index followed by
+// the alternative, lists as their length followed by the elements, and
+// numbers and lengths as variable length integers. Expressions and
+// statements are stored in pre-order, such that neither writing nor reading
+// them recurses.
+// Names are stored as their components, and interned again when read.
+namespace Ast
+{
+    /** Bump when the AST, the format or the checks made while parsing change,
+     *  to invalidate old data */
+    const unsigned serialization_version = 6;
+
+    /** Append the binary form of the source file to output */
+    void serialize(source_file const& sf, std::string& output);
+    /** Read a source file back, throws Error::Serialization_Error if malformed */
+    source_file deserialize(char const* data, std::size_t size);
+}
+
+#endif //_COMPILER_AST_SERIALIZE_HPP
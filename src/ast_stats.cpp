@@ -0,0 +1,531 @@
+#include "ast_stats.hpp"
+
+#include "ast_traversal.hpp"
+
+// Enable declarations in case clauses, which are disabled by default
+#define XTL_CLAUSE_DECL 1
+
+#include "Match/match.hpp"
+
+#include <boost/core/demangle.hpp>
+#include <boost/variant.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+
+namespace Ast
+{
+    namespace
+    {
+        struct kind_stats
+        {
+            std::string kind;
+            std::size_t count;
+            std::size_t size_of;
+            std::size_t heap_bytes;
+        };
+
+        // The readable name of a node kind, i.e. 'expression_binop'
+        template<typename T>
+        std::string const& kind_name()
+        {
+            static const std::string name = []()
+            {
+                std::string demangled = boost::core::demangle(typeid(T).name());
+                // Strip our own namespace, wherever it occurs
+                const std::string prefix = "Ast::";
+                for(std::size_t found = demangled.find(prefix); found != std::string::npos; found = demangled.find(prefix))
+                {
+                    demangled.erase(found, prefix.size());
+                }
+                return demangled;
+            }();
+            return name;
+        }
+
+        // Whether T is one of Ts
+        template<typename T, typename... Ts>
+        struct is_one_of : std::false_type
+        {
+        };
+
+        template<typename T, typename U, typename... Ts>
+        struct is_one_of<T, U, Ts...>
+            : std::conditional<std::is_same<T, U>::value, std::true_type, is_one_of<T, Ts...>>::type
+        {
+        };
+
+        // Whether T is kept in a heap box (algebraic_recursive), inside Variant
+        template<typename Variant, typename T>
+        struct is_boxed;
+
+        template<typename T, typename... Ts>
+        struct is_boxed<algebraic_datatype<Ts...>, T> : is_one_of<algebraic_recursive<T>, Ts...>
+        {
+        };
+
+        template<typename Variant, typename T>
+        std::size_t box_bytes(T const&)
+        {
+            return is_boxed<Variant, T>::value ? sizeof(T) : 0;
+        }
+
+        // Each element of a std::list is allocated along with two links
+        template<typename T>
+        std::size_t list_bytes(std::list<T> const& list)
+        {
+            return list.size() * (sizeof(T) + 2 * sizeof(void*));
+        }
+
+        // Short strings are kept inside the string object, longer ones on the heap
+        std::size_t string_bytes(std::string const& str)
+        {
+            char const* object = reinterpret_cast<char const*>(&str);
+            char const* data   = str.data();
+            bool is_inline = std::less_equal<char const*>()(object, data) &&
+                             std::less<char const*>()(data, object + sizeof(str));
+            return is_inline ? 0 : str.capacity() + 1;
+        }
+
+        struct census;
+
+        // Visitor recording a single node of a variant, i.e. an expression
+        template<typename Variant>
+        struct node_recorder : boost::static_visitor<void>
+        {
+            census& stats;
+
+            node_recorder(census& stats)
+                : stats(stats)
+            {
+            }
+
+            template<typename T>
+            void operator()(T const& node) const;
+        };
+
+        struct census
+        {
+            std::unordered_map<std::type_index, kind_stats> kinds;
+
+            template<typename T>
+            void record(std::size_t heap_bytes)
+            {
+                auto inserted = kinds.emplace(std::type_index(typeid(T)), kind_stats{ kind_name<T>(), 0, sizeof(T), 0 });
+                kind_stats& stats = inserted.first->second;
+                stats.count++;
+                stats.heap_bytes += heap_bytes;
+            }
+
+            // Names and types
+            void count(identifier const& id)
+            {
+                record<identifier>(string_bytes(id.identifier_string));
+            }
+
+            // Names are only their id, the components are kept in the name table
+            void count(name const& navn)
+            {
+                Match(navn, void)
+                    Case(const name_simple&)
+                    {
+                        record<name_simple>(0);
+                    }
+                    Case(const name_qualified&)
+                    {
+                        record<name_qualified>(0);
+                    }
+                EndMatch;
+            }
+
+            void count(type_expression const& type)
+            {
+                // Array types may be nested arbitrarily deep, so loop through them
+                type_expression const* element = &type;
+                while(type_expression_tarray const* array = boost::get<type_expression_tarray>(element))
+                {
+                    record<type_expression_tarray>(sizeof(type_expression_tarray));
+                    element = &array->type;
+                }
+                Match(*element, void)
+                    Case(const type_expression_base& base)
+                    {
+                        node_recorder<type_expression_base> visitor(*this);
+                        boost::apply_visitor(visitor, base);
+                    }
+                    Case(const type_expression_named& named)
+                    {
+                        record<type_expression_named>(0);
+                        count(named.type);
+                    }
+                    Case(const type_expression_tarray&)
+                    {
+                    }
+                EndMatch;
+            }
+
+            // Heap owned by l-values, their expressions are counted by the traversal
+            std::size_t owned(lvalue const& variable)
+            {
+                return
+                Match(variable, std::size_t)
+                    // Names and locals are kept inline, fields and arrays boxed
+                    Case(const lvalue_ambiguous_name& navn)
+                    {
+                        record<lvalue_ambiguous_name>(0);
+                        count(navn.ambiguous);
+                        return 0;
+                    }
+                    Case(const lvalue_local& local)
+                    {
+                        record<lvalue_local>(0);
+                        count(local.name);
+                        return 0;
+                    }
+                    Case(const lvalue_non_static_field& field)
+                    {
+                        record<lvalue_non_static_field>(sizeof(field));
+                        count(field.name);
+                        return 0;
+                    }
+                    Case(const lvalue_array& array)
+                    {
+                        record<lvalue_array>(sizeof(array));
+                        return 0;
+                    }
+                EndMatch;
+            }
+
+            // Heap owned by expressions and statements, besides their sub-nodes
+            template<typename T>
+            std::size_t owned(T const&)
+            {
+                return 0;
+            }
+
+            std::size_t owned(expression_integer_constant const& exp)
+            {
+                return string_bytes(exp.value);
+            }
+
+            std::size_t owned(expression_string_constant const& exp)
+            {
+                return string_bytes(exp.value);
+            }
+
+            std::size_t owned(lvalue_ambiguous_name const& exp)
+            {
+                count(exp.ambiguous);
+                return 0;
+            }
+
+            std::size_t owned(lvalue_local const& exp)
+            {
+                count(exp.name);
+                return 0;
+            }
+
+            std::size_t owned(expression_static_invoke const& exp)
+            {
+                count(exp.type);
+                count(exp.method_name);
+                return list_bytes(exp.arguments);
+            }
+
+            std::size_t owned(expression_non_static_invoke const& exp)
+            {
+                count(exp.method_name);
+                return list_bytes(exp.arguments);
+            }
+
+            std::size_t owned(expression_simple_invoke const& exp)
+            {
+                count(exp.method_name);
+                return list_bytes(exp.arguments);
+            }
+
+            std::size_t owned(expression_ambiguous_invoke const& exp)
+            {
+                count(exp.ambiguous);
+                count(exp.method_name);
+                return list_bytes(exp.arguments);
+            }
+
+            std::size_t owned(expression_new const& exp)
+            {
+                count(exp.type);
+                return list_bytes(exp.arguments);
+            }
+
+            std::size_t owned(expression_new_array const& exp)
+            {
+                count(exp.type);
+                return list_bytes(exp.arguments);
+            }
+
+            std::size_t owned(expression_lvalue const& exp)
+            {
+                return owned(exp.variable);
+            }
+
+            std::size_t owned(expression_assignment const& exp)
+            {
+                return owned(exp.variable);
+            }
+
+            std::size_t owned(expression_incdec const& exp)
+            {
+                return owned(exp.variable);
+            }
+
+            std::size_t owned(expression_cast const& exp)
+            {
+                count(exp.type);
+                return 0;
+            }
+
+            std::size_t owned(expression_instance_of const& exp)
+            {
+                count(exp.type);
+                return 0;
+            }
+
+            std::size_t owned(statement_local_declaration const& stm)
+            {
+                count(stm.type);
+                count(stm.name);
+                return 0;
+            }
+
+            std::size_t owned(statement_super_call const& stm)
+            {
+                return list_bytes(stm.arguments);
+            }
+
+            std::size_t owned(statement_this_call const& stm)
+            {
+                return list_bytes(stm.arguments);
+            }
+
+            std::size_t owned(statement_block const& stm)
+            {
+                return list_bytes(stm.body);
+            }
+
+            // Expressions and statements, using the iterative traversal
+            traversal recorder()
+            {
+                traversal callbacks;
+                callbacks.enter_expression = [this](expression const& exp)
+                {
+                    node_recorder<expression> visitor(*this);
+                    boost::apply_visitor(visitor, exp);
+                };
+                callbacks.enter_statement = [this](statement const& stm)
+                {
+                    node_recorder<statement> visitor(*this);
+                    boost::apply_visitor(visitor, stm);
+                };
+                return callbacks;
+            }
+
+            void count(expression const& exp)
+            {
+                traverse(exp, recorder());
+            }
+
+            void count(body const& b)
+            {
+                traverse(b, recorder());
+            }
+
+            // Declarations
+            void count(std::list<formal_parameter> const& parameters)
+            {
+                for(auto& parameter : parameters)
+                {
+                    count(parameter.first);
+                    count(parameter.second);
+                }
+            }
+
+            void count(std::list<namedtype> const& names)
+            {
+                for(auto& navn : names)
+                {
+                    count(navn);
+                }
+            }
+
+            void count(declaration const& decl)
+            {
+                Match(decl, void)
+                    Case(const declaration_field& field)
+                    {
+                        field_declaration const& info = field.decl;
+                        record<declaration_field>(0);
+                        count(info.type);
+                        count(info.name);
+                        if(info.optional_initializer)
+                        {
+                            count(*info.optional_initializer);
+                        }
+                    }
+                    Case(const declaration_method& method)
+                    {
+                        method_declaration const& info = method.decl;
+                        std::size_t heap_bytes = list_bytes(info.formal_parameters) + list_bytes(info.throws);
+                        count(info.return_type);
+                        count(info.name);
+                        count(info.formal_parameters);
+                        count(info.throws);
+                        if(info.method_body)
+                        {
+                            heap_bytes += list_bytes(*info.method_body);
+                            count(*info.method_body);
+                        }
+                        record<declaration_method>(heap_bytes);
+                    }
+                    Case(const declaration_constructor& constructor)
+                    {
+                        constructor_declaration const& info = constructor.decl;
+                        std::size_t heap_bytes = list_bytes(info.formal_parameters) + list_bytes(info.throws);
+                        count(info.name);
+                        count(info.formal_parameters);
+                        count(info.throws);
+                        if(info.method_body)
+                        {
+                            heap_bytes += list_bytes(*info.method_body);
+                            count(*info.method_body);
+                        }
+                        record<declaration_constructor>(heap_bytes);
+                    }
+                EndMatch;
+            }
+
+            void count(std::list<declaration> const& members)
+            {
+                for(auto& member : members)
+                {
+                    count(member);
+                }
+            }
+
+            // Type declarations
+            void count(type_declaration const& type_decl)
+            {
+                Match(type_decl, void)
+                    Case(const type_declaration_class& klass)
+                    {
+                        record<type_declaration_class>(list_bytes(klass.implements) + list_bytes(klass.members));
+                        count(klass.name);
+                        count(klass.extends);
+                        count(klass.implements);
+                        count(klass.members);
+                    }
+                    Case(const type_declaration_interface& interface)
+                    {
+                        record<type_declaration_interface>(list_bytes(interface.extends) + list_bytes(interface.members));
+                        count(interface.name);
+                        count(interface.extends);
+                        count(interface.members);
+                    }
+                EndMatch;
+            }
+
+            // Imports
+            void count(import_declaration const& import)
+            {
+                Match(import, void)
+                    Case(const import_declaration_on_demand& import)
+                    {
+                        record<import_declaration_on_demand>(0);
+                        count(import.import);
+                    }
+                    Case(const import_declaration_single& import)
+                    {
+                        record<import_declaration_single>(0);
+                        count(import.import);
+                        count(import.class_name);
+                    }
+                EndMatch;
+            }
+
+            // Source files
+            void count(source_file const& sf)
+            {
+                // Each source file lives in a node of the program list
+                record<source_file>(sizeof(source_file) + 2 * sizeof(void*) + string_bytes(sf.name) + list_bytes(sf.imports));
+                if(sf.package)
+                {
+                    count(*sf.package);
+                }
+                for(auto& import : sf.imports)
+                {
+                    count(import);
+                }
+                count(sf.type);
+            }
+        };
+
+        template<typename Variant>
+        template<typename T>
+        void node_recorder<Variant>::operator()(T const& node) const
+        {
+            std::size_t heap_bytes = box_bytes<Variant>(node) + stats.owned(node);
+            stats.record<T>(heap_bytes);
+        }
+
+        void write_kind(std::ostream& output, kind_stats const& stats, double klocs)
+        {
+            output << "        { \"kind\": \"" << stats.kind << "\""
+                   << ", \"count\": " << stats.count
+                   << ", \"sizeof\": " << stats.size_of
+                   << ", \"heap_bytes\": " << stats.heap_bytes
+                   << ", \"bytes_per_kloc\": " << (klocs > 0 ? stats.heap_bytes / klocs : 0)
+                   << " }";
+        }
+    }
+
+    void write_ast_stats(program const& prog, std::size_t source_lines, std::ostream& output)
+    {
+        // Count every node in the program
+        census stats;
+        for(auto& file : prog)
+        {
+            stats.count(file);
+        }
+        // Sort the kinds, by the amount of memory they use
+        std::vector<kind_stats> kinds;
+        std::size_t total_bytes = sizeof(program);
+        for(auto& kind : stats.kinds)
+        {
+            kinds.push_back(kind.second);
+            total_bytes += kind.second.heap_bytes;
+        }
+        std::sort(kinds.begin(), kinds.end(), [](kind_stats const& a, kind_stats const& b)
+        {
+            return a.heap_bytes != b.heap_bytes ? a.heap_bytes > b.heap_bytes : a.kind < b.kind;
+        });
+        // And write them out as JSON
+        const double klocs = source_lines / 1000.0;
+        output << "{" << std::endl;
+        output << "    \"source_lines\": " << source_lines << "," << std::endl;
+        output << "    \"total_bytes\": " << total_bytes << "," << std::endl;
+        output << "    \"bytes_per_kloc\": " << (klocs > 0 ? total_bytes / klocs : 0) << "," << std::endl;
+        output << "    \"kinds\": [" << std::endl;
+        for(std::size_t n = 0; n < kinds.size(); n++)
+        {
+            write_kind(output, kinds[n], klocs);
+            output << (n + 1 < kinds.size() ? "," : "") << std::endl;
+        }
+        output << "    ]" << std::endl;
+        output << "}" << std::endl;
+    }
+}
@@ -0,0 +1,21 @@
+#ifndef _COMPILER_AST_STATS_HPP
+#define _COMPILER_AST_STATS_HPP
+
+#include "ast.hpp"
+
+#include <cstddef>
+#include <ostream>
+
+/************************************************************************/
+/** {2 Memory census of the AST}                                        */
+/************************************************************************/
+namespace Ast
+{
+    /** Write per node kind; instance count, sizeof, heap bytes and bytes per
+     *  KLOC of source, for the program, as JSON to output.
+     *  Heap bytes include std::list nodes, algebraic_recursive boxes and
+     *  std::string buffers owned by the node kind. */
+    void write_ast_stats(program const& prog, std::size_t source_lines, std::ostream& output);
+}
+
+#endif //_COMPILER_AST_STATS_HPP
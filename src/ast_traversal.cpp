@@ -0,0 +1,438 @@
+#include "ast_traversal.hpp"
+
+#include <type_traits>
+#include <vector>
+
+#include <boost/variant.hpp>
+
+namespace Ast
+{
+    namespace
+    {
+        // The walkers are shared between const and mutable trees; node<T>
+        // is T, const unless Mutable
+        template<bool Mutable, typename T>
+        using node = typename std::conditional<Mutable, T, T const>::type;
+
+        // A reference to either an expression or a statement in the tree
+        template<bool Mutable>
+        struct node_reference
+        {
+            node<Mutable, expression>* exp;
+            node<Mutable, statement>*  stm;
+        };
+
+        template<bool Mutable>
+        node_reference<Mutable> reference(node<Mutable, expression>& exp)
+        {
+            return { &exp, nullptr };
+        }
+
+        template<bool Mutable>
+        node_reference<Mutable> reference(node<Mutable, statement>& stm)
+        {
+            return { nullptr, &stm };
+        }
+
+        // Visitor appending the direct children of a node, left to right
+        template<bool Mutable>
+        struct child_collector : boost::static_visitor<void>
+        {
+            template<typename T>
+            using node = Ast::node<Mutable, T>;
+
+            std::vector<node_reference<Mutable>>& children;
+
+            child_collector(std::vector<node_reference<Mutable>>& children)
+                : children(children)
+            {
+            }
+
+            void add(node<expression>& exp) const
+            {
+                children.push_back(reference<Mutable>(exp));
+            }
+
+            void add(node<statement>& stm) const
+            {
+                children.push_back(reference<Mutable>(stm));
+            }
+
+            void add(node<Maybe<expression>>& exp) const
+            {
+                if(exp)
+                {
+                    add(*exp);
+                }
+            }
+
+            // Lists of either constness, the elements follow the list
+            template<typename T>
+            void add(std::list<T>& list) const
+            {
+                for(auto& element : list)
+                {
+                    add(element);
+                }
+            }
+
+            template<typename T>
+            void add(std::list<T> const& list) const
+            {
+                for(auto& element : list)
+                {
+                    add(element);
+                }
+            }
+
+            void add(node<lvalue>& variable) const
+            {
+                boost::apply_visitor(*this, variable);
+            }
+
+            // Leafs; constants, names and statements without sub-nodes
+            void operator()(node<expression_integer_constant>&) const {}
+            void operator()(node<expression_string_constant>&) const {}
+            void operator()(node<expression_boolean_constant>&) const {}
+            void operator()(node<expression_null>&) const {}
+            void operator()(node<expression_this>&) const {}
+            void operator()(node<lvalue_ambiguous_name>&) const {}
+            void operator()(node<lvalue_local>&) const {}
+            void operator()(node<statement_empty>&) const {}
+            void operator()(node<statement_void_return>&) const {}
+
+            // L-Values
+            void operator()(node<lvalue_non_static_field>& lvalue) const
+            {
+                add(lvalue.exp);
+            }
+
+            void operator()(node<lvalue_array>& lvalue) const
+            {
+                add(lvalue.array_exp);
+                add(lvalue.index_exp);
+            }
+
+            // Expressions
+            void operator()(node<expression_binop>& exp) const
+            {
+                add(exp.operand1);
+                add(exp.operand2);
+            }
+
+            void operator()(node<expression_unop>& exp) const
+            {
+                add(exp.operand);
+            }
+
+            void operator()(node<expression_static_invoke>& exp) const
+            {
+                add(exp.arguments);
+            }
+
+            void operator()(node<expression_non_static_invoke>& exp) const
+            {
+                add(exp.context);
+                add(exp.arguments);
+            }
+
+            void operator()(node<expression_simple_invoke>& exp) const
+            {
+                add(exp.arguments);
+            }
+
+            void operator()(node<expression_ambiguous_invoke>& exp) const
+            {
+                add(exp.arguments);
+            }
+
+            void operator()(node<expression_new>& exp) const
+            {
+                add(exp.arguments);
+            }
+
+            void operator()(node<expression_new_array>& exp) const
+            {
+                add(exp.context);
+                add(exp.arguments);
+            }
+
+            void operator()(node<expression_lvalue>& exp) const
+            {
+                add(exp.variable);
+            }
+
+            void operator()(node<expression_assignment>& exp) const
+            {
+                add(exp.variable);
+                add(exp.value);
+            }
+
+            void operator()(node<expression_incdec>& exp) const
+            {
+                add(exp.variable);
+            }
+
+            void operator()(node<expression_cast>& exp) const
+            {
+                add(exp.value);
+            }
+
+            void operator()(node<expression_ambiguous_cast>& exp) const
+            {
+                add(exp.type);
+                add(exp.value);
+            }
+
+            void operator()(node<expression_instance_of>& exp) const
+            {
+                add(exp.value);
+            }
+
+            void operator()(node<expression_parentheses>& exp) const
+            {
+                add(exp.inside);
+            }
+
+            // Statements
+            void operator()(node<statement_expression>& stm) const
+            {
+                add(stm.value);
+            }
+
+            void operator()(node<statement_value_return>& stm) const
+            {
+                add(stm.value);
+            }
+
+            void operator()(node<statement_local_declaration>& stm) const
+            {
+                add(stm.optional_initializer);
+            }
+
+            void operator()(node<statement_throw>& stm) const
+            {
+                add(stm.throwee);
+            }
+
+            void operator()(node<statement_super_call>& stm) const
+            {
+                add(stm.arguments);
+            }
+
+            void operator()(node<statement_this_call>& stm) const
+            {
+                add(stm.arguments);
+            }
+
+            void operator()(node<statement_if_then>& stm) const
+            {
+                add(stm.condition);
+                add(stm.true_statement);
+            }
+
+            void operator()(node<statement_if_then_else>& stm) const
+            {
+                add(stm.condition);
+                add(stm.true_statement);
+                add(stm.false_statement);
+            }
+
+            void operator()(node<statement_while>& stm) const
+            {
+                add(stm.condition);
+                add(stm.loop_statement);
+            }
+
+            void operator()(node<statement_block>& stm) const
+            {
+                add(stm.body);
+            }
+        };
+
+        template<bool Mutable>
+        void collect_children(node_reference<Mutable> node, std::vector<node_reference<Mutable>>& children)
+        {
+            child_collector<Mutable> collector(children);
+            if(node.exp)
+            {
+                boost::apply_visitor(collector, *node.exp);
+            }
+            else
+            {
+                boost::apply_visitor(collector, *node.stm);
+            }
+        }
+
+        // An entry on the explicit traversal stack
+        template<bool Mutable>
+        struct traversal_frame
+        {
+            node_reference<Mutable> node;
+            // Whether the children have already been pushed
+            bool expanded;
+        };
+
+        // Callbacks is traversal for const trees, and mutable_traversal for
+        // mutable ones; children are collected after entering a node, so an
+        // enter callback replacing the node has the replacement walked
+        template<bool Mutable, typename Callbacks>
+        void traverse(std::vector<node_reference<Mutable>> roots, Callbacks const& callbacks)
+        {
+            // Only keep frames around for leaving, if anyone is listening
+            const bool track_leave = callbacks.leave_expression || callbacks.leave_statement;
+
+            std::vector<traversal_frame<Mutable>> stack;
+            std::vector<node_reference<Mutable>> children;
+            // Push the roots, in reverse, such that the first is on top
+            for(auto it = roots.rbegin(); it != roots.rend(); ++it)
+            {
+                stack.push_back({ *it, false });
+            }
+
+            while(stack.empty() == false)
+            {
+                traversal_frame<Mutable> frame = stack.back();
+                stack.pop_back();
+                // All children are done, we're leaving the node
+                if(frame.expanded)
+                {
+                    if(frame.node.exp && callbacks.leave_expression)
+                    {
+                        callbacks.leave_expression(*frame.node.exp);
+                    }
+                    else if(frame.node.stm && callbacks.leave_statement)
+                    {
+                        callbacks.leave_statement(*frame.node.stm);
+                    }
+                    continue;
+                }
+                // We're entering the node
+                if(frame.node.exp && callbacks.enter_expression)
+                {
+                    callbacks.enter_expression(*frame.node.exp);
+                }
+                else if(frame.node.stm && callbacks.enter_statement)
+                {
+                    callbacks.enter_statement(*frame.node.stm);
+                }
+                // Revisit the node once its children are done
+                if(track_leave)
+                {
+                    stack.push_back({ frame.node, true });
+                }
+                // Push the children, in reverse, such that the first is on top
+                children.clear();
+                collect_children(frame.node, children);
+                for(auto it = children.rbegin(); it != children.rend(); ++it)
+                {
+                    stack.push_back({ *it, false });
+                }
+            }
+        }
+
+        void dismantle(std::vector<node_reference<true>> roots)
+        {
+            // Collect every node in pre-order, that is every parent before its children
+            std::vector<node_reference<true>> nodes;
+            mutable_traversal collect;
+            collect.enter_expression = [&nodes](expression& exp) { nodes.push_back(reference<true>(exp)); };
+            collect.enter_statement  = [&nodes](statement& stm)  { nodes.push_back(reference<true>(stm)); };
+            traverse(roots, collect);
+            // Reset the nodes in reverse pre-order, at which point all children of
+            // a node have already been reset to leafs, making each reset shallow.
+            for(auto it = nodes.rbegin(); it != nodes.rend(); ++it)
+            {
+                if(it->exp)
+                {
+                    *it->exp = expression_null();
+                }
+                else
+                {
+                    *it->stm = statement_empty();
+                }
+            }
+        }
+
+        template<bool Mutable>
+        std::vector<node_reference<Mutable>> body_roots(node<Mutable, body>& b)
+        {
+            std::vector<node_reference<Mutable>> roots;
+            for(auto& stm : b)
+            {
+                roots.push_back(reference<Mutable>(stm));
+            }
+            return roots;
+        }
+    }
+
+    void traverse(expression const& exp, traversal const& callbacks)
+    {
+        traverse(std::vector<node_reference<false>>{ reference<false>(exp) }, callbacks);
+    }
+
+    void traverse(statement const& stm, traversal const& callbacks)
+    {
+        traverse(std::vector<node_reference<false>>{ reference<false>(stm) }, callbacks);
+    }
+
+    void traverse(body const& b, traversal const& callbacks)
+    {
+        traverse(body_roots<false>(b), callbacks);
+    }
+
+    void traverse(expression& exp, mutable_traversal const& callbacks)
+    {
+        traverse(std::vector<node_reference<true>>{ reference<true>(exp) }, callbacks);
+    }
+
+    void traverse(statement& stm, mutable_traversal const& callbacks)
+    {
+        traverse(std::vector<node_reference<true>>{ reference<true>(stm) }, callbacks);
+    }
+
+    void traverse(body& b, mutable_traversal const& callbacks)
+    {
+        traverse(body_roots<true>(b), callbacks);
+    }
+
+    void dismantle(expression& exp)
+    {
+        dismantle(std::vector<node_reference<true>>{ reference<true>(exp) });
+    }
+
+    void dismantle(statement& stm)
+    {
+        dismantle(std::vector<node_reference<true>>{ reference<true>(stm) });
+    }
+
+    void dismantle(body& b)
+    {
+        dismantle(body_roots<true>(b));
+    }
+
+    // The owners, declared in ast.hpp
+    field_declaration::~field_declaration()
+    {
+        if(optional_initializer)
+        {
+            dismantle(*optional_initializer);
+        }
+    }
+
+    method_declaration::~method_declaration()
+    {
+        if(method_body)
+        {
+            dismantle(*method_body);
+        }
+    }
+
+    constructor_declaration::~constructor_declaration()
+    {
+        if(method_body)
+        {
+            dismantle(*method_body);
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef _COMPILER_AST_TRAVERSAL_HPP
+#define _COMPILER_AST_TRAVERSAL_HPP
+
+#include "ast.hpp"
+
+#include <functional>
+
+/************************************************************************/
+/** {2 Iterative traversal of expressions and statements}               */
+/************************************************************************/
+// The walkers in here keep their work list on the heap, rather than on
+// the native call stack; this way expression chains millions of
+// operators deep, can be processed without overflowing the stack.
+namespace Ast
+{
+    /** {3 Traversal callbacks} */
+    /** Callbacks invoked during traversal, empty callbacks are skipped */
+    struct traversal
+    {
+        // Invoked before the children of a node are visited
+        std::function<void(expression const&)> enter_expression;
+        std::function<void(statement const&)>  enter_statement;
+        // Invoked after the children of a node have been visited
+        std::function<void(expression const&)> leave_expression;
+        std::function<void(statement const&)>  leave_statement;
+    };
+
+    /** The same, for trees which are changed while walked; an enter callback
+     *  may replace the node, in which case the children of the replacement
+     *  are walked */
+    struct mutable_traversal
+    {
+        std::function<void(expression&)> enter_expression;
+        std::function<void(statement&)>  enter_statement;
+        std::function<void(expression&)> leave_expression;
+        std::function<void(statement&)>  leave_statement;
+    };
+
+    /** {3 Traversal} */
+    /** Walk the tree depth-first, left to right, invoking the callbacks */
+    void traverse(expression const& exp, traversal const& callbacks);
+    void traverse(statement const& stm, traversal const& callbacks);
+    void traverse(body const& b, traversal const& callbacks);
+    void traverse(expression& exp, mutable_traversal const& callbacks);
+    void traverse(statement& stm, mutable_traversal const& callbacks);
+    void traverse(body& b, mutable_traversal const& callbacks);
+
+    /** {3 Teardown} */
+    /** Destroy the tree bottom-up, leaving a leaf node in the root */
+    // Destruction of algebraic_recursive members recurses once per level,
+    // calling these prior to letting a deep tree go out of scope avoids it.
+    // The declarations owning initializers and bodies call them as they're
+    // destroyed; trees held elsewhere must be dismantled by their owner.
+    void dismantle(expression& exp);
+    void dismantle(statement& stm);
+    void dismantle(body& b);
+}
+
+#endif //_COMPILER_AST_TRAVERSAL_HPP
@@ -0,0 +1,305 @@
+#include "ast_types.hpp"
+
+#include "ast_names.hpp"
+#include "ast_helper.hpp"
+
+#include <atomic>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+#include <unordered_map>
+
+namespace Ast
+{
+    namespace
+    {
+        // A type is its kind, and a payload; the element type for arrays,
+        // the interned name for named types, and nothing for base types.
+        // Each type also caches the id of the array of it, such that the
+        // parallel type checking finds array types without taking the lock.
+        struct type_node
+        {
+            type_kind kind;
+            std::uint32_t payload;
+            // void is never an element type, so it's the id for 'none yet'
+            std::atomic<type_id> array_of;
+        };
+
+        std::uint64_t type_key(type_kind kind, std::uint32_t payload)
+        {
+            return (static_cast<std::uint64_t>(kind) << 32) | payload;
+        }
+
+        // Nodes are kept in chunks which never move, such that they can be
+        // read without taking the lock (i.e. by the parallel type checking);
+        // a type id is only handed out after its node has been written
+        const std::size_t chunk_bits = 12;
+        const std::size_t chunk_size = std::size_t(1) << chunk_bits;
+        const std::size_t max_chunks = std::size_t(1) << 16;
+
+        struct type_table
+        {
+            std::mutex lock;
+            std::size_t size;
+            std::unique_ptr<std::atomic<type_node*>[]> chunks;
+            std::vector<std::unique_ptr<type_node[]>> owned_chunks;
+            std::unordered_map<std::uint64_t, type_id> index;
+
+            type_table()
+                : size(0), chunks(new std::atomic<type_node*>[max_chunks])
+            {
+                for(std::size_t n = 0; n < max_chunks; n++)
+                {
+                    chunks[n].store(nullptr, std::memory_order_relaxed);
+                }
+                // Add the base types, in the order of their fixed ids
+                for(type_kind kind : { type_kind_void, type_kind_byte, type_kind_short, type_kind_int, type_kind_char, type_kind_boolean })
+                {
+                    index.emplace(type_key(kind, 0), static_cast<type_id>(size));
+                    push_back(kind, 0);
+                }
+            }
+
+            // Requires the lock to be held
+            void push_back(type_kind kind, std::uint32_t payload)
+            {
+                std::size_t chunk = size >> chunk_bits;
+                if(chunk == max_chunks)
+                {
+                    throw std::length_error("Type table is full");
+                }
+                if((size & (chunk_size - 1)) == 0)
+                {
+                    owned_chunks.emplace_back(new type_node[chunk_size]);
+                    chunks[chunk].store(owned_chunks.back().get(), std::memory_order_release);
+                }
+                type_node& node = chunks[chunk].load(std::memory_order_relaxed)[size & (chunk_size - 1)];
+                node.kind = kind;
+                node.payload = payload;
+                node.array_of.store(void_type_id, std::memory_order_relaxed);
+                size++;
+            }
+        };
+
+        type_table& table()
+        {
+            static type_table types;
+            return types;
+        }
+
+        type_id intern(type_kind kind, std::uint32_t payload)
+        {
+            type_table& types = table();
+            std::lock_guard<std::mutex> guard(types.lock);
+            // Check if we've already got it
+            std::uint64_t key = type_key(kind, payload);
+            auto found = types.index.find(key);
+            if(found != types.index.end())
+            {
+                return found->second;
+            }
+            // If not, add it
+            type_id id = static_cast<type_id>(types.size);
+            types.push_back(kind, payload);
+            types.index.emplace(key, id);
+            return id;
+        }
+
+        // Lock free, ids are only obtained once their node is written
+        type_node& node(type_id type)
+        {
+            type_node* chunk = table().chunks[type >> chunk_bits].load(std::memory_order_acquire);
+            return chunk[type & (chunk_size - 1)];
+        }
+    }
+
+    type_id intern_type(type_expression_base const& type)
+    {
+        return
+        Match(type, type_id)
+            Case(base_type_void    const&)
+            {
+                return void_type_id;
+            }
+            Case(base_type_byte    const&)
+            {
+                return byte_type_id;
+            }
+            Case(base_type_short   const&)
+            {
+                return short_type_id;
+            }
+            Case(base_type_int     const&)
+            {
+                return int_type_id;
+            }
+            Case(base_type_char    const&)
+            {
+                return char_type_id;
+            }
+            Case(base_type_boolean const&)
+            {
+                return boolean_type_id;
+            }
+        EndMatch;
+    }
+
+    type_id intern_type(type_expression const& type)
+    {
+        // Peel off the array dimensions in a loop, rather than by recursion,
+        // as array types may be nested arbitrarily deep.
+        unsigned dimensions = 0;
+        type_expression const* element = &type;
+        while(type_expression_tarray const* array = boost::get<type_expression_tarray>(element))
+        {
+            element = &array->type;
+            dimensions++;
+        }
+        // Intern the element type
+        type_id id =
+        Match(*element, type_id)
+            Case(type_expression_base const& base)
+            {
+                return intern_type(base);
+            }
+            Case(type_expression_named const& named)
+            {
+                return named_type(name_to_id(named.type));
+            }
+            Case(type_expression_tarray const&)
+            {
+                // Peeled off above
+                return void_type_id;
+            }
+        EndMatch;
+        // And wrap it in the dimensions
+        for(unsigned n = 0; n < dimensions; n++)
+        {
+            id = array_type(id);
+        }
+        return id;
+    }
+
+    type_id named_type(name_id navn)
+    {
+        return intern(type_kind_named, navn);
+    }
+
+    type_id array_type(type_id element)
+    {
+        // Racing threads intern the same id, so either may fill in the cache
+        std::atomic<type_id>& array_of = node(element).array_of;
+        type_id array = array_of.load(std::memory_order_acquire);
+        if(array == void_type_id)
+        {
+            array = intern(type_kind_array, element);
+            array_of.store(array, std::memory_order_release);
+        }
+        return array;
+    }
+
+    type_kind type_id_kind(type_id type)
+    {
+        return node(type).kind;
+    }
+
+    bool is_base_type_id(type_id type)
+    {
+        return type <= boolean_type_id;
+    }
+
+    type_id array_element(type_id type)
+    {
+        return node(type).payload;
+    }
+
+    name_id type_name(type_id type)
+    {
+        return node(type).payload;
+    }
+
+    std::string type_id_to_string(type_id type)
+    {
+        // Count the dimensions, down to the element type
+        unsigned dimensions = 0;
+        type_node const* element = &node(type);
+        while(element->kind == type_kind_array)
+        {
+            element = &node(element->payload);
+            dimensions++;
+        }
+        // Print the element type
+        std::string output_type;
+        switch(element->kind)
+        {
+            case type_kind_void:
+                output_type = "void";
+                break;
+            case type_kind_byte:
+                output_type = "byte";
+                break;
+            case type_kind_short:
+                output_type = "short";
+                break;
+            case type_kind_int:
+                output_type = "int";
+                break;
+            case type_kind_char:
+                output_type = "char";
+                break;
+            case type_kind_boolean:
+                output_type = "boolean";
+                break;
+            case type_kind_named:
+                output_type = name_id_to_string(element->payload);
+                break;
+            case type_kind_array:
+                break;
+        }
+        // Followed by a pair of brackets per dimension
+        output_type.reserve(output_type.size() + 2 * dimensions);
+        for(unsigned n = 0; n < dimensions; n++)
+        {
+            output_type.append("[]");
+        }
+        return output_type;
+    }
+
+    std::size_t type_count()
+    {
+        type_table& types = table();
+        std::lock_guard<std::mutex> guard(types.lock);
+        return types.size;
+    }
+
+    void truncate_types(std::size_t count)
+    {
+        type_table& types = table();
+        std::lock_guard<std::mutex> guard(types.lock);
+        if(count <= boolean_type_id || count >= types.size)
+        {
+            return;
+        }
+        for(auto it = types.index.begin(); it != types.index.end();)
+        {
+            it = (it->second >= count) ? types.index.erase(it) : std::next(it);
+        }
+        // Forget the arrays of kept types, which are dropped
+        for(type_id type = 0; type < count; type++)
+        {
+            if(node(type).array_of.load(std::memory_order_relaxed) >= count)
+            {
+                node(type).array_of.store(void_type_id, std::memory_order_relaxed);
+            }
+        }
+        std::size_t chunks = (count + chunk_size - 1) >> chunk_bits;
+        for(std::size_t chunk = chunks; chunk < types.owned_chunks.size(); chunk++)
+        {
+            types.chunks[chunk].store(nullptr, std::memory_order_relaxed);
+        }
+        types.owned_chunks.resize(chunks);
+        types.size = count;
+    }
+}
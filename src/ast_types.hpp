@@ -0,0 +1,86 @@
+#ifndef _COMPILER_AST_TYPES_HPP
+#define _COMPILER_AST_TYPES_HPP
+
+#include "ast.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/************************************************************************/
+/** {2 Global table of hash-consed types}                               */
+/************************************************************************/
+// Every distinct type exists exactly once in the table, and is referred to
+// by a type_id; two types are equal, if and only if their ids are equal.
+// Array types refer to their element type by id, and named types refer to
+// their interned name (see ast_names.hpp), such that 'Foo[][]' is stored as
+// array(array(named(Foo))), sharing 'Foo[]' and 'Foo' with other types.
+//
+// The table is a side structure; the tree keeps the type_expressions the
+// parser built, as a named type there is still the name as written, which
+// only means a type once it has been resolved in the scope of its file.
+// Phases after name resolution convert the types they need (resolve_type
+// in the type checker), and work on the ids from then on.
+namespace Ast
+{
+    using type_id = std::uint32_t;
+
+    enum type_kind
+    {
+        // Base types
+        type_kind_void,
+        type_kind_byte,
+        type_kind_short,
+        type_kind_int,
+        type_kind_char,
+        type_kind_boolean,
+        // Composite types
+        type_kind_named,
+        type_kind_array
+    };
+
+    /** The base types are always in the table, with fixed ids */
+    const type_id void_type_id    = type_kind_void;
+    const type_id byte_type_id    = type_kind_byte;
+    const type_id short_type_id   = type_kind_short;
+    const type_id int_type_id     = type_kind_int;
+    const type_id char_type_id    = type_kind_char;
+    const type_id boolean_type_id = type_kind_boolean;
+
+    /** {3 Interning} */
+    /** Get the id of a type, interning it, if it's not already there */
+    type_id intern_type(type_expression const& type);
+    type_id intern_type(type_expression_base const& type);
+    type_id named_type(name_id navn);
+    /** Lock free, once the array of element has been interned */
+    type_id array_type(type_id element);
+
+    /** {3 Queries} */
+    // Queries don't take the lock of the table, such that concurrent phases
+    // can query types freely
+    type_kind type_id_kind(type_id type);
+    bool is_base_type_id(type_id type);
+    /** Get the element type of an array type */
+    type_id array_element(type_id type);
+    /** Get the name of a named type */
+    name_id type_name(type_id type);
+    /** Convert a type to its string representation, i.e. 'java.lang.Object[]' */
+    std::string type_id_to_string(type_id type);
+
+    /** {3 Truncation} */
+    /** Get the number of types in the table; later types get larger ids */
+    std::size_t type_count();
+    /** Drop the types interned after the first count (never the base types),
+     *  as truncate_names does for names; types naming the names dropped by
+     *  it must be dropped along with them */
+    void truncate_types(std::size_t count);
+
+    /** {3 Caching} */
+    /** Key for caches over pairs of types, i.e. the assignability relation */
+    inline std::uint64_t type_pair_key(type_id from, type_id to)
+    {
+        return (static_cast<std::uint64_t>(from) << 32) | to;
+    }
+}
+
+#endif //_COMPILER_AST_TYPES_HPP
@@ -0,0 +1,188 @@
+#include "batch.hpp"
+
+#include "compiler.hpp"
+#include "output_sink.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <fstream>
+#include <cctype>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace Batch
+{
+    bool split_arguments(std::string const& line, std::vector<std::string>& arguments)
+    {
+        std::string::size_type at = 0;
+        while (true)
+        {
+            while (at < line.size() && std::isspace(static_cast<unsigned char>(line[at])))
+            {
+                at++;
+            }
+            if (at == line.size())
+            {
+                return true;
+            }
+            // An argument runs to the next whitespace outside of quotes
+            std::string argument;
+            bool quoted = false;
+            for (; at < line.size() && (quoted || !std::isspace(static_cast<unsigned char>(line[at]))); at++)
+            {
+                if (line[at] == '"')
+                {
+                    quoted = !quoted;
+                }
+                else if (quoted && line[at] == '\\' && at + 1 < line.size() &&
+                         (line[at + 1] == '"' || line[at + 1] == '\\'))
+                {
+                    argument += line[++at];
+                }
+                else
+                {
+                    argument += line[at];
+                }
+            }
+            if (quoted)
+            {
+                return false;
+            }
+            arguments.push_back(std::move(argument));
+        }
+    }
+
+    namespace
+    {
+        struct program
+        {
+            // The line of the manifest, for reporting
+            std::string line;
+            std::vector<std::string> arguments;
+            // Filled in by the compile
+            int status;
+            std::string output;
+        };
+
+        bool read_manifest(std::string const& manifest, std::vector<program>& programs)
+        {
+            std::ifstream input(manifest);
+            if (!input.is_open())
+            {
+                std::cerr << "Couldn't open manifest: " << manifest << std::endl;
+                return false;
+            }
+            std::string line;
+            while (std::getline(input, line))
+            {
+                std::vector<std::string> arguments;
+                if (!split_arguments(line, arguments))
+                {
+                    std::cerr << "Unterminated quote in manifest line: " << line << std::endl;
+                    return false;
+                }
+                if (arguments.empty() || arguments[0][0] == '#')
+                {
+                    continue;
+                }
+                // Programs run concurrently already, so each runs its own
+                // phases on a single thread (unless told otherwise)
+                if (std::find_if(arguments.begin(), arguments.end(), [](std::string const& argument){ return argument.compare(0, 6, "--jobs") == 0; }) == arguments.end())
+                {
+                    arguments.insert(arguments.begin(), { "--jobs", "1" });
+                }
+                programs.push_back({ line, std::move(arguments), 0, std::string() });
+            }
+            return true;
+        }
+
+        std::string directory_of(std::string const& path)
+        {
+            std::string::size_type slash = path.rfind('/');
+            if (slash == std::string::npos)
+            {
+                return "";
+            }
+            return path.substr(0, slash == 0 ? 1 : slash);
+        }
+    }
+
+    int run_batch(std::string const& manifest, unsigned threads)
+    {
+        std::vector<program> programs;
+        if (!read_manifest(manifest, programs))
+        {
+            return -1;
+        }
+        std::string const working_directory = directory_of(manifest);
+
+        // Compile the programs on a pool of workers, each taking the next
+        // program, until none are left
+        std::atomic<std::size_t> next_program(0);
+        auto worker = [&]()
+        {
+            for (std::size_t n = next_program++; n < programs.size(); n = next_program++)
+            {
+                Trace::span span("program", "batch", programs[n].line);
+                output_sink out(programs[n].output);
+                try
+                {
+                    programs[n].status = compile(programs[n].arguments, working_directory, out);
+                }
+                catch(std::exception& e)
+                {
+                    // Report errors compile() lets through, rather than take
+                    // the batch down along with the other programs
+                    out << "Internal error: " << e.what() << '\n';
+                    programs[n].status = -1;
+                }
+            }
+        };
+        if (threads == 0)
+        {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        std::vector<std::thread> workers;
+        for (unsigned x = 1; x < std::min<std::size_t>(threads, programs.size()); x++)
+        {
+            workers.emplace_back(worker);
+        }
+        // This thread works too
+        worker();
+        for (std::thread& thread : workers)
+        {
+            thread.join();
+        }
+
+        // Output the programs in order, and then the summary
+        output_sink out(stdout);
+        for (program const& p : programs)
+        {
+            out << "=== " << p.line << '\n';
+            out << p.output;
+            if (p.output.empty() == false && p.output.back() != '\n')
+            {
+                out << '\n';
+            }
+        }
+        out << "Batch summary:" << '\n';
+        std::size_t passed = 0;
+        for (program const& p : programs)
+        {
+            if (p.status == 0)
+            {
+                out << "  PASS " << p.line << '\n';
+                passed++;
+            }
+            else
+            {
+                out << "  FAIL (" << p.status << ") " << p.line << '\n';
+            }
+        }
+        out << passed << " of " << programs.size() << " programs passed" << '\n';
+        return passed == programs.size() ? 0 : -1;
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef _COMPILER_BATCH_HPP
+#define _COMPILER_BATCH_HPP
+
+#include <string>
+#include <vector>
+
+/************************************************************************/
+/** {2 Batch compilation}                                               */
+/************************************************************************/
+// Compiles many independent programs in one process, such that the start up
+// cost, and the lexer and grammar instances, are shared between them.
+//
+// The manifest holds one program per line; the arguments of its compile,
+// seperated by whitespace (i.e. "--debug-file lexer A.java B.java"). An
+// argument holding whitespace is double quoted, with '\' escaping quotes and
+// backslashes inside (i.e. "My Files/A.java"). Blank lines, and lines starting
+// with '#' are skipped, and relative paths are resolved against the directory
+// of the manifest.
+namespace Batch
+{
+    /** Split a line of the manifest into arguments, returning false if a
+     *  quote is left open. */
+    bool split_arguments(std::string const& line, std::vector<std::string>& arguments);
+
+    /** Compile the programs of the manifest, using threads worker threads,
+     *  print the output of each program in manifest order followed by a
+     *  summary, and return 0 if every program compiled. */
+    int run_batch(std::string const& manifest, unsigned threads);
+}
+
+#endif //_COMPILER_BATCH_HPP
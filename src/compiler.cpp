@@ -0,0 +1,624 @@
+#include "compiler.hpp"
+
+#include "ast.hpp"
+#include "ast_pp.hpp"
+#include "ast_stats.hpp"
+#include "ast_dependencies.hpp"
+#include "ast_cache.hpp"
+#include "phases.hpp"
+#include "metrics.hpp"
+#include "trace.hpp"
+#include "grammar_profile.hpp"
+#include "weeder.hpp"
+#include "ast_locals.hpp"
+#include "hierarchy.hpp"
+#include "type_checker.hpp"
+#include "library_snapshot.hpp"
+#include "ast_names.hpp"
+#include "ast_types.hpp"
+
+#include "utility.hpp"
+
+#include "ast_generate.hpp"
+#include "Error.hpp"
+
+#include "Lexer_debug.hpp"
+
+#include <cstdio>
+#include <condition_variable>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <algorithm>
+
+#include <boost/program_options.hpp>
+namespace po = boost::program_options;
+
+namespace
+{
+    ///////////////////////////////////////////////////////////////////////////////
+    //  Helper function reading a file into a string
+    ///////////////////////////////////////////////////////////////////////////////
+    Maybe<std::string> read_from_file(std::string infile)
+    {
+        Trace::span span("read file", "io", infile);
+        std::ifstream instream(infile);
+        if (!instream.is_open()) {
+            return Maybe<std::string>();
+        }
+        instream.unsetf(std::ios::skipws);      // No white space skipping!
+        return std::string(std::istreambuf_iterator<char>(instream.rdbuf()),
+                           std::istreambuf_iterator<char>());
+    }
+
+    // Resolve path relative to the working directory of the caller
+    std::string resolve_path(std::string const& working_directory, std::string const& path)
+    {
+        if (working_directory.empty() || (path.empty() == false && path[0] == '/'))
+        {
+            return path;
+        }
+        return working_directory + "/" + path;
+    }
+
+    // The name and type tables are process wide, and only ever grow; in the
+    // compile server (or a batch) they're truncated back to what they held at
+    // the first compile, once they've grown past these, by a compile running
+    // alone
+    const std::size_t max_names = std::size_t(1) << 20;
+    const std::size_t max_types = std::size_t(1) << 20;
+
+    struct table_sizes
+    {
+        std::size_t names;
+        std::size_t types;
+    };
+
+    // What the tables held at the first compile, along with the names the
+    // phases hold on to for good (see hierarchy.cpp and type_scope.cpp)
+    table_sizes const& initial_tables()
+    {
+        static table_sizes const sizes = []
+        {
+            Ast::intern_name({ Ast::identifier("java"), Ast::identifier("lang"), Ast::identifier("Object") });
+            return table_sizes{ Ast::name_count(), Ast::type_count() };
+        }();
+        return sizes;
+    }
+
+    bool tables_full()
+    {
+        return Ast::name_count() > max_names || Ast::type_count() > max_types;
+    }
+
+    // Requires the compile to run alone; the library snapshots go as well, as
+    // they hold on to names
+    void truncate_tables()
+    {
+        table_sizes const& sizes = initial_tables();
+        Ast::forget_library_snapshots();
+        Ast::truncate_types(sizes.types);
+        Ast::truncate_names(sizes.names);
+    }
+
+    // Tracing, grammar profiling and the metrics of phases are process wide,
+    // so in the compile server a compile using any must run alone; it waits
+    // for the compiles running to finish, and holds off new ones until done.
+    // Other compiles run concurrently.
+    class compile_admission
+    {
+        public:
+            explicit compile_admission(bool exclusive) : exclusive(exclusive)
+            {
+                gate& g = the_gate();
+                std::unique_lock<std::mutex> guard(g.lock);
+                if (exclusive)
+                {
+                    g.waiting_exclusive++;
+                    g.changed.wait(guard, [&g]{ return g.running == 0 && g.running_exclusive == false; });
+                    g.waiting_exclusive--;
+                    g.running_exclusive = true;
+                }
+                else
+                {
+                    // Waiting exclusive compiles go first, such that they're not starved
+                    g.changed.wait(guard, [&g]{ return g.running_exclusive == false && g.waiting_exclusive == 0; });
+                    g.running++;
+                }
+            }
+
+            ~compile_admission()
+            {
+                gate& g = the_gate();
+                {
+                    std::lock_guard<std::mutex> guard(g.lock);
+                    if (exclusive)
+                    {
+                        g.running_exclusive = false;
+                    }
+                    else
+                    {
+                        g.running--;
+                    }
+                }
+                g.changed.notify_all();
+            }
+
+            compile_admission(compile_admission const&) = delete;
+            compile_admission& operator=(compile_admission const&) = delete;
+
+        private:
+            struct gate
+            {
+                std::mutex lock;
+                std::condition_variable changed;
+                unsigned running = 0;
+                unsigned waiting_exclusive = 0;
+                bool running_exclusive = false;
+            };
+
+            static gate& the_gate()
+            {
+                static gate g;
+                return g;
+            }
+
+            bool exclusive;
+    };
+
+    // Profiles the grammar while in scope, counting from zero, such that
+    // the report only covers this compile
+    struct grammar_profiling
+    {
+        grammar_profiling()
+        {
+            Profile::reset();
+            Profile::enable();
+        }
+
+        ~grammar_profiling()
+        {
+            Profile::disable();
+        }
+    };
+
+    // Records a trace while in scope, and writes it to file when leaving
+    struct trace_recording
+    {
+        std::string file;
+
+        explicit trace_recording(std::string file) : file(std::move(file))
+        {
+            Trace::start();
+        }
+
+        ~trace_recording()
+        {
+            std::FILE* trace_file = std::fopen(file.c_str(), "w");
+            if (trace_file)
+            {
+                output_sink trace_out(trace_file);
+                Trace::stop(trace_out);
+                trace_out.flush();
+                std::fclose(trace_file);
+            }
+        }
+    };
+
+    /* *************** Phases *************** */
+    void parse_file(Phases::compilation& c, std::size_t index)
+    {
+        std::string const& filename = c.files_contents[index].first;
+        std::string const& file_contents = c.files_contents[index].second;
+        Ast::source_file& sf = *c.ast_files[index];
+        // Check if we've already got this file parsed; unless the grammar is
+        // profiled, as a file loaded from the cache is never parsed
+        Maybe<Ast::parse_cache> cache;
+        if (c.cache_directory)
+        {
+            Trace::span span("cache load", "parse", filename);
+            cache = Ast::parse_cache(*c.cache_directory);
+            Maybe<Ast::source_file> cached;
+            if (!Profile::enabled())
+            {
+                cached = cache->load(filename, file_contents);
+            }
+            if (cached)
+            {
+                sf = std::move(*cached);
+                return;
+            }
+        }
+        // If not, lex and parse it (and save it for next time)
+        {
+            Trace::span span("generate_ast", "parse", filename);
+            sf = Ast::generate_source_file(filename, file_contents);
+        }
+        if (cache)
+        {
+            Trace::span span("cache store", "parse", filename);
+            cache->store(file_contents, sf);
+        }
+    }
+
+    void find_affected_units(Phases::compilation& c, output_sink& out)
+    {
+        // Find the units affected by changes since the last run; the remaining
+        // units passed the checks of the later phases in the previous run, and
+        // (as nothing they depend upon changed) still do, so those skip them
+        if (c.cache_directory)
+        {
+            c.dependencies = Ast::dependency_graph(c.ast, c.files_contents, c.library_hash);
+            Maybe<Ast::dependency_graph> previous = Ast::dependency_graph::load(Ast::dependency_graph::saved_path(*c.cache_directory, c.files_contents));
+            c.affected_units = c.dependencies->affected_units(previous ? *previous : Ast::dependency_graph());
+            out << " *** " << c.affected_units.size() << " of " << c.file_count() << " units affected by changes" << '\n';
+        }
+    }
+
+    void write_statistics(Phases::compilation& c, output_sink&)
+    {
+        // Output memory statistics for the ast (if requested)
+        if (c.ast_stats_file)
+        {
+            // Count the source lines, such that statistics can be per KLOC
+            std::size_t source_lines = 0;
+            for(auto& file : c.files_contents)
+            {
+                std::string const& file_contents = std::get<1>(file);
+                source_lines += std::count(file_contents.begin(), file_contents.end(), '\n');
+            }
+            std::ofstream stats_file(*c.ast_stats_file);
+            Ast::write_ast_stats(c.ast, source_lines, stats_file);
+        }
+    }
+
+    void add_library_and_freeze(Phases::compilation& c, output_sink&)
+    {
+        // The library types go in once the files are done; a program type
+        // of the same name is reported like any other duplicate
+        if (c.library)
+        {
+            for(Ast::source_file const& sf : *c.library)
+            {
+                c.environment.insert(Environment::qualified_type_name(sf), sf);
+            }
+        }
+        c.environment.freeze();
+    }
+
+    Phases::registry const& compiler_phases()
+    {
+        using Phases::artifact;
+        using Phases::scope;
+        using Phases::execution;
+        // Built once, and shared between compiles
+        static Phases::registry const phases = []
+        {
+            Phases::registry phases;
+            phases.add({ "parse", { artifact::sources }, { artifact::ast }, scope::per_file, execution::parallel,
+                         nullptr, parse_file });
+            phases.add({ "dependencies", { artifact::sources, artifact::ast }, { artifact::dependencies }, scope::whole_program, execution::sequential,
+                         find_affected_units, nullptr });
+            // Printed as parsed, before any later phase may fail
+            phases.add({ "pretty-print", { artifact::ast }, {}, scope::whole_program, execution::sequential,
+                         [](Phases::compilation& c, output_sink& out){ Ast::pretty_print(c.ast, out); }, nullptr });
+            // Most weeding is done while parsing, this is only what needs the file
+            phases.add({ "weed", { artifact::ast, artifact::dependencies }, {}, scope::per_file, execution::sequential,
+                         nullptr,
+                         [](Phases::compilation& c, std::size_t index)
+                         {
+                             if (c.is_affected(index))
+                             {
+                                 Weeder::check_source_file(*c.ast_files[index]);
+                             }
+                         } });
+            // Every file adds its type, concurrently, and the table is then
+            // frozen for the later phases
+            phases.add({ "environment", { artifact::ast }, { artifact::environment }, scope::per_file, execution::parallel,
+                         add_library_and_freeze,
+                         [](Phases::compilation& c, std::size_t index)
+                         {
+                             Ast::source_file const& sf = *c.ast_files[index];
+                             c.environment.insert(Environment::qualified_type_name(sf), sf);
+                         } });
+            // Files with the same imports share a scope, resolved once
+            phases.add({ "imports", { artifact::ast, artifact::environment }, { artifact::scopes }, scope::per_file, execution::parallel,
+                         [](Phases::compilation& c, output_sink& out)
+                         {
+                             out << " *** " << c.scope_cache.size() << " distinct scopes for " << c.file_count() << " files" << '\n';
+                         },
+                         [](Phases::compilation& c, std::size_t index)
+                         {
+                             c.scopes[index] = c.scope_cache.scope_for(c.environment, *c.ast_files[index]);
+                         } });
+            phases.add({ "hierarchy", { artifact::environment, artifact::scopes }, { artifact::hierarchy }, scope::whole_program, execution::sequential,
+                         [](Phases::compilation& c, output_sink& out)
+                         {
+                             c.hierarchy.emplace(c.environment, c.scope_cache);
+                             out << " *** " << c.hierarchy->size() << " types, ";
+                             if(c.hierarchy->interfaces_labelled())
+                             {
+                                 out << "interfaces labelled" << '\n';
+                             }
+                             else
+                             {
+                                 out << c.hierarchy->bucket_count() << " interface buckets" << '\n';
+                             }
+                         }, nullptr });
+            // Locals are only needed for the bodies checked below
+            phases.add({ "locals", { artifact::ast, artifact::dependencies }, { artifact::locals }, scope::per_file, execution::parallel,
+                         nullptr,
+                         [](Phases::compilation& c, std::size_t index)
+                         {
+                             if (c.is_affected(index))
+                             {
+                                 Ast::resolve_locals(*c.ast_files[index]);
+                             }
+                         } });
+            // Each body is a task of its own, on the work stealing pool
+            phases.add({ "typecheck", { artifact::ast, artifact::scopes, artifact::hierarchy, artifact::locals }, { artifact::types },
+                         scope::whole_program, execution::sequential,
+                         [](Phases::compilation& c, output_sink& out)
+                         {
+                             std::vector<bool> check_bodies;
+                             for(std::size_t index = 0; index < c.file_count(); index++)
+                             {
+                                 check_bodies.push_back(c.is_affected(index));
+                             }
+                             c.expression_types = Typing::check_program(c.ast, c.environment, c.scope_cache, *c.hierarchy, c.jobs, check_bodies);
+                             out << " *** " << c.expression_types.size() << " expressions typed" << '\n';
+                         }, nullptr });
+            phases.add({ "ast-stats", { artifact::sources, artifact::ast }, {}, scope::whole_program, execution::sequential,
+                         write_statistics, nullptr });
+            return phases;
+        }();
+        return phases;
+    }
+
+    po::options_description const& compiler_options()
+    {
+        // Built once, and shared between compiles
+        static po::options_description const desc = []
+        {
+            po::options_description desc("Allowed options");
+            desc.add_options()
+                ("help", "produce help message")
+                ("debug-file", po::value<std::vector<std::string>>(), "output a debug file for the specified phases")
+                ("input-file", po::value<std::vector<std::string>>(), "input file")
+                ("ast-stats", po::value<std::string>(), "output AST memory statistics as JSON to the specified file")
+                ("cache-dir", po::value<std::string>(), "cache parsed files in the specified directory, and reuse them for unchanged files")
+                ("stop-after", po::value<std::string>(), "stop after the specified phase (i.e. 'parse' for checking syntax only)")
+                ("stats", po::value<std::string>(), "output time, memory and allocation metrics per phase and file, in the specified format (json)")
+                ("trace", po::value<std::string>(), "write a timeline of the compile to the specified file, in the Chrome trace event format (chrome://tracing, Perfetto)")
+                ("stats-file", po::value<std::string>(), "write the metrics as json to the specified file, rather than the output")
+                ("profile-grammar", "count calls, backtracks and time per grammar rule, and tokens per kind, and print a report at the end; bypasses loading from the parse cache")
+                ("jobs", po::value<unsigned>()->default_value(0), "number of threads for the parallel phases (0 for one per core)")
+                ("library", po::value<std::string>(), "use the precompiled standard library snapshot in the specified file")
+                ("write-library", po::value<std::string>(), "compile the input files as the standard library, and write their snapshot to the specified file")
+                ;
+            return desc;
+        }();
+        return desc;
+    }
+}
+
+int compile(std::vector<std::string> const& arguments, std::string const& working_directory, output_sink& out)
+{
+    po::options_description const& desc = compiler_options();
+
+    po::positional_options_description p;
+    p.add("input-file", -1);
+
+    po::variables_map vm;        
+    try
+    {
+        po::store(po::command_line_parser(arguments).options(desc).positional(p).run(), vm);
+        po::notify(vm);    
+    }
+    catch(po::error& e)
+    {
+        out << e.what() << '\n';
+        return -1;
+    }
+
+    if (vm.count("help"))
+    {
+        std::ostringstream description;
+        description << desc;
+        out << "Usage: options_description [options]" << '\n';
+        out << description.str() << '\n';
+        return 0;
+    }
+
+    if (!vm.count("input-file"))
+    {
+        out << "Remember to specify files;" << '\n';
+        return 0;
+    }
+
+    // Only one compile at a time may record a trace, a grammar profile or
+    // metrics (whose CPU time, peak RSS and allocations are the process'), or
+    // truncate the tables
+    initial_tables();
+    bool truncate = tables_full();
+    bool measured = vm.count("stats") || vm.count("stats-file");
+    compile_admission admission(vm.count("trace") || vm.count("profile-grammar") || measured || truncate);
+    if (truncate && tables_full())
+    {
+        truncate_tables();
+    }
+
+    // Record a timeline of everything from here on (if requested)
+    Maybe<trace_recording> trace;
+    if (vm.count("trace"))
+    {
+        trace.emplace(resolve_path(working_directory, vm["trace"].as<std::string>()));
+    }
+
+    std::vector<std::string> files = vm["input-file"].as<std::vector<std::string>>();
+    out << "Input files are: ";
+    for(std::string file : files)
+    {
+        out << file;
+    } 
+    out << '\n';
+
+    // If we reach this, we've got arguments!
+    // So let's read the files into strings;
+    std::vector<std::pair<std::string, std::string>> files_contents;
+    for(unsigned int x=0; x<files.size(); x++)
+    {
+        // Read the file in argv[x], into a string;
+        Maybe<std::string> file_contents(read_from_file(resolve_path(working_directory, files[x])));
+        if (!file_contents)
+        {
+            out << "Couldn't open file: " << files[x] << '\n';
+            return -1;
+        }
+        // And add it to our list
+        files_contents.push_back(std::make_pair(files[x], std::move(*file_contents)));
+    }
+
+    if (vm.count("debug-file"))
+    {
+        std::vector<std::string> debug_files = vm["debug-file"].as<std::vector<std::string>>();
+        out << "Generating debug output for phases: ";
+        for(std::string file : debug_files)
+        {
+            out << file;
+        } 
+        out << '\n';
+
+        std::vector<std::string>::iterator it = std::find_if(debug_files.begin(), debug_files.end(), [](std::string str){ return str == "lexer"; });
+        if(it != debug_files.end())
+        {
+            // Debug our lexer; writing the logs next to the input files
+            std::vector<std::pair<std::string, std::string>> resolved_files;
+            for(auto& file : files_contents)
+            {
+                resolved_files.emplace_back(resolve_path(working_directory, file.first), file.second);
+            }
+            Lexer::debug_lexer(resolved_files);
+        }
+  
+    } 
+
+    // Check that we know the phase to stop after
+    Phases::registry const& phases = compiler_phases();
+    Maybe<std::string> stop_after;
+    if (vm.count("stop-after"))
+    {
+        stop_after = vm["stop-after"].as<std::string>();
+        if (!phases.contains(*stop_after))
+        {
+            out << "Unknown phase: " << *stop_after << ", the phases are: ";
+            View::join(out, phases.names(), ", ");
+            out << '\n';
+            return -1;
+        }
+    }
+    // The library only needs to be checked as far as the environment
+    if (vm.count("write-library") && !stop_after)
+    {
+        stop_after = std::string("environment");
+    }
+
+    // Check that we know the metrics format
+    if (vm.count("stats") && vm["stats"].as<std::string>() != "json")
+    {
+        out << "Unknown stats format: " << vm["stats"].as<std::string>() << ", the formats are: json" << '\n';
+        return -1;
+    }
+    std::vector<Metrics::phase_metrics> metrics;
+    Maybe<grammar_profiling> profiling;
+    if (vm.count("profile-grammar"))
+    {
+        profiling.emplace();
+    }
+
+    // Start running the compiler
+    out << "Applying phases:" << '\n';
+    
+    int status = 0;
+    try
+    {
+        Phases::compilation c(std::move(files_contents));
+        if (vm.count("cache-dir"))
+        {
+            c.cache_directory = resolve_path(working_directory, vm["cache-dir"].as<std::string>());
+        }
+        if (vm.count("ast-stats"))
+        {
+            c.ast_stats_file = resolve_path(working_directory, vm["ast-stats"].as<std::string>());
+        }
+        c.jobs = vm["jobs"].as<unsigned>();
+        if (vm.count("library"))
+        {
+            Trace::span span("load library", "io");
+            std::string library = resolve_path(working_directory, vm["library"].as<std::string>());
+            c.library = Ast::load_library_snapshot(library);
+            c.environment = Environment::class_environment(c.file_count() + c.library->size());
+            // Units checked against another library must be checked again
+            if (c.cache_directory)
+            {
+                Maybe<std::string> snapshot = read_from_file(library);
+                c.library_hash = snapshot ? Ast::content_hash(*snapshot) : 0;
+            }
+        }
+        bool completed = phases.run(c, out, stop_after, measured ? &metrics : nullptr);
+        // No error was thrown, so the files form a library
+        if (vm.count("write-library"))
+        {
+            Ast::write_library_snapshot(c.ast, resolve_path(working_directory, vm["write-library"].as<std::string>()));
+            out << " *** Wrote the library snapshot of " << c.file_count() << " files" << '\n';
+        }
+        // All phases succeeded, so the results are now up to date
+        if (completed && c.dependencies)
+        {
+            c.dependencies->save(Ast::dependency_graph::saved_path(*c.cache_directory, c.files_contents));
+        }
+    }
+    catch(Error::Syntax_Error& e)
+    {
+        out << e.what();
+        status = -1;
+    }
+    catch(Error::Generic_Error& e)
+    {
+        out << e.what() << '\n';
+        status = -1;
+    }
+    catch(std::exception& e)
+    {
+        // Not an error in the program, but in the compiler (i.e. a full name
+        // table, or running out of memory); report it, rather than terminate
+        out << "Internal error: " << e.what() << '\n';
+        status = -1;
+    }
+
+    // Output the metrics of the phases which ran (if requested)
+    if (vm.count("stats-file"))
+    {
+        std::FILE* stats_file = std::fopen(resolve_path(working_directory, vm["stats-file"].as<std::string>()).c_str(), "w");
+        if (stats_file)
+        {
+            output_sink stats_out(stats_file);
+            Metrics::write_json(metrics, stats_out);
+            stats_out.flush();
+            std::fclose(stats_file);
+        }
+    }
+    else if (vm.count("stats"))
+    {
+        Metrics::write_json(metrics, out);
+    }
+    // Output the grammar profile (if requested)
+    if (vm.count("profile-grammar"))
+    {
+        Profile::write_report(out);
+    }
+
+    return status;
+}
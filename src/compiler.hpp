@@ -0,0 +1,17 @@
+#ifndef _COMPILER_COMPILER_HPP
+#define _COMPILER_COMPILER_HPP
+
+#include "output_sink.hpp"
+
+#include <string>
+#include <vector>
+
+/************************************************************************/
+/** {2 Running the compiler}                                            */
+/************************************************************************/
+// Shared by the command line, and the compile server; relative paths in the
+// arguments are resolved against working_directory (if non-empty), such that
+// the server can compile on behalf of clients in other directories.
+int compile(std::vector<std::string> const& arguments, std::string const& working_directory, output_sink& out);
+
+#endif //_COMPILER_COMPILER_HPP
@@ -0,0 +1,68 @@
+#include "metrics.hpp"
+
+#include <cstdlib>
+#include <new>
+
+/************************************************************************/
+/** Global operator new and delete, counting allocations for metrics    */
+/************************************************************************/
+// Only linked into the compiler executable (see SConscript).
+namespace
+{
+    void* counted_allocate(std::size_t size)
+    {
+        Metrics::record_allocation(size);
+        // malloc(0) may return null, but new may not
+        return std::malloc(size == 0 ? 1 : size);
+    }
+
+    void* counted_allocate_or_throw(std::size_t size)
+    {
+        void* memory = counted_allocate(size);
+        if(memory == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        return memory;
+    }
+}
+
+void* operator new(std::size_t size)
+{
+    return counted_allocate_or_throw(size);
+}
+
+void* operator new[](std::size_t size)
+{
+    return counted_allocate_or_throw(size);
+}
+
+void* operator new(std::size_t size, std::nothrow_t const&) noexcept
+{
+    return counted_allocate(size);
+}
+
+void* operator new[](std::size_t size, std::nothrow_t const&) noexcept
+{
+    return counted_allocate(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::nothrow_t const&) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::nothrow_t const&) noexcept
+{
+    std::free(memory);
+}
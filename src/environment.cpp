@@ -0,0 +1,196 @@
+#include "environment.hpp"
+
+#include "ast_names.hpp"
+#include "Error.hpp"
+
+#include "Match/match.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace Environment
+{
+    namespace
+    {
+        // The empty name is never the name of a type, so it marks free slots
+        const Ast::name_id free_slot = Ast::root_name_id;
+
+        // Name ids are handed out in sequence, so they're spread over the
+        // table by a multiplicative hash
+        std::size_t slot_of(Ast::name_id name, std::size_t capacity)
+        {
+            return (static_cast<std::size_t>(name) * 0x9E3779B9u) & (capacity - 1);
+        }
+
+        // The smallest power of two, with room for twice the entries
+        std::size_t capacity_for(std::size_t entries)
+        {
+            std::size_t capacity = 1;
+            while(capacity < entries * 2)
+            {
+                capacity *= 2;
+            }
+            return capacity;
+        }
+    }
+
+    Ast::name_id qualified_type_name(Ast::source_file const& sf)
+    {
+        Ast::name_id package = sf.package ? Ast::name_to_id(*sf.package) : Ast::root_name_id;
+        std::string type_name =
+        Match(sf.type, std::string)
+            Case(const Ast::class_declaration& klass)
+            {
+                return klass.name.identifier_string;
+            }
+            Case(const Ast::interface_declaration& interface)
+            {
+                return interface.name.identifier_string;
+            }
+        EndMatch;
+        return Ast::intern_name(package, type_name);
+    }
+
+    class_environment::class_environment(std::size_t expected_types)
+        : building(new slot[capacity_for(expected_types)]), building_capacity(capacity_for(expected_types))
+    {
+        for(std::size_t n = 0; n < building_capacity; n++)
+        {
+            building[n].name.store(free_slot, std::memory_order_relaxed);
+            building[n].file.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    void class_environment::insert(Ast::name_id name, Ast::source_file const& sf)
+    {
+        if(!building)
+        {
+            throw std::logic_error("Type inserted into a frozen class environment");
+        }
+        // Linear probing, claiming the first free slot
+        std::size_t index = slot_of(name, building_capacity);
+        for(std::size_t probes = 0; probes < building_capacity; probes++)
+        {
+            slot& s = building[index];
+            Ast::name_id found = free_slot;
+            if(s.name.compare_exchange_strong(found, name, std::memory_order_acq_rel))
+            {
+                s.file.store(&sf, std::memory_order_release);
+                return;
+            }
+            if(found == name)
+            {
+                // The other declaration may not be published yet
+                Ast::source_file const* other;
+                while((other = s.file.load(std::memory_order_acquire)) == nullptr)
+                {
+                    std::this_thread::yield();
+                }
+                // Name the files in order, whichever came first
+                std::string first = std::min(other->name, sf.name);
+                std::string second = std::max(other->name, sf.name);
+                throw Error::Environment_Error("type " + Ast::name_id_to_string(name) + " is declared in both " + first + " and " + second);
+            }
+            index = (index + 1) & (building_capacity - 1);
+        }
+        throw std::length_error("Class environment is full");
+    }
+
+    void class_environment::freeze()
+    {
+        if(!building)
+        {
+            return;
+        }
+        // Collect the entries, in an order independent of the insertions
+        entries.clear();
+        for(std::size_t n = 0; n < building_capacity; n++)
+        {
+            if(building[n].name.load(std::memory_order_acquire) != free_slot)
+            {
+                entries.push_back({ building[n].name.load(std::memory_order_relaxed), building[n].file.load(std::memory_order_relaxed) });
+            }
+        }
+        std::vector<std::pair<std::string, type_entry>> named;
+        for(type_entry const& entry : entries)
+        {
+            named.emplace_back(Ast::name_id_to_string(entry.name), entry);
+        }
+        std::sort(named.begin(), named.end(), [](std::pair<std::string, type_entry> const& a, std::pair<std::string, type_entry> const& b)
+        {
+            return a.first < b.first;
+        });
+        for(std::size_t n = 0; n < named.size(); n++)
+        {
+            entries[n] = named[n].second;
+        }
+
+        // And index them, by the names only
+        std::size_t capacity = capacity_for(entries.size());
+        keys.assign(capacity, free_slot);
+        indices.assign(capacity, 0);
+        for(std::size_t n = 0; n < entries.size(); n++)
+        {
+            std::size_t index = slot_of(entries[n].name, capacity);
+            while(keys[index] != free_slot)
+            {
+                index = (index + 1) & (capacity - 1);
+            }
+            keys[index] = entries[n].name;
+            indices[index] = static_cast<std::uint32_t>(n);
+        }
+
+        // And by package; the entries are sorted by name, so the types of a
+        // package are too
+        for(type_entry const& entry : entries)
+        {
+            Ast::name_id package = Ast::name_parent(entry.name);
+            packages[package].push_back(entry);
+            while(package_prefixes.insert(package).second && package != Ast::root_name_id)
+            {
+                package = Ast::name_parent(package);
+            }
+        }
+        building.reset();
+        building_capacity = 0;
+    }
+
+    Ast::source_file const* class_environment::find(Ast::name_id name) const
+    {
+        if(building)
+        {
+            throw std::logic_error("Class environment queried before being frozen");
+        }
+        std::size_t capacity = keys.size();
+        for(std::size_t index = slot_of(name, capacity); keys[index] != free_slot; index = (index + 1) & (capacity - 1))
+        {
+            if(keys[index] == name)
+            {
+                return entries[indices[index]].file;
+            }
+        }
+        return nullptr;
+    }
+
+    std::vector<type_entry> const& class_environment::package_types(Ast::name_id package) const
+    {
+        static std::vector<type_entry> const no_types;
+        if(building)
+        {
+            throw std::logic_error("Class environment queried before being frozen");
+        }
+        auto found = packages.find(package);
+        return found != packages.end() ? found->second : no_types;
+    }
+
+    bool class_environment::package_exists(Ast::name_id package) const
+    {
+        if(building)
+        {
+            throw std::logic_error("Class environment queried before being frozen");
+        }
+        return package_prefixes.count(package) != 0;
+    }
+}
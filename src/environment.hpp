@@ -0,0 +1,97 @@
+#ifndef _COMPILER_ENVIRONMENT_HPP
+#define _COMPILER_ENVIRONMENT_HPP
+
+#include "ast.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/************************************************************************/
+/** {2 The global class environment}                                    */
+/************************************************************************/
+// Maps the fully qualified name of every type in the program to the source
+// file declaring it. The table is built in two stages;
+//
+//  1. Building; types are inserted concurrently, from the files being
+//     processed in parallel, into an open addressing table of atomic slots,
+//     without taking a lock. A name inserted twice is reported right away.
+//  2. Frozen; the entries are compacted into a read-only table, of only the
+//     keys (probed) and indices into the sorted entries, for the later phases.
+//     The types are indexed by package as well, for on demand imports.
+//
+// Keys are the interned name ids (see ast_names.hpp), so comparing them is
+// an integer comparison.
+namespace Environment
+{
+    struct type_entry
+    {
+        Ast::name_id name;
+        // The type itself is file->type
+        Ast::source_file const* file;
+    };
+
+    /** The fully qualified name of the type declared by sf */
+    Ast::name_id qualified_type_name(Ast::source_file const& sf);
+
+    class class_environment
+    {
+        public:
+            /** Make room for (at least) expected_types insertions */
+            explicit class_environment(std::size_t expected_types);
+
+            class_environment(class_environment&&) = default;
+            class_environment& operator=(class_environment&&) = default;
+
+            /** {3 Building} */
+            /** Add the type of sf, under name; may be called concurrently.
+             *  Throws Error::Environment_Error if name is already declared */
+            void insert(Ast::name_id name, Ast::source_file const& sf);
+            /** Compact the table, such that it can be queried; no types can
+             *  be inserted afterwards */
+            void freeze();
+
+            /** {3 Queries, once frozen} */
+            /** The file declaring name, or nullptr if there is none */
+            Ast::source_file const* find(Ast::name_id name) const;
+            /** Every type, sorted by their qualified names */
+            std::vector<type_entry> const& types() const
+            {
+                return entries;
+            }
+            /** The types directly inside package, sorted by their simple names */
+            std::vector<type_entry> const& package_types(Ast::name_id package) const;
+            /** Whether package, or a package inside it, declares any types */
+            bool package_exists(Ast::name_id package) const;
+
+            bool frozen() const
+            {
+                return !building;
+            }
+
+        private:
+            struct slot
+            {
+                std::atomic<Ast::name_id> name;
+                std::atomic<Ast::source_file const*> file;
+            };
+
+            // While building
+            std::unique_ptr<slot[]> building;
+            std::size_t building_capacity;
+
+            // Once frozen; keys[n] is the name at entries[indices[n]]
+            std::vector<Ast::name_id> keys;
+            std::vector<std::uint32_t> indices;
+            std::vector<type_entry> entries;
+            // The entries by package, and every package along with its prefixes
+            std::unordered_map<Ast::name_id, std::vector<type_entry>> packages;
+            std::unordered_set<Ast::name_id> package_prefixes;
+    };
+}
+
+#endif //_COMPILER_ENVIRONMENT_HPP
@@ -0,0 +1,27 @@
+#include "frontend.hpp"
+
+#include "ast_generate.hpp"
+#include "weeder.hpp"
+#include "Error.hpp"
+
+namespace Frontend
+{
+    result compile_sources(std::vector<source> const& sources)
+    {
+        result output;
+        for(source const& src : sources)
+        {
+            try
+            {
+                Ast::source_file sf = Ast::generate_source_file(src.name, src.contents);
+                Weeder::check_source_file(sf);
+                output.program.push_back(std::move(sf));
+            }
+            catch(Error::Generic_Error& e)
+            {
+                output.diagnostics.push_back({ src.name, e.what() });
+            }
+        }
+        return output;
+    }
+}
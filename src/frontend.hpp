@@ -0,0 +1,52 @@
+#ifndef _COMPILER_FRONTEND_HPP
+#define _COMPILER_FRONTEND_HPP
+
+#include "ast.hpp"
+
+#include <string>
+#include <vector>
+
+/************************************************************************/
+/** {2 Embeddable front end}                                            */
+/************************************************************************/
+// The entry point for using the compiler as a library; sources are given
+// in memory, and the ast and diagnostics are returned, without touching the
+// filesystem or the global streams, and without exiting the process.
+//
+//      Frontend::result r = Frontend::compile_sources({ { "A.java", "public class A {}" } });
+//      for(auto& d : r.diagnostics) ...
+//
+// Compiles may run concurrently from several threads.
+namespace Frontend
+{
+    struct source
+    {
+        std::string name;
+        std::string contents;
+    };
+
+    struct diagnostic
+    {
+        // The name of the source it concerns
+        std::string source_name;
+        std::string message;
+    };
+
+    struct result
+    {
+        // The sources which were parsed successfully, in the order given
+        Ast::program program;
+        std::vector<diagnostic> diagnostics;
+
+        bool success() const
+        {
+            return diagnostics.empty();
+        }
+    };
+
+    /** Lex, parse and weed every source; a source with errors is reported, and
+     *  left out of the program, while the remaining sources are still parsed */
+    result compile_sources(std::vector<source> const& sources);
+}
+
+#endif //_COMPILER_FRONTEND_HPP
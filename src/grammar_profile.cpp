@@ -0,0 +1,219 @@
+#include "grammar_profile.hpp"
+
+#include "Tokens.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace Profile
+{
+    struct rule_counters
+    {
+        std::string name;
+        std::atomic<std::uint64_t> calls;
+        std::atomic<std::uint64_t> successes;
+        std::atomic<std::uint64_t> failures;
+        std::atomic<std::uint64_t> inclusive_ns;
+    };
+
+    namespace
+    {
+        std::atomic<bool> profiling(false);
+
+        // Token ids are below Identifier + 0x100 (see Tokens.hpp)
+        const unsigned token_id_limit = Identifier + 0x100;
+
+        struct profile_state
+        {
+            std::mutex lock;
+            // A deque, such that the counters never move
+            std::deque<rule_counters> rules;
+            std::atomic<std::uint64_t> tokens[token_id_limit];
+            std::atomic<std::uint64_t> lexing_ns;
+
+            profile_state()
+                : lexing_ns(0)
+            {
+                for(auto& count : tokens)
+                {
+                    count.store(0);
+                }
+            }
+        };
+
+        profile_state& state()
+        {
+            static profile_state profile;
+            return profile;
+        }
+
+        std::uint64_t now_ns()
+        {
+            auto since_epoch = std::chrono::steady_clock::now().time_since_epoch();
+            return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(since_epoch).count());
+        }
+
+        // Rules nest, so each thread keeps its active rules, with their start times
+        thread_local std::vector<std::pair<rule_counters*, std::uint64_t>> active_rules;
+
+        void leave_rule(bool success)
+        {
+            rule_counters* counters = active_rules.back().first;
+            (success ? counters->successes : counters->failures).fetch_add(1, std::memory_order_relaxed);
+            counters->inclusive_ns.fetch_add(now_ns() - active_rules.back().second, std::memory_order_relaxed);
+            active_rules.pop_back();
+        }
+    }
+
+    void enable()
+    {
+        profiling.store(true);
+    }
+
+    void disable()
+    {
+        profiling.store(false);
+    }
+
+    void reset()
+    {
+        profile_state& profile = state();
+        std::lock_guard<std::mutex> guard(profile.lock);
+        // The rules stay, as the profilers of the grammars point to them
+        for(rule_counters& rule : profile.rules)
+        {
+            rule.calls = 0;
+            rule.successes = 0;
+            rule.failures = 0;
+            rule.inclusive_ns = 0;
+        }
+        for(auto& count : profile.tokens)
+        {
+            count.store(0);
+        }
+        profile.lexing_ns.store(0);
+    }
+
+    parse_scope::parse_scope()
+        : depth(active_rules.size())
+    {
+    }
+
+    parse_scope::~parse_scope()
+    {
+        while(active_rules.size() > depth)
+        {
+            leave_rule(false);
+        }
+    }
+
+    bool enabled()
+    {
+        return profiling.load(std::memory_order_relaxed);
+    }
+
+    rule_profiler::rule_profiler(std::string const& rule_name)
+    {
+        profile_state& profile = state();
+        std::lock_guard<std::mutex> guard(profile.lock);
+        // Grammars are instanced per thread, so rules may already be known
+        for(rule_counters& rule : profile.rules)
+        {
+            if(rule.name == rule_name)
+            {
+                counters = &rule;
+                return;
+            }
+        }
+        profile.rules.emplace_back();
+        counters = &profile.rules.back();
+        counters->name = rule_name;
+        counters->calls = 0;
+        counters->successes = 0;
+        counters->failures = 0;
+        counters->inclusive_ns = 0;
+    }
+
+    void rule_profiler::enter() const
+    {
+        counters->calls.fetch_add(1, std::memory_order_relaxed);
+        active_rules.emplace_back(counters, now_ns());
+    }
+
+    void rule_profiler::leave(bool success) const
+    {
+        leave_rule(success);
+    }
+
+    void count_token(unsigned token_id)
+    {
+        if(token_id < token_id_limit)
+        {
+            state().tokens[token_id].fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void add_lexing_time(std::uint64_t nanoseconds)
+    {
+        state().lexing_ns.fetch_add(nanoseconds, std::memory_order_relaxed);
+    }
+
+    void write_report(output_sink& out)
+    {
+        profile_state& profile = state();
+        std::lock_guard<std::mutex> guard(profile.lock);
+        char line[160];
+
+        // Rules, most expensive first
+        std::vector<rule_counters const*> rules;
+        for(rule_counters const& rule : profile.rules)
+        {
+            rules.push_back(&rule);
+        }
+        std::sort(rules.begin(), rules.end(), [](rule_counters const* a, rule_counters const* b)
+        {
+            return a->inclusive_ns.load() > b->inclusive_ns.load();
+        });
+        out << "Grammar rules (inclusive time, recursive rules count each level):\n";
+        std::snprintf(line, sizeof(line), "  %-32s %12s %12s %12s %12s\n", "rule", "calls", "successes", "failures", "ms");
+        out << line;
+        for(rule_counters const* rule : rules)
+        {
+            std::snprintf(line, sizeof(line), "  %-32s %12llu %12llu %12llu %12.3f\n", rule->name.c_str(),
+                          static_cast<unsigned long long>(rule->calls.load()),
+                          static_cast<unsigned long long>(rule->successes.load()),
+                          static_cast<unsigned long long>(rule->failures.load()),
+                          static_cast<double>(rule->inclusive_ns.load()) / 1e6);
+            out << line;
+        }
+
+        // Tokens, most frequent first
+        std::vector<std::pair<std::uint64_t, unsigned>> tokens;
+        std::uint64_t total_tokens = 0;
+        for(unsigned id = 0; id < token_id_limit; id++)
+        {
+            std::uint64_t count = profile.tokens[id].load();
+            if(count > 0)
+            {
+                tokens.emplace_back(count, id);
+                total_tokens += count;
+            }
+        }
+        std::sort(tokens.rbegin(), tokens.rend());
+        std::snprintf(line, sizeof(line), "Tokens (%llu in total, %.3f ms lexing):\n",
+                      static_cast<unsigned long long>(total_tokens), static_cast<double>(profile.lexing_ns.load()) / 1e6);
+        out << line;
+        for(auto& token : tokens)
+        {
+            std::snprintf(line, sizeof(line), "  %-32s %12llu %8.2f%%\n", token_name(token.second).c_str(),
+                          static_cast<unsigned long long>(token.first), 100.0 * static_cast<double>(token.first) / static_cast<double>(total_tokens));
+            out << line;
+        }
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef _COMPILER_GRAMMAR_PROFILE_HPP
+#define _COMPILER_GRAMMAR_PROFILE_HPP
+
+#include "output_sink.hpp"
+
+#include <boost/spirit/home/qi/nonterminal/debug_handler_state.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/************************************************************************/
+/** {2 Grammar and lexer profiling}                                     */
+/************************************************************************/
+// When enabled, every named rule of the grammar counts its invocations,
+// successes, failures (backtracks) and inclusive time, and the lexer counts
+// the tokens of each kind; off by default, as it slows parsing down.
+namespace Profile
+{
+    /** Turn profiling on, for every parse from now on, until disabled */
+    void enable();
+    void disable();
+    bool enabled();
+    /** Zero every count, such that a report only covers what came after */
+    void reset();
+
+    // Balances the rules entered by a parse in its scope; the handlers never
+    // see a rule left by an exception (i.e. a Weeding_Error thrown by a
+    // semantic action), so those are counted as failures when leaving
+    class parse_scope
+    {
+        public:
+            parse_scope();
+            ~parse_scope();
+
+            parse_scope(parse_scope const&) = delete;
+            parse_scope& operator=(parse_scope const&) = delete;
+
+        private:
+            std::size_t depth;
+    };
+
+    struct rule_counters;
+
+    // A debug handler for qi::debug, recording into the counters of a rule
+    class rule_profiler
+    {
+        public:
+            explicit rule_profiler(std::string const& rule_name);
+
+            template<typename Iterator, typename Context>
+            void operator()(Iterator&, Iterator const&, Context&, boost::spirit::qi::debug_handler_state state, std::string const&) const
+            {
+                if(state == boost::spirit::qi::pre_parse)
+                {
+                    enter();
+                }
+                else
+                {
+                    leave(state == boost::spirit::qi::successful_parse);
+                }
+            }
+
+        private:
+            void enter() const;
+            void leave(bool success) const;
+
+            rule_counters* counters;
+    };
+
+    /** Count a token of the given kind (see Tokens.hpp) */
+    void count_token(unsigned token_id);
+    /** Add time spent lexing */
+    void add_lexing_time(std::uint64_t nanoseconds);
+
+    /** Write the rules sorted by inclusive time, and the token kinds sorted
+     *  by count */
+    void write_report(output_sink& out);
+}
+
+#endif //_COMPILER_GRAMMAR_PROFILE_HPP
@@ -0,0 +1,567 @@
+#include "hierarchy.hpp"
+
+#include "ast_helper.hpp"
+#include "ast_names.hpp"
+#include "Error.hpp"
+
+#include "Match/match.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <string>
+
+#include <boost/variant.hpp>
+
+namespace Hierarchy
+{
+    namespace
+    {
+        Ast::name_id java_lang_object()
+        {
+            static Ast::name_id const id = Ast::intern_name({ Ast::identifier("java"), Ast::identifier("lang"), Ast::identifier("Object") });
+            return id;
+        }
+
+        // The most interfaces a bucket can number (0 is 'none')
+        const std::size_t bucket_capacity = std::numeric_limits<std::uint16_t>::max();
+        // The most buckets, that is the width of a row; denser interface sets
+        // are labelled instead
+        const std::size_t max_buckets = 64;
+
+        // Merge the sorted, duplicate free, list from into into
+        void merge_into(std::vector<type_index>& into, std::vector<type_index> const& from)
+        {
+            std::vector<type_index> merged;
+            merged.reserve(into.size() + from.size());
+            std::set_union(into.begin(), into.end(), from.begin(), from.end(), std::back_inserter(merged));
+            into.swap(merged);
+        }
+
+        // Label the forest of the members by parent in pre-order, such that
+        // the descendants of a type are labelled within [begin, end) of it
+        template<typename Member>
+        std::uint32_t label_forest(std::vector<type_index> const& parents, Member is_member,
+                                   std::vector<std::uint32_t>& begin, std::vector<std::uint32_t>& end)
+        {
+            std::size_t types = parents.size();
+            // The children of each type, in order
+            std::vector<std::size_t> children_begin(types + 1, 0);
+            for(type_index type = 0; type < types; type++)
+            {
+                if(parents[type] != no_type)
+                {
+                    children_begin[parents[type] + 1]++;
+                }
+            }
+            for(std::size_t n = 0; n < types; n++)
+            {
+                children_begin[n + 1] += children_begin[n];
+            }
+            std::vector<type_index> children(children_begin[types]);
+            std::vector<std::size_t> filled(children_begin.begin(), children_begin.end() - 1);
+            for(type_index type = 0; type < types; type++)
+            {
+                if(parents[type] != no_type)
+                {
+                    children[filled[parents[type]]++] = type;
+                }
+            }
+            begin.assign(types, 0);
+            end.assign(types, 0);
+            std::uint32_t label = 0;
+            struct call
+            {
+                type_index type;
+                std::size_t next_child;
+            };
+            std::vector<call> calls;
+            for(type_index root = 0; root < types; root++)
+            {
+                if(!is_member(root) || parents[root] != no_type)
+                {
+                    continue;
+                }
+                begin[root] = label++;
+                calls.push_back({ root, children_begin[root] });
+                while(!calls.empty())
+                {
+                    call& top = calls.back();
+                    if(top.next_child < children_begin[top.type + 1])
+                    {
+                        type_index child = children[top.next_child++];
+                        begin[child] = label++;
+                        calls.push_back({ child, children_begin[child] });
+                        continue;
+                    }
+                    end[top.type] = label;
+                    calls.pop_back();
+                }
+            }
+            return label;
+        }
+    }
+
+    type_hierarchy::type_hierarchy(Environment::class_environment const& environment, Environment::scope_cache& scopes)
+        : object(no_type), buckets(0), labelled(false)
+    {
+        resolve(environment, scopes);
+        std::vector<type_index> order = check_acyclic();
+        encode_classes(order);
+        encode_interfaces(order);
+    }
+
+    type_index type_hierarchy::index_of(Ast::name_id name) const
+    {
+        auto found = indices.find(name);
+        return found != indices.end() ? found->second : no_type;
+    }
+
+    void type_hierarchy::resolve(Environment::class_environment const& environment, Environment::scope_cache& scopes)
+    {
+        std::vector<Environment::type_entry> const& entries = environment.types();
+        std::size_t types = entries.size();
+        names.resize(types);
+        interface_flags.resize(types);
+        superclasses.assign(types, no_type);
+        direct_interfaces.resize(types);
+        for(type_index type = 0; type < types; type++)
+        {
+            names[type] = entries[type].name;
+            indices.emplace(entries[type].name, type);
+            interface_flags[type] = boost::get<Ast::interface_declaration>(&entries[type].file->type) != nullptr;
+        }
+        object = index_of(java_lang_object());
+
+        for(type_index type = 0; type < types; type++)
+        {
+            Ast::source_file const& sf = *entries[type].file;
+            std::shared_ptr<Environment::type_scope const> scope = scopes.scope_for(environment, sf);
+            std::string type_name = Ast::name_id_to_string(names[type]);
+            // The type a supertype name refers to, in the scope of the file
+            auto lookup = [&](Ast::namedtype const& supertype)
+            {
+                Ast::name_id name =
+                Match(supertype, Ast::name_id)
+                    Case(const Ast::name_simple& simple)
+                    {
+                        return scope->find(Ast::name_component(simple.id));
+                    }
+                    Case(const Ast::name_qualified& qualified)
+                    {
+                        return Ast::name_to_id(qualified);
+                    }
+                EndMatch;
+                type_index found = name == Ast::root_name_id ? no_type : index_of(name);
+                if(found == no_type)
+                {
+                    throw Error::Hierarchy_Error("supertype " + Ast::name_to_string(supertype) + " of " + type_name +
+                                                 " in " + sf.name + " does not exist");
+                }
+                return found;
+            };
+            // Superinterfaces, of either a class or an interface
+            auto add_interfaces = [&](std::list<Ast::namedtype> const& supertypes)
+            {
+                for(Ast::namedtype const& supertype : supertypes)
+                {
+                    type_index found = lookup(supertype);
+                    if(!is_interface(found))
+                    {
+                        throw Error::Hierarchy_Error(type_name + " in " + sf.name + " implements or extends class " +
+                                                     Ast::name_id_to_string(names[found]) + " as an interface");
+                    }
+                    std::vector<type_index>& interfaces = direct_interfaces[type];
+                    if(std::find(interfaces.begin(), interfaces.end(), found) != interfaces.end())
+                    {
+                        throw Error::Hierarchy_Error(type_name + " in " + sf.name + " names interface " +
+                                                     Ast::name_id_to_string(names[found]) + " twice");
+                    }
+                    interfaces.push_back(found);
+                }
+            };
+
+            if(Ast::class_declaration const* klass = boost::get<Ast::class_declaration>(&sf.type))
+            {
+                // Every class extends java.lang.Object, but itself; and
+                // without the library loaded, there is no Object to extend
+                bool implicit_root = Ast::name_to_id(klass->extends) == java_lang_object() &&
+                                     (object == no_type || object == type);
+                if(!implicit_root)
+                {
+                    type_index found = lookup(klass->extends);
+                    if(is_interface(found))
+                    {
+                        throw Error::Hierarchy_Error("class " + type_name + " in " + sf.name + " extends interface " +
+                                                     Ast::name_id_to_string(names[found]));
+                    }
+                    if(boost::get<Ast::class_declaration>(entries[found].file->type).is_final)
+                    {
+                        throw Error::Hierarchy_Error("class " + type_name + " in " + sf.name + " extends final class " +
+                                                     Ast::name_id_to_string(names[found]));
+                    }
+                    superclasses[type] = found;
+                }
+                add_interfaces(klass->implements);
+            }
+            else
+            {
+                add_interfaces(boost::get<Ast::interface_declaration>(sf.type).extends);
+            }
+        }
+    }
+
+    std::vector<type_index> type_hierarchy::check_acyclic() const
+    {
+        // The edges from each type to its direct supertypes
+        std::size_t types = size();
+        std::vector<std::size_t> edges_begin(types + 1);
+        std::vector<type_index> edges;
+        for(type_index type = 0; type < types; type++)
+        {
+            edges_begin[type] = edges.size();
+            if(superclasses[type] != no_type)
+            {
+                edges.push_back(superclasses[type]);
+            }
+            edges.insert(edges.end(), direct_interfaces[type].begin(), direct_interfaces[type].end());
+        }
+        edges_begin[types] = edges.size();
+
+        // Tarjan's algorithm, with the recursion kept in calls; components are
+        // completed after every component they reach, that is supertypes first
+        const std::uint32_t unvisited = std::numeric_limits<std::uint32_t>::max();
+        std::vector<std::uint32_t> visit_index(types, unvisited);
+        std::vector<std::uint32_t> lowlink(types);
+        std::vector<char> on_stack(types);
+        std::vector<type_index> stack;
+        struct call
+        {
+            type_index type;
+            std::size_t next_edge;
+        };
+        std::vector<call> calls;
+        std::uint32_t visited = 0;
+        std::vector<type_index> order;
+        order.reserve(types);
+
+        auto visit = [&](type_index type)
+        {
+            visit_index[type] = lowlink[type] = visited++;
+            stack.push_back(type);
+            on_stack[type] = 1;
+            calls.push_back({ type, edges_begin[type] });
+        };
+        for(type_index root = 0; root < types; root++)
+        {
+            if(visit_index[root] != unvisited)
+            {
+                continue;
+            }
+            visit(root);
+            while(!calls.empty())
+            {
+                type_index type = calls.back().type;
+                if(calls.back().next_edge < edges_begin[type + 1])
+                {
+                    type_index supertype = edges[calls.back().next_edge++];
+                    if(visit_index[supertype] == unvisited)
+                    {
+                        visit(supertype);
+                    }
+                    else if(on_stack[supertype])
+                    {
+                        lowlink[type] = std::min(lowlink[type], visit_index[supertype]);
+                    }
+                    continue;
+                }
+                // Every supertype is done, return to the subtype we came from
+                calls.pop_back();
+                if(!calls.empty())
+                {
+                    type_index caller = calls.back().type;
+                    lowlink[caller] = std::min(lowlink[caller], lowlink[type]);
+                }
+                if(lowlink[type] != visit_index[type])
+                {
+                    continue;
+                }
+                // type is the root of a component, pop it
+                std::vector<type_index> component;
+                type_index member;
+                do
+                {
+                    member = stack.back();
+                    stack.pop_back();
+                    on_stack[member] = 0;
+                    component.push_back(member);
+                } while(member != type);
+                bool self_edge = std::find(edges.begin() + edges_begin[type], edges.begin() + edges_begin[type + 1], type) !=
+                                 edges.begin() + edges_begin[type + 1];
+                if(component.size() > 1 || self_edge)
+                {
+                    std::vector<std::string> cycle;
+                    for(type_index member : component)
+                    {
+                        cycle.push_back(Ast::name_id_to_string(names[member]));
+                    }
+                    std::sort(cycle.begin(), cycle.end());
+                    std::string message = "the hierarchy of";
+                    for(std::size_t n = 0; n < cycle.size(); n++)
+                    {
+                        message += (n == 0 ? " " : ", ") + cycle[n];
+                    }
+                    throw Error::Hierarchy_Error(message + " is cyclic");
+                }
+                order.push_back(type);
+            }
+        }
+        return order;
+    }
+
+    void type_hierarchy::encode_classes(std::vector<type_index> const& order)
+    {
+        std::size_t types = size();
+        // The displays; superclasses come first in order, so theirs are done
+        depths.assign(types, 0);
+        displays.assign(types * display_size, no_type);
+        for(type_index type : order)
+        {
+            if(is_interface(type))
+            {
+                continue;
+            }
+            type_index super = superclasses[type];
+            if(super != no_type)
+            {
+                depths[type] = depths[super] + 1;
+                std::copy(displays.begin() + super * display_size, displays.begin() + (super + 1) * display_size,
+                          displays.begin() + type * display_size);
+            }
+            if(depths[type] < display_size)
+            {
+                displays[type * display_size + depths[type]] = type;
+            }
+        }
+
+        // The interval labels, numbering the class tree in pre-order; the
+        // subclasses of a class are numbered right after it
+        label_forest(superclasses, [this](type_index type) { return !is_interface(type); }, interval_begin, interval_end);
+    }
+
+    void type_hierarchy::encode_interfaces(std::vector<type_index> const& order)
+    {
+        if(bucket_interfaces(order))
+        {
+            return;
+        }
+        // Too dense for rows of max_buckets
+        buckets = 0;
+        std::vector<std::uint32_t>().swap(interface_bucket);
+        std::vector<std::uint16_t>().swap(interface_number);
+        std::vector<std::uint16_t>().swap(rows);
+        labelled = true;
+        label_interfaces(order);
+    }
+
+    bool type_hierarchy::bucket_interfaces(std::vector<type_index> const& order)
+    {
+        std::size_t types = size();
+        // The superinterfaces of every type (itself included, for interfaces),
+        // sorted; supertypes come first in order, so theirs are done. No two
+        // of them can share a bucket, so a type with more than max_buckets
+        // of them can't be bucketed
+        std::vector<std::vector<type_index>> superinterfaces(types);
+        for(type_index type : order)
+        {
+            std::vector<type_index>& own = superinterfaces[type];
+            if(is_interface(type))
+            {
+                own.push_back(type);
+            }
+            else if(superclasses[type] != no_type)
+            {
+                own = superinterfaces[superclasses[type]];
+            }
+            for(type_index interface : direct_interfaces[type])
+            {
+                merge_into(own, superinterfaces[interface]);
+            }
+            if(own.size() > max_buckets)
+            {
+                return false;
+            }
+        }
+
+        // Interfaces which are superinterfaces of the same type conflict, and
+        // can't share a bucket. Many types have the same superinterfaces, so
+        // the conflicts are made duplicate free as they double
+        std::vector<std::vector<type_index>> conflicts(types);
+        std::vector<std::size_t> unique_conflicts(types, 0);
+        for(type_index type = 0; type < types; type++)
+        {
+            for(type_index interface : superinterfaces[type])
+            {
+                std::vector<type_index>& with = conflicts[interface];
+                with.insert(with.end(), superinterfaces[type].begin(), superinterfaces[type].end());
+                if(with.size() > 2 * unique_conflicts[interface] + max_buckets)
+                {
+                    std::sort(with.begin(), with.end());
+                    with.erase(std::unique(with.begin(), with.end()), with.end());
+                    unique_conflicts[interface] = with.size();
+                }
+            }
+        }
+
+        // Greedily put each interface in the first bucket free of conflicts
+        interface_bucket.assign(types, 0);
+        interface_number.assign(types, 0);
+        std::vector<std::size_t> bucket_sizes;
+        // The interface, plus one, last taking each bucket off the table
+        std::vector<std::size_t> taken;
+        for(type_index interface : order)
+        {
+            if(!is_interface(interface))
+            {
+                continue;
+            }
+            std::vector<type_index>& with = conflicts[interface];
+            std::sort(with.begin(), with.end());
+            with.erase(std::unique(with.begin(), with.end()), with.end());
+            for(type_index other : with)
+            {
+                if(other != interface && interface_number[other] != 0)
+                {
+                    taken[interface_bucket[other]] = interface + 1;
+                }
+            }
+            std::size_t bucket = 0;
+            while(bucket < bucket_sizes.size() && (taken[bucket] == interface + 1 || bucket_sizes[bucket] == bucket_capacity))
+            {
+                bucket++;
+            }
+            if(bucket == max_buckets)
+            {
+                return false;
+            }
+            if(bucket == bucket_sizes.size())
+            {
+                bucket_sizes.push_back(0);
+                taken.push_back(0);
+            }
+            interface_bucket[interface] = static_cast<std::uint32_t>(bucket);
+            interface_number[interface] = static_cast<std::uint16_t>(++bucket_sizes[bucket]);
+            // Not needed anymore
+            std::vector<type_index>().swap(with);
+        }
+        buckets = bucket_sizes.size();
+
+        // And the rows
+        rows.assign(types * buckets, 0);
+        for(type_index type = 0; type < types; type++)
+        {
+            for(type_index interface : superinterfaces[type])
+            {
+                rows[type * buckets + interface_bucket[interface]] = interface_number[interface];
+            }
+        }
+        return true;
+    }
+
+    void type_hierarchy::label_interfaces(std::vector<type_index> const& order)
+    {
+        std::size_t types = size();
+        // The first superinterface of each interface makes the interfaces a
+        // forest, labelled like the class tree
+        std::vector<type_index> first_interfaces(types, no_type);
+        for(type_index type = 0; type < types; type++)
+        {
+            if(is_interface(type) && !direct_interfaces[type].empty())
+            {
+                first_interfaces[type] = direct_interfaces[type].front();
+            }
+        }
+        std::uint32_t labels = label_forest(first_interfaces, [this](type_index type) { return is_interface(type); },
+                                            interface_begin, interface_end);
+        std::vector<std::uint32_t> end_of_label(labels, 0);
+        for(type_index type = 0; type < types; type++)
+        {
+            if(is_interface(type))
+            {
+                end_of_label[interface_begin[type]] = interface_end[type];
+            }
+        }
+
+        // The labels, sorted, of the interfaces whose forest ancestors are
+        // together the superinterfaces of every type; supertypes come first
+        // in order, so theirs are done. A chain of interfaces thus needs a
+        // single label per type
+        interface_labels.assign(types, std::vector<std::uint32_t>());
+        for(type_index type : order)
+        {
+            std::vector<std::uint32_t>& own = interface_labels[type];
+            if(is_interface(type))
+            {
+                own.push_back(interface_begin[type]);
+            }
+            else if(superclasses[type] != no_type)
+            {
+                own = interface_labels[superclasses[type]];
+            }
+            for(type_index interface : direct_interfaces[type])
+            {
+                own.insert(own.end(), interface_labels[interface].begin(), interface_labels[interface].end());
+            }
+            std::sort(own.begin(), own.end());
+            own.erase(std::unique(own.begin(), own.end()), own.end());
+            // A label with a descendant in the list is implied by it; in
+            // pre-order, that is the next label, if any descendant is
+            std::size_t kept = 0;
+            for(std::size_t n = 0; n < own.size(); n++)
+            {
+                if(n + 1 < own.size() && own[n + 1] < end_of_label[own[n]])
+                {
+                    continue;
+                }
+                own[kept++] = own[n];
+            }
+            own.resize(kept);
+            own.shrink_to_fit();
+        }
+    }
+
+    bool type_hierarchy::is_subclass(type_index sub, type_index super) const
+    {
+        if(depths[super] < display_size)
+        {
+            // An ancestor at depth d is in slot d, other slots hold other
+            // classes, or no_type
+            return displays[sub * display_size + depths[super]] == super;
+        }
+        return interval_begin[super] <= interval_begin[sub] && interval_begin[sub] < interval_end[super];
+    }
+
+    bool type_hierarchy::is_subtype(type_index sub, type_index super) const
+    {
+        if(sub == super)
+        {
+            return true;
+        }
+        if(is_interface(super) && labelled)
+        {
+            // Whether a label of sub is within the interval of super
+            std::vector<std::uint32_t> const& own = interface_labels[sub];
+            auto label = std::lower_bound(own.begin(), own.end(), interface_begin[super]);
+            return label != own.end() && *label < interface_end[super];
+        }
+        if(is_interface(super))
+        {
+            return rows[sub * buckets + interface_bucket[super]] == interface_number[super];
+        }
+        // Interfaces only extend other interfaces, besides Object
+        if(is_interface(sub))
+        {
+            return super == object;
+        }
+        return is_subclass(sub, super);
+    }
+}
@@ -0,0 +1,139 @@
+#ifndef _COMPILER_HIERARCHY_HPP
+#define _COMPILER_HIERARCHY_HPP
+
+#include "ast.hpp"
+#include "environment.hpp"
+#include "type_scope.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/************************************************************************/
+/** {2 The type hierarchy}                                              */
+/************************************************************************/
+// The supertypes of every type in the environment, resolved and checked
+// once, and then encoded such that subtype queries take constant time;
+//
+//  - Classes form a tree (by single inheritance). Each class keeps a display
+//    of its first display_size ancestors, from the root down, such that
+//    'A <: B' is display(A)[depth(B)] == B (Cohen). For deeper classes,
+//    whose displays would take space quadratic in the depth, the tree is
+//    labelled by intervals instead; 'A <: B' if A's label is within B's.
+//  - Interfaces are packed into buckets, such that no type has two
+//    superinterfaces in the same bucket, and numbered within their bucket.
+//    Each type keeps a row of the superinterface it has in every bucket
+//    (if any), such that 'A <: I' is row(A)[bucket(I)] == number(I).
+//    Rows are at most 64 buckets wide; a hierarchy needing more (as a deep
+//    chain of interfaces does) labels the forest of first superinterfaces
+//    by intervals instead, and each type keeps the labels whose ancestors
+//    are its superinterfaces, such that 'A <: I' is a binary search for a
+//    label of A within I's interval. A chain keeps a single label per type.
+//
+// Cycles are found by an iterative strongly connected components pass
+// (Tarjan), such that a hierarchy of any depth is checked without deep
+// recursion. As the hierarchy is acyclic once built, 'would making A a
+// supertype of B close a cycle' is the constant time query 'A <: B'.
+namespace Hierarchy
+{
+    // Types are numbered in the order of the environment, that is by name
+    using type_index = std::uint32_t;
+    const type_index no_type = ~type_index(0);
+
+    /** Display slots kept per class */
+    const unsigned display_size = 8;
+
+    class type_hierarchy
+    {
+        public:
+            /** Resolve the supertypes of every type in environment (which must
+             *  be frozen), in the scope of its file. Throws Error::Hierarchy_Error
+             *  if a supertype does not exist, is of the wrong kind (or a final
+             *  class), is repeated, or the hierarchy is cyclic */
+            type_hierarchy(Environment::class_environment const& environment, Environment::scope_cache& scopes);
+
+            /** {3 Types} */
+            std::size_t size() const
+            {
+                return names.size();
+            }
+            /** The index of the type named name, or no_type */
+            type_index index_of(Ast::name_id name) const;
+            Ast::name_id name_of(type_index type) const
+            {
+                return names[type];
+            }
+            bool is_interface(type_index type) const
+            {
+                return interface_flags[type] != 0;
+            }
+            /** The direct superclass, or no_type for interfaces and roots */
+            type_index superclass(type_index type) const
+            {
+                return superclasses[type];
+            }
+            /** The direct superinterfaces, in the order declared */
+            std::vector<type_index> const& interfaces(type_index type) const
+            {
+                return direct_interfaces[type];
+            }
+
+            /** {3 Queries} */
+            /** Whether sub is super, or a subtype of it, in constant time (but
+             *  for interfaces, once labelled) */
+            bool is_subtype(type_index sub, type_index super) const;
+
+            /** The number of interface buckets, that is the width of a row */
+            std::size_t bucket_count() const
+            {
+                return buckets;
+            }
+            /** Whether the interfaces were too dense for buckets, and are
+             *  labelled instead */
+            bool interfaces_labelled() const
+            {
+                return labelled;
+            }
+
+        private:
+            void resolve(Environment::class_environment const& environment, Environment::scope_cache& scopes);
+            std::vector<type_index> check_acyclic() const;
+            void encode_classes(std::vector<type_index> const& order);
+            void encode_interfaces(std::vector<type_index> const& order);
+            bool bucket_interfaces(std::vector<type_index> const& order);
+            void label_interfaces(std::vector<type_index> const& order);
+            bool is_subclass(type_index sub, type_index super) const;
+
+            // The types and their direct supertypes
+            std::vector<Ast::name_id> names;
+            std::unordered_map<Ast::name_id, type_index> indices;
+            std::vector<char> interface_flags;
+            std::vector<type_index> superclasses;
+            std::vector<std::vector<type_index>> direct_interfaces;
+            type_index object;
+
+            // Classes; the depth, display_size slots of display, and the
+            // interval label of each
+            std::vector<std::uint32_t> depths;
+            std::vector<type_index> displays;
+            std::vector<std::uint32_t> interval_begin;
+            std::vector<std::uint32_t> interval_end;
+
+            // Interfaces; the bucket and number of each interface, and a row
+            // of bucket_count() numbers for each type
+            std::vector<std::uint32_t> interface_bucket;
+            std::vector<std::uint16_t> interface_number;
+            std::size_t buckets;
+            std::vector<std::uint16_t> rows;
+
+            // Or the interval label of each interface, in the forest of first
+            // superinterfaces, and the labels kept for each type
+            bool labelled;
+            std::vector<std::uint32_t> interface_begin;
+            std::vector<std::uint32_t> interface_end;
+            std::vector<std::vector<std::uint32_t>> interface_labels;
+    };
+}
+
+#endif //_COMPILER_HIERARCHY_HPP
@@ -0,0 +1,236 @@
+#include "library_snapshot.hpp"
+
+#include "ast_serialize.hpp"
+#include "Error.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Ast
+{
+    namespace
+    {
+        const char magic[4] = { 'J', 'L', 'I', 'B' };
+
+        // Fixed width little endian numbers, for the header and file sizes
+        void put_number(std::string& output, std::uint64_t value, unsigned bytes)
+        {
+            for(unsigned x = 0; x < bytes; x++)
+            {
+                output.push_back(static_cast<char>((value >> (8 * x)) & 0xFF));
+            }
+        }
+
+        std::uint64_t get_number(char const*& current, char const* end, unsigned bytes)
+        {
+            if(static_cast<std::size_t>(end - current) < bytes)
+            {
+                throw Error::Serialization_Error("Truncated library snapshot");
+            }
+            std::uint64_t value = 0;
+            for(unsigned x = 0; x < bytes; x++)
+            {
+                value |= static_cast<std::uint64_t>(static_cast<unsigned char>(current[x])) << (8 * x);
+            }
+            current += bytes;
+            return value;
+        }
+
+        void strip_members(std::list<declaration>& members)
+        {
+            for(declaration& member : members)
+            {
+                if(declaration_method* method = boost::get<declaration_method>(&member))
+                {
+                    if(method->decl.method_body)
+                    {
+                        method->decl.method_body = body();
+                    }
+                }
+                else if(declaration_constructor* constructor = boost::get<declaration_constructor>(&member))
+                {
+                    if(constructor->decl.method_body)
+                    {
+                        constructor->decl.method_body = body();
+                    }
+                }
+                else if(declaration_field* field = boost::get<declaration_field>(&member))
+                {
+                    field->decl.optional_initializer = Maybe<expression>();
+                }
+            }
+        }
+
+        // Closes a file descriptor when leaving scope
+        struct file_descriptor
+        {
+            int fd;
+
+            ~file_descriptor()
+            {
+                if(fd >= 0)
+                {
+                    close(fd);
+                }
+            }
+        };
+
+        // Unmaps a mapping when leaving scope
+        struct mapping
+        {
+            void* data;
+            std::size_t size;
+
+            ~mapping()
+            {
+                if(data != MAP_FAILED)
+                {
+                    munmap(data, size);
+                }
+            }
+        };
+
+        program read_snapshot(std::string const& file, int fd, std::size_t size)
+        {
+            mapping map{ mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0), size };
+            if(map.data == MAP_FAILED)
+            {
+                throw Error::Serialization_Error("Couldn't map library snapshot: " + file);
+            }
+            char const* current = static_cast<char const*>(map.data);
+            char const* end = current + size;
+            // Check the header
+            if(size < sizeof(magic) || std::memcmp(current, magic, sizeof(magic)) != 0)
+            {
+                throw Error::Serialization_Error("Not a library snapshot: " + file);
+            }
+            current += sizeof(magic);
+            if(get_number(current, end, 4) != serialization_version)
+            {
+                throw Error::Serialization_Error("Library snapshot of another version, rebuild it: " + file);
+            }
+            std::uint64_t files = get_number(current, end, 4);
+            // Read the source files, directly from the mapping
+            program library;
+            for(std::uint64_t n = 0; n < files; n++)
+            {
+                std::uint64_t file_size = get_number(current, end, 8);
+                if(static_cast<std::uint64_t>(end - current) < file_size)
+                {
+                    throw Error::Serialization_Error("Truncated library snapshot: " + file);
+                }
+                library.push_back(deserialize(current, static_cast<std::size_t>(file_size)));
+                current += file_size;
+            }
+            if(current != end)
+            {
+                throw Error::Serialization_Error("Trailing data after library snapshot: " + file);
+            }
+            return library;
+        }
+
+        // A loaded snapshot, and the file it was loaded from, as it was
+        struct loaded_snapshot
+        {
+            struct timespec modified;
+            off_t size;
+            std::shared_ptr<program const> library;
+        };
+
+        struct loaded_snapshots
+        {
+            std::mutex lock;
+            std::map<std::string, loaded_snapshot> files;
+        };
+
+        loaded_snapshots& loaded()
+        {
+            static loaded_snapshots snapshots;
+            return snapshots;
+        }
+    }
+
+    source_file declarations_only(source_file const& sf)
+    {
+        source_file declarations = sf;
+        if(class_declaration* klass = boost::get<class_declaration>(&declarations.type))
+        {
+            strip_members(klass->members);
+        }
+        else
+        {
+            strip_members(boost::get<interface_declaration>(declarations.type).members);
+        }
+        return declarations;
+    }
+
+    void write_library_snapshot(program const& library, std::string const& file)
+    {
+        std::string data(magic, sizeof(magic));
+        put_number(data, serialization_version, 4);
+        put_number(data, library.size(), 4);
+        std::string serialized;
+        for(source_file const& sf : library)
+        {
+            serialized.clear();
+            serialize(declarations_only(sf), serialized);
+            put_number(data, serialized.size(), 8);
+            data += serialized;
+        }
+        // Write to a temporary file, and rename it into place, such that
+        // running compilers never see a partially written snapshot
+        std::string temporary = file + ".tmp" + std::to_string(getpid());
+        std::FILE* output = std::fopen(temporary.c_str(), "wb");
+        if(output == nullptr)
+        {
+            throw Error::Serialization_Error("Couldn't write library snapshot: " + file);
+        }
+        bool written = std::fwrite(data.data(), 1, data.size(), output) == data.size();
+        written = (std::fclose(output) == 0) && written;
+        if(written == false || std::rename(temporary.c_str(), file.c_str()) != 0)
+        {
+            std::remove(temporary.c_str());
+            throw Error::Serialization_Error("Couldn't write library snapshot: " + file);
+        }
+    }
+
+    std::shared_ptr<program const> load_library_snapshot(std::string const& file)
+    {
+        file_descriptor input{ open(file.c_str(), O_RDONLY) };
+        struct stat info;
+        if(input.fd < 0 || fstat(input.fd, &info) != 0)
+        {
+            throw Error::Serialization_Error("Couldn't open library snapshot: " + file);
+        }
+        // Reuse the snapshot if the file hasn't changed since it was loaded
+        loaded_snapshots& snapshots = loaded();
+        std::lock_guard<std::mutex> lock(snapshots.lock);
+        auto it = snapshots.files.find(file);
+        if(it != snapshots.files.end() && it->second.size == info.st_size &&
+           it->second.modified.tv_sec == info.st_mtim.tv_sec && it->second.modified.tv_nsec == info.st_mtim.tv_nsec)
+        {
+            return it->second.library;
+        }
+        std::shared_ptr<program const> library = std::make_shared<program const>(
+            read_snapshot(file, input.fd, static_cast<std::size_t>(info.st_size)));
+        snapshots.files[file] = loaded_snapshot{ info.st_mtim, info.st_size, library };
+        return library;
+    }
+
+    void forget_library_snapshots()
+    {
+        loaded_snapshots& snapshots = loaded();
+        std::lock_guard<std::mutex> lock(snapshots.lock);
+        snapshots.files.clear();
+    }
+}
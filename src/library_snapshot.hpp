@@ -0,0 +1,45 @@
+#ifndef _COMPILER_LIBRARY_SNAPSHOT_HPP
+#define _COMPILER_LIBRARY_SNAPSHOT_HPP
+
+#include "ast.hpp"
+
+#include <memory>
+#include <string>
+
+/************************************************************************/
+/** {2 Precompiled standard library}                                    */
+/************************************************************************/
+// The standard library (java.lang, java.io, java.util) is compiled once,
+// into a snapshot of its declarations; the types, as declared (with their
+// extends and implements clauses), and the signatures of their members
+// (bodies and initializers are left out). The compiler maps the snapshot
+// and deserializes it, rather than lexing and parsing the library.
+//
+// Only parsing is saved; the library types still join the environment, and
+// the type hierarchy (library and program together) is still built, on
+// every compile.
+//
+// The snapshot is a header (magic, serialization version and file count),
+// followed by the serialized source files (see ast_serialize.hpp), each
+// prefixed by its size.
+namespace Ast
+{
+    /** The declarations of sf; method and constructor bodies are emptied
+     *  (their presence is kept, for abstract checks), and field initializers
+     *  are dropped */
+    source_file declarations_only(source_file const& sf);
+
+    /** Write the declarations of library to file; throws
+     *  Error::Serialization_Error if it can't be written */
+    void write_library_snapshot(program const& library, std::string const& file);
+    /** Read the library back from file; throws Error::Serialization_Error if
+     *  it can't be read, or is malformed, or of another version.
+     *  Snapshots are loaded once per process (and again if the file changes),
+     *  such that servers and batches share them across compiles */
+    std::shared_ptr<program const> load_library_snapshot(std::string const& file);
+    /** Drop the snapshots loaded, as they hold on to names; such that they
+     *  can be dropped from the name table (see truncate_names) */
+    void forget_library_snapshots();
+}
+
+#endif //_COMPILER_LIBRARY_SNAPSHOT_HPP
@@ -1,118 +1,58 @@
-#include "ast.hpp"
-#include "ast_pp.hpp"
-
-#include "utility.hpp"
-
-#include "ast_generate.hpp"
-#include "Error.hpp"
-
-#include "Lexer_debug.hpp"
+#include "compiler.hpp"
+#include "server.hpp"
+#include "batch.hpp"
+#include "output_sink.hpp"
 
+#include <algorithm>
 #include <iostream>
-#include <fstream>
 #include <string>
-
-///////////////////////////////////////////////////////////////////////////////
-//  Helper function reading a file into a string
-///////////////////////////////////////////////////////////////////////////////
-std::string read_from_file(std::string infile)
-{
-    std::ifstream instream(infile);
-    if (!instream.is_open()) {
-        std::cerr << "Couldn't open file: " << infile << std::endl;
-        exit(-1);
-    }
-    instream.unsetf(std::ios::skipws);      // No white space skipping!
-    return std::string(std::istreambuf_iterator<char>(instream.rdbuf()),
-                       std::istreambuf_iterator<char>());
-}
+#include <vector>
 
 #include <boost/program_options.hpp>
 namespace po = boost::program_options;
 
 int main(int argc, char* argv[])
 {
-    po::options_description desc("Allowed options");
+    std::vector<std::string> arguments(argv + 1, argv + argc);
+
+    // Check for server, client and batch modes, the remaining options are handled by compile
+    po::options_description desc("Server options");
     desc.add_options()
-        ("help", "produce help message")
-        ("debug-file", po::value<std::vector<std::string>>(), "output a debug file for the specified phases")
-        ("input-file", po::value<std::vector<std::string>>(), "input file")
+        ("server", po::value<std::string>(), "serve compile requests on the specified Unix socket")
+        ("threads", po::value<unsigned>()->default_value(0), "number of worker threads for --server and --batch (0 for one per core)")
+        ("client", po::value<std::string>(), "forward the compile to the server on the specified Unix socket")
+        ("batch", po::value<std::string>(), "compile the programs listed in the specified manifest, one per line, and summarize which passed")
         ;
 
-    po::positional_options_description p;
-    p.add("input-file", -1);
-
-    po::variables_map vm;        
-    po::store(po::command_line_parser(argc, argv).options(desc).positional(p).run(), vm);
-    po::notify(vm);    
+    po::variables_map vm;
+    po::parsed_options parsed = po::command_line_parser(arguments).options(desc).allow_unregistered().run();
+    po::store(parsed, vm);
+    po::notify(vm);
 
-    if (vm.count("help"))
+    if (vm.count("server"))
     {
-        std::cout << "Usage: options_description [options]" << std::endl;
-        std::cout << desc << std::endl;
-        return 0;
+        return Server::run_server(vm["server"].as<std::string>(), vm["threads"].as<unsigned>());
     }
-
-    if (!vm.count("input-file"))
+    if (vm.count("batch"))
     {
-        std::cout << "Remember to specify files;" << std::endl;
-        return 0;
+        return Batch::run_batch(vm["batch"].as<std::string>(), vm["threads"].as<unsigned>());
     }
 
-    std::vector<std::string> files = vm["input-file"].as<std::vector<std::string>>();
-    std::cout << "Input files are: ";
-    for(std::string file : files)
+    std::vector<std::string> compile_arguments = po::collect_unrecognized(parsed.options, po::include_positional);
+    if (vm.count("client"))
     {
-        std::cout << file;
-    } 
-    std::cout << std::endl;
-
-    // If we reach this, we've got arguments!
-    // So let's read the files into strings;
-    std::vector<std::pair<std::string, std::string>> files_contents;
-    for(unsigned int x=0; x<files.size(); x++)
-    {
-        // Read the file in argv[x], into a string;
-        std::string file_contents(read_from_file(files[x]));
-        // And add it to our list
-        files_contents.push_back(std::make_pair(files[x], file_contents));
+        return Server::run_client(vm["client"].as<std::string>(), compile_arguments);
     }
 
-    if (vm.count("debug-file"))
+    int status;
     {
-        std::vector<std::string> debug_files = vm["debug-file"].as<std::vector<std::string>>();
-        std::cout << "Generating debug output for phases: ";
-        for(std::string file : debug_files)
-        {
-            std::cout << file;
-        } 
-        std::cout << std::endl;
-
-        std::vector<std::string>::iterator it = std::find_if(debug_files.begin(), debug_files.end(), [](std::string str){ return str == "lexer"; });
-        if(it != debug_files.end())
-        {
-            // Debug our lexer
-            Lexer::debug_lexer(files_contents);
-        }
-  
-    } 
-
-    // Start running the compiler
-    std::cout << "Applying phases:" << std::endl;
-    
-    try
-    {
-        // Let's lex and parse the input;
-        Ast::program ast = apply_phase("lexing & parsing", Ast::generate_ast, files_contents);
-        // Pretty print the ast
-        Ast::pretty_print(ast);
-        // Let's weed the ast
-        // WAst::program wast = apply_phase("weeding", weed, ast);
+        output_sink out(stdout);
+        status = compile(compile_arguments, "", out);
     }
-    catch(Error::Syntax_Error& e)
+    // List our own options along with those of the compiler
+    if (std::find(compile_arguments.begin(), compile_arguments.end(), "--help") != compile_arguments.end())
     {
-        std::cout << e.what();
+        std::cout << desc << std::endl;
     }
-
-    return 0;
+    return status;
 }
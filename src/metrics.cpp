@@ -0,0 +1,124 @@
+#include "metrics.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <ctime>
+
+#include <sys/resource.h>
+
+namespace
+{
+    // Relaxed is enough, we only ever read totals
+    std::atomic<std::uint64_t> process_count(0);
+    std::atomic<std::uint64_t> process_bytes(0);
+    thread_local std::uint64_t thread_count  = 0;
+    thread_local std::uint64_t thread_bytes  = 0;
+
+    double cpu_seconds(clockid_t clock)
+    {
+        timespec now;
+        clock_gettime(clock, &now);
+        return static_cast<double>(now.tv_sec) + static_cast<double>(now.tv_nsec) / 1e9;
+    }
+
+    long peak_rss_kib()
+    {
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss;
+    }
+}
+
+namespace Metrics
+{
+    void record_allocation(std::size_t bytes)
+    {
+        process_count.fetch_add(1, std::memory_order_relaxed);
+        process_bytes.fetch_add(bytes, std::memory_order_relaxed);
+        thread_count++;
+        thread_bytes += bytes;
+    }
+
+    allocation_counters process_allocations()
+    {
+        return { process_count.load(std::memory_order_relaxed), process_bytes.load(std::memory_order_relaxed) };
+    }
+
+    allocation_counters thread_allocations()
+    {
+        return { thread_count, thread_bytes };
+    }
+
+    stopwatch::stopwatch(scope measured)
+        : measured(measured),
+          wall_start(std::chrono::steady_clock::now()),
+          cpu_start(cpu_seconds(measured == scope::process ? CLOCK_PROCESS_CPUTIME_ID : CLOCK_THREAD_CPUTIME_ID)),
+          peak_rss_start(measured == scope::process ? peak_rss_kib() : 0),
+          allocations_start(measured == scope::process ? process_allocations() : thread_allocations())
+    {
+    }
+
+    sample stopwatch::stop() const
+    {
+        std::chrono::duration<double> wall = std::chrono::steady_clock::now() - wall_start;
+        double cpu = cpu_seconds(measured == scope::process ? CLOCK_PROCESS_CPUTIME_ID : CLOCK_THREAD_CPUTIME_ID);
+        long peak_rss = measured == scope::process ? peak_rss_kib() : 0;
+        allocation_counters allocations = measured == scope::process ? process_allocations() : thread_allocations();
+        return { wall.count(), cpu - cpu_start, peak_rss - peak_rss_start,
+                 allocations.count - allocations_start.count, allocations.bytes - allocations_start.bytes };
+    }
+
+    namespace
+    {
+        void write_number(double value, output_sink& out)
+        {
+            char buffer[32];
+            std::snprintf(buffer, sizeof(buffer), "%.6f", value);
+            out << buffer;
+        }
+
+        void write_sample(sample const& s, output_sink& out)
+        {
+            out << "\"wall_seconds\": ";
+            write_number(s.wall_seconds, out);
+            out << ", \"cpu_seconds\": ";
+            write_number(s.cpu_seconds, out);
+            out << ", \"peak_rss_delta_kib\": " << s.peak_rss_delta_kib;
+            out << ", \"allocations\": " << s.allocations;
+            out << ", \"allocated_bytes\": " << s.allocated_bytes;
+        }
+    }
+
+    void write_json(std::vector<phase_metrics> const& phases, output_sink& out)
+    {
+        out << "{\n  \"phases\": [";
+        bool first_phase = true;
+        for(phase_metrics const& phase : phases)
+        {
+            out << (first_phase ? "\n" : ",\n");
+            first_phase = false;
+            out << "    { \"phase\": ";
+            write_json_string(out, phase.phase);
+            out << ", ";
+            write_sample(phase.measured, out);
+            if(phase.files.empty() == false)
+            {
+                out << ",\n      \"files\": [";
+                bool first_file = true;
+                for(file_metrics const& file : phase.files)
+                {
+                    out << (first_file ? "\n" : ",\n");
+                    first_file = false;
+                    out << "        { \"file\": ";
+                    write_json_string(out, file.file);
+                    out << ", ";
+                    write_sample(file.measured, out);
+                    out << " }";
+                }
+                out << "\n      ]";
+            }
+            out << " }";
+        }
+        out << "\n  ]\n}\n";
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef _COMPILER_METRICS_HPP
+#define _COMPILER_METRICS_HPP
+
+#include "output_sink.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/************************************************************************/
+/** {2 Phase metrics}                                                   */
+/************************************************************************/
+// Wall time, CPU time, peak RSS and allocations, for phases and files.
+// Allocations are counted for the process, and for each thread (such that
+// per file numbers are exact, even when files are processed in parallel).
+namespace Metrics
+{
+    struct allocation_counters
+    {
+        std::uint64_t count;
+        std::uint64_t bytes;
+    };
+
+    /** Count an allocation; called by the global operator new of the compiler
+     *  (see count_allocations.cpp), which is not part of the library, such
+     *  that embedders keep their own operator new (and get no counts) */
+    void record_allocation(std::size_t bytes);
+
+    /** Allocations by the process, and by the calling thread, so far */
+    allocation_counters process_allocations();
+    allocation_counters thread_allocations();
+
+    struct sample
+    {
+        double wall_seconds;
+        double cpu_seconds;
+        // Growth of the peak resident set size, only measured for the process
+        long peak_rss_delta_kib;
+        std::uint64_t allocations;
+        std::uint64_t allocated_bytes;
+    };
+
+    // Measures from construction, until stop is called
+    class stopwatch
+    {
+        public:
+            enum class scope
+            {
+                process,    // Everything the process does (i.e. a phase)
+                thread      // Only the calling thread (i.e. a file)
+            };
+
+            explicit stopwatch(scope measured);
+            sample stop() const;
+
+        private:
+            scope measured;
+            std::chrono::steady_clock::time_point wall_start;
+            double cpu_start;
+            long peak_rss_start;
+            allocation_counters allocations_start;
+    };
+
+    struct file_metrics
+    {
+        std::string file;
+        sample measured;
+    };
+
+    struct phase_metrics
+    {
+        std::string phase;
+        sample measured;
+        // Only for per file phases
+        std::vector<file_metrics> files;
+    };
+
+    /** Write the metrics of a run as JSON */
+    void write_json(std::vector<phase_metrics> const& phases, output_sink& out);
+}
+
+#endif //_COMPILER_METRICS_HPP
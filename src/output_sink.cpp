@@ -0,0 +1,151 @@
+#include "output_sink.hpp"
+
+#include <cstring>
+
+output_sink::output_sink(std::FILE* file)
+    : file(file), memory(nullptr), buffer(new char[buffer_size]), used(0)
+{
+}
+
+output_sink::output_sink(std::string& memory)
+    : file(nullptr), memory(&memory), used(0)
+{
+}
+
+output_sink::~output_sink()
+{
+    flush();
+}
+
+void output_sink::write(char const* data, std::size_t size)
+{
+    // Memory is appended to directly
+    if(memory)
+    {
+        memory->append(data, size);
+        return;
+    }
+    // Make room in the buffer, if needed
+    if(used + size > buffer_size)
+    {
+        flush();
+    }
+    // Huge writes bypass the buffer entirely
+    if(size > buffer_size)
+    {
+        std::fwrite(data, 1, size, file);
+        return;
+    }
+    std::memcpy(buffer.get() + used, data, size);
+    used += size;
+}
+
+void output_sink::flush()
+{
+    if(file && used > 0)
+    {
+        std::fwrite(buffer.get(), 1, used, file);
+        std::fflush(file);
+    }
+    used = 0;
+}
+
+void output_sink::write_unsigned(unsigned long long value, bool negative)
+{
+    // Generate the digits back to front, in a small local buffer
+    char digits[24];
+    char* end   = digits + sizeof(digits);
+    char* start = end;
+    do
+    {
+        *--start = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while(value != 0);
+    if(negative)
+    {
+        *--start = '-';
+    }
+    write(start, static_cast<std::size_t>(end - start));
+}
+
+output_sink& output_sink::operator<<(char c)
+{
+    if(file && used < buffer_size)
+    {
+        buffer[used++] = c;
+    }
+    else
+    {
+        write(&c, 1);
+    }
+    return *this;
+}
+
+output_sink& output_sink::operator<<(char const* str)
+{
+    write(str, std::strlen(str));
+    return *this;
+}
+
+output_sink& output_sink::operator<<(std::string const& str)
+{
+    write(str.data(), str.size());
+    return *this;
+}
+
+output_sink& output_sink::operator<<(int value)
+{
+    return *this << static_cast<long long>(value);
+}
+
+output_sink& output_sink::operator<<(unsigned value)
+{
+    return *this << static_cast<unsigned long long>(value);
+}
+
+output_sink& output_sink::operator<<(long value)
+{
+    return *this << static_cast<long long>(value);
+}
+
+output_sink& output_sink::operator<<(unsigned long value)
+{
+    return *this << static_cast<unsigned long long>(value);
+}
+
+output_sink& output_sink::operator<<(long long value)
+{
+    // Negate as unsigned, such that the smallest value doesn't overflow
+    unsigned long long magnitude = static_cast<unsigned long long>(value);
+    write_unsigned(value < 0 ? 0 - magnitude : magnitude, value < 0);
+    return *this;
+}
+
+output_sink& output_sink::operator<<(unsigned long long value)
+{
+    write_unsigned(value, false);
+    return *this;
+}
+
+void write_json_string(output_sink& out, std::string const& str)
+{
+    out << '"';
+    for(char c : str)
+    {
+        if(c == '"' || c == '\\')
+        {
+            out << '\\' << c;
+        }
+        else if(static_cast<unsigned char>(c) < 0x20)
+        {
+            // Control characters as \u00XX
+            const char digits[] = "0123456789abcdef";
+            out << "\\u00" << digits[(c >> 4) & 0xF] << digits[c & 0xF];
+        }
+        else
+        {
+            out << c;
+        }
+    }
+    out << '"';
+}
@@ -0,0 +1,57 @@
+#ifndef _COMPILER_OUTPUT_SINK_HPP
+#define _COMPILER_OUTPUT_SINK_HPP
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <memory>
+
+/************************************************************************/
+/** {2 Buffered output sink}                                            */
+/************************************************************************/
+// A light-weight alternative to std::ostream for bulk output (i.e. pretty
+// printing); output is collected in a large buffer, and handed to the
+// target in big chunks, rather than per token.
+class output_sink
+{
+    public:
+        // Write to a C stream (i.e. stdout, or a file opened by the caller)
+        explicit output_sink(std::FILE* file);
+        // Write into a string in memory
+        explicit output_sink(std::string& memory);
+        // Flushes any remaining output
+        ~output_sink();
+
+        output_sink(output_sink const&) = delete;
+        output_sink& operator=(output_sink const&) = delete;
+
+        output_sink& operator<<(char c);
+        output_sink& operator<<(char const* str);
+        output_sink& operator<<(std::string const& str);
+        output_sink& operator<<(int value);
+        output_sink& operator<<(unsigned value);
+        output_sink& operator<<(long value);
+        output_sink& operator<<(unsigned long value);
+        output_sink& operator<<(long long value);
+        output_sink& operator<<(unsigned long long value);
+
+        void write(char const* data, std::size_t size);
+        // Hand the buffered output to the target
+        void flush();
+
+    private:
+        void write_unsigned(unsigned long long value, bool negative);
+
+        static const std::size_t buffer_size = 64 * 1024;
+
+        std::FILE* file;
+        std::string* memory;
+        // Only allocated when writing to a C stream, memory is appended to directly
+        std::unique_ptr<char[]> buffer;
+        std::size_t used;
+};
+
+// Write str as a quoted JSON string, escaping as needed
+void write_json_string(output_sink& out, std::string const& str);
+
+#endif //_COMPILER_OUTPUT_SINK_HPP
@@ -0,0 +1,160 @@
+#include "phases.hpp"
+
+#include "trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+
+namespace Phases
+{
+    compilation::compilation(std::vector<std::pair<std::string, std::string>> files_contents)
+        : jobs(0), files_contents(std::move(files_contents)), environment(this->files_contents.size()),
+          scopes(this->files_contents.size())
+    {
+        // Make room for the ast of every file, such that per file phases can
+        // fill them in independently
+        ast.resize(this->files_contents.size());
+        for(Ast::source_file& file : ast)
+        {
+            ast_files.push_back(&file);
+        }
+    }
+
+    namespace
+    {
+        // Run a per file phase over every file, measuring each file (into
+        // file_samples), and rethrowing the error of the first failing file
+        void run_per_file(phase const& p, compilation& c, std::vector<Metrics::sample>& file_samples)
+        {
+            std::size_t files = c.file_count();
+            std::vector<std::exception_ptr> errors(files);
+            file_samples.resize(files);
+            std::atomic<std::size_t> next_file(0);
+            auto worker = [&]()
+            {
+                for(std::size_t n = next_file++; n < files; n = next_file++)
+                {
+                    // Each file is handled by a single thread, so we measure the thread
+                    Metrics::stopwatch file_watch(Metrics::stopwatch::scope::thread);
+                    Trace::span task_span("task", "pool", c.files_contents[n].first);
+                    try
+                    {
+                        p.run_file(c, n);
+                    }
+                    catch(...)
+                    {
+                        errors[n] = std::current_exception();
+                    }
+                    file_samples[n] = file_watch.stop();
+                }
+            };
+            std::size_t num_workers = 1;
+            if(p.execution == execution::parallel)
+            {
+                unsigned threads = c.jobs > 0 ? c.jobs : std::max(std::thread::hardware_concurrency(), 1u);
+                num_workers = std::min<std::size_t>(threads, files);
+            }
+            std::vector<std::thread> workers;
+            for(std::size_t n = 1; n < num_workers; n++)
+            {
+                workers.emplace_back(worker);
+            }
+            // This thread works too
+            worker();
+            for(auto& thread : workers)
+            {
+                thread.join();
+            }
+            for(std::exception_ptr& error : errors)
+            {
+                if(error)
+                {
+                    std::rethrow_exception(error);
+                }
+            }
+        }
+    }
+
+    void registry::add(phase p)
+    {
+        if(contains(p.name))
+        {
+            throw std::logic_error("Phase registered twice: " + p.name);
+        }
+        if((p.scope == scope::per_file && !p.run_file) || (p.scope == scope::whole_program && !p.run_program))
+        {
+            throw std::logic_error("Phase without a function for its scope: " + p.name);
+        }
+        // Every input must be available, when the phase runs
+        for(artifact input : p.inputs)
+        {
+            bool available = (input == artifact::sources) || std::any_of(phases.begin(), phases.end(), [input](phase const& earlier)
+            {
+                return std::find(earlier.outputs.begin(), earlier.outputs.end(), input) != earlier.outputs.end();
+            });
+            if(available == false)
+            {
+                throw std::logic_error("Phase input not produced by an earlier phase: " + p.name);
+            }
+        }
+        phases.push_back(std::move(p));
+    }
+
+    bool registry::contains(std::string const& name) const
+    {
+        return std::any_of(phases.begin(), phases.end(), [&name](phase const& p){ return p.name == name; });
+    }
+
+    std::vector<std::string> registry::names() const
+    {
+        std::vector<std::string> output;
+        for(phase const& p : phases)
+        {
+            output.push_back(p.name);
+        }
+        return output;
+    }
+
+    bool registry::run(compilation& c, output_sink& log, Maybe<std::string> const& stop_after,
+                       std::vector<Metrics::phase_metrics>* metrics) const
+    {
+        for(phase const& p : phases)
+        {
+            log << " *** " << p.name << '\n';
+            Metrics::stopwatch phase_watch(Metrics::stopwatch::scope::process);
+            Trace::span phase_span(p.name.c_str(), "phase");
+            std::vector<Metrics::sample> file_samples;
+            if(p.scope == scope::per_file)
+            {
+                run_per_file(p, c, file_samples);
+                if(p.run_program)
+                {
+                    p.run_program(c, log);
+                }
+            }
+            else
+            {
+                p.run_program(c, log);
+            }
+            // Record how it went
+            if(metrics)
+            {
+                Metrics::phase_metrics measured{ p.name, phase_watch.stop(), {} };
+                for(std::size_t n = 0; n < file_samples.size(); n++)
+                {
+                    measured.files.push_back({ c.files_contents[n].first, file_samples[n] });
+                }
+                metrics->push_back(std::move(measured));
+            }
+            // Stop here, if nothing later is wanted
+            if(stop_after && *stop_after == p.name)
+            {
+                return &p == &phases.back();
+            }
+        }
+        return true;
+    }
+}
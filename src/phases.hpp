@@ -0,0 +1,148 @@
+#ifndef _COMPILER_PHASES_HPP
+#define _COMPILER_PHASES_HPP
+
+#include "ast.hpp"
+#include "ast_dependencies.hpp"
+#include "environment.hpp"
+#include "hierarchy.hpp"
+#include "type_checker.hpp"
+#include "type_scope.hpp"
+#include "output_sink.hpp"
+#include "metrics.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+/************************************************************************/
+/** {2 The phase pipeline}                                              */
+/************************************************************************/
+// Phases are registered in the order they run, each declaring the artifacts
+// it consumes and produces, and whether it runs once for the whole program,
+// or once per file (optionally in parallel, across the files).
+namespace Phases
+{
+    /** {3 Artifacts} */
+    enum class artifact
+    {
+        sources,        // The contents of the input files
+        ast,            // The ast of each file
+        dependencies,   // The dependency graph, and the units affected by changes
+        environment,    // The global class environment
+        scopes,         // The types visible in each file, by simple name
+        hierarchy,      // The supertypes of every type, encoded for subtype checks
+        locals,         // Names of locals resolved to their slots, in the ast
+        types,          // The type of every expression in the method bodies
+    };
+
+    // The artifacts, as they flow through the pipeline, along with the
+    // options for the phases
+    struct compilation
+    {
+        explicit compilation(std::vector<std::pair<std::string, std::string>> files_contents);
+
+        compilation(compilation const&) = delete;
+        compilation& operator=(compilation const&) = delete;
+
+        std::size_t file_count() const
+        {
+            return files_contents.size();
+        }
+
+        // Whether the file at index must be checked again; only those affected
+        // by the changes since the last run are, when dependencies are tracked
+        bool is_affected(std::size_t index) const
+        {
+            return !dependencies || affected_units.count(files_contents[index].first) != 0;
+        }
+
+        // Options
+        Maybe<std::string> cache_directory;
+        Maybe<std::string> ast_stats_file;
+        // Threads for the parallel phases, 0 for one per core
+        unsigned jobs;
+        // The precompiled standard library (see library_snapshot.hpp), if any;
+        // its types join the environment, but it goes through no other phase
+        std::shared_ptr<Ast::program const> library;
+        // The content_hash of the library snapshot, when dependencies are tracked
+        std::uint64_t library_hash = 0;
+
+        // Artifacts
+        std::vector<std::pair<std::string, std::string>> files_contents;
+        // One source file per input file, in the same order
+        Ast::program ast;
+        std::vector<Ast::source_file*> ast_files;
+        // Only tracked when caching; the files affected by changes, by name
+        Maybe<Ast::dependency_graph> dependencies;
+        std::set<std::string> affected_units;
+        // Sized for the types of the files (and the library, once set), built
+        // by the environment phase
+        Environment::class_environment environment;
+        // One scope per file, in the same order; files with the same imports
+        // share theirs (through the cache)
+        Environment::scope_cache scope_cache;
+        std::vector<std::shared_ptr<Environment::type_scope const>> scopes;
+        Maybe<Hierarchy::type_hierarchy> hierarchy;
+        Typing::expression_types expression_types;
+    };
+
+    /** {3 Phases} */
+    enum class scope
+    {
+        per_file,
+        whole_program
+    };
+
+    enum class execution
+    {
+        sequential,
+        parallel        // Only for per_file phases; files run concurrently
+    };
+
+    struct phase
+    {
+        std::string name;
+        std::vector<artifact> inputs;
+        std::vector<artifact> outputs;
+        Phases::scope scope;
+        Phases::execution execution;
+        // Set run_program for whole_program phases, and run_file for per_file
+        // phases (called with the index of the file); per_file phases may set
+        // run_program too, to run once every file is done (i.e. to combine
+        // the results of the files)
+        std::function<void(compilation&, output_sink&)> run_program;
+        std::function<void(compilation&, std::size_t)> run_file;
+    };
+
+    /** {3 Registry} */
+    class registry
+    {
+        public:
+            /** Add a phase, to run after those already added; throws
+             *  std::logic_error if its inputs are not produced by an earlier
+             *  phase, or its name is taken */
+            void add(phase p);
+
+            /** Whether there is a phase by that name */
+            bool contains(std::string const& name) const;
+            std::vector<std::string> names() const;
+
+            /** Run the phases in order, logging each to log, stopping after the
+             *  phase named stop_after, if given. Errors thrown by a phase are
+             *  passed on; for per_file phases, the one of the first file failing.
+             *  If metrics is given, the metrics of every phase run (and of every
+             *  file for per_file phases) are appended to it.
+             *  Returns whether every phase was run. */
+            bool run(compilation& c, output_sink& log, Maybe<std::string> const& stop_after,
+                     std::vector<Metrics::phase_metrics>* metrics = nullptr) const;
+
+        private:
+            std::vector<phase> phases;
+    };
+}
+
+#endif //_COMPILER_PHASES_HPP
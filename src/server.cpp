@@ -0,0 +1,287 @@
+#include "server.hpp"
+
+#include "compiler.hpp"
+#include "output_sink.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace Server
+{
+    namespace
+    {
+        /* *************** Framing *************** */
+        // Requests larger than these are refused, rather than allocated for;
+        // the output in replies is not limited, it comes from the server
+        const std::uint32_t max_request_string = 16 * 1024 * 1024;
+        const std::uint32_t max_request_arguments = 64 * 1024;
+
+        bool write_all(int fd, char const* data, std::size_t size)
+        {
+            while(size > 0)
+            {
+                ssize_t written = write(fd, data, size);
+                if(written <= 0)
+                {
+                    return false;
+                }
+                data += written;
+                size -= static_cast<std::size_t>(written);
+            }
+            return true;
+        }
+
+        bool read_all(int fd, char* data, std::size_t size)
+        {
+            while(size > 0)
+            {
+                ssize_t got = read(fd, data, size);
+                if(got <= 0)
+                {
+                    return false;
+                }
+                data += got;
+                size -= static_cast<std::size_t>(got);
+            }
+            return true;
+        }
+
+        // Integers are sent as 4 bytes, most significant first
+        bool write_integer(int fd, std::uint32_t value)
+        {
+            char bytes[4];
+            for(unsigned x = 0; x < 4; x++)
+            {
+                bytes[x] = static_cast<char>((value >> (24 - 8 * x)) & 0xFF);
+            }
+            return write_all(fd, bytes, 4);
+        }
+
+        bool read_integer(int fd, std::uint32_t& value)
+        {
+            unsigned char bytes[4];
+            if(read_all(fd, reinterpret_cast<char*>(bytes), 4) == false)
+            {
+                return false;
+            }
+            value = 0;
+            for(unsigned x = 0; x < 4; x++)
+            {
+                value = (value << 8) | bytes[x];
+            }
+            return true;
+        }
+
+        bool write_string(int fd, std::string const& str)
+        {
+            return write_integer(fd, static_cast<std::uint32_t>(str.size())) && write_all(fd, str.data(), str.size());
+        }
+
+        bool read_string(int fd, std::string& str, std::uint32_t max_size)
+        {
+            std::uint32_t size;
+            if(read_integer(fd, size) == false || size > max_size)
+            {
+                return false;
+            }
+            str.resize(size);
+            return read_all(fd, &str[0], size);
+        }
+
+        sockaddr_un socket_address(std::string const& socket_path)
+        {
+            sockaddr_un address;
+            std::memset(&address, 0, sizeof(address));
+            address.sun_family = AF_UNIX;
+            std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+            return address;
+        }
+
+        /* *************** Requests *************** */
+        // Read a request, compile it, and reply
+        void serve(int client)
+        {
+            std::string working_directory;
+            std::uint32_t count;
+            if(read_string(client, working_directory, max_request_string) == false ||
+               read_integer(client, count) == false || count > max_request_arguments)
+            {
+                return;
+            }
+            std::vector<std::string> arguments(count);
+            for(std::string& argument : arguments)
+            {
+                if(read_string(client, argument, max_request_string) == false)
+                {
+                    return;
+                }
+            }
+            Trace::span span("request", "server", working_directory);
+            // Collect the output, and send it back in one go
+            std::string output;
+            int status;
+            {
+                output_sink out(output);
+                try
+                {
+                    status = compile(arguments, working_directory, out);
+                }
+                catch(std::exception& e)
+                {
+                    // Report errors compile() lets through, rather than take
+                    // the server down along with the other requests
+                    out << "Internal error: " << e.what() << '\n';
+                    status = -1;
+                }
+            }
+            write_string(client, output) && write_integer(client, static_cast<std::uint32_t>(status));
+        }
+
+        // Connections waiting to be served by the pool
+        struct connection_queue
+        {
+            std::mutex lock;
+            std::condition_variable ready;
+            std::deque<int> connections;
+
+            void push(int client)
+            {
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    connections.push_back(client);
+                }
+                ready.notify_one();
+            }
+
+            int pop()
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                ready.wait(guard, [this]{ return connections.empty() == false; });
+                int client = connections.front();
+                connections.pop_front();
+                return client;
+            }
+        };
+    }
+
+    int run_server(std::string const& socket_path, unsigned threads)
+    {
+        // Clients hanging up should not take down the server
+        std::signal(SIGPIPE, SIG_IGN);
+
+        int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if(listener < 0)
+        {
+            std::perror("socket");
+            return -1;
+        }
+        // Remove the socket of a previous server, if any
+        unlink(socket_path.c_str());
+        sockaddr_un address = socket_address(socket_path);
+        if(bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, 64) != 0)
+        {
+            std::perror("bind");
+            close(listener);
+            return -1;
+        }
+
+        // Start the worker pool
+        connection_queue queue;
+        if(threads == 0)
+        {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        std::vector<std::thread> workers;
+        for(unsigned x = 0; x < threads; x++)
+        {
+            workers.emplace_back([&queue]
+            {
+                while(true)
+                {
+                    int client = queue.pop();
+                    serve(client);
+                    close(client);
+                }
+            });
+        }
+        std::cout << "Serving on " << socket_path << " with " << threads << " threads" << std::endl;
+
+        // And hand it connections
+        while(true)
+        {
+            int client = accept(listener, nullptr, nullptr);
+            if(client < 0)
+            {
+                if(errno == EINTR)
+                {
+                    continue;
+                }
+                std::perror("accept");
+                break;
+            }
+            queue.push(client);
+        }
+        // Workers never finish, so we cannot join them
+        for(std::thread& worker : workers)
+        {
+            worker.detach();
+        }
+        close(listener);
+        return -1;
+    }
+
+    int run_client(std::string const& socket_path, std::vector<std::string> const& arguments)
+    {
+        // Find our working directory, such that the server can resolve paths
+        char buffer[4096];
+        std::string working_directory = getcwd(buffer, sizeof(buffer)) ? buffer : "";
+
+        int server = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un address = socket_address(socket_path);
+        if(server < 0 || connect(server, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+        {
+            // No server, so do the work ourselves
+            if(server >= 0)
+            {
+                close(server);
+            }
+            output_sink out(stdout);
+            return compile(arguments, "", out);
+        }
+
+        // Send the request
+        bool sent = write_string(server, working_directory) && write_integer(server, static_cast<std::uint32_t>(arguments.size()));
+        for(std::string const& argument : arguments)
+        {
+            sent = sent && write_string(server, argument);
+        }
+        // And wait for the reply
+        std::string output;
+        std::uint32_t status;
+        if(sent == false || read_string(server, output, std::numeric_limits<std::uint32_t>::max()) == false || read_integer(server, status) == false)
+        {
+            std::cerr << "Lost connection to compile server at " << socket_path << std::endl;
+            close(server);
+            return -1;
+        }
+        close(server);
+        std::fwrite(output.data(), 1, output.size(), stdout);
+        return static_cast<int>(status);
+    }
+}
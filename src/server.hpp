@@ -0,0 +1,28 @@
+#ifndef _COMPILER_SERVER_HPP
+#define _COMPILER_SERVER_HPP
+
+#include <string>
+#include <vector>
+
+/************************************************************************/
+/** {2 Compile server}                                                  */
+/************************************************************************/
+// A long-lived compiler process, accepting compile requests over a Unix
+// domain socket, such that the start up cost is only paid once.
+//
+// A request is the working directory of the client followed by its
+// arguments, and the reply is the output of the compile followed by its
+// exit status; all strings are prefixed by their length. Requests run
+// concurrently, except those recording a trace, a grammar profile or
+// metrics (--stats), as those are process wide; such a request runs alone.
+namespace Server
+{
+    /** Serve requests on socket_path, using threads worker threads; only returns on error */
+    int run_server(std::string const& socket_path, unsigned threads);
+
+    /** Forward arguments to the server at socket_path, print its output and
+     *  return its exit status; compiles locally if there is no server. */
+    int run_client(std::string const& socket_path, std::vector<std::string> const& arguments);
+}
+
+#endif //_COMPILER_SERVER_HPP
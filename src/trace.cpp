@@ -0,0 +1,162 @@
+#include "trace.hpp"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Trace
+{
+    namespace
+    {
+        struct event
+        {
+            char const* name;
+            char const* category;
+            std::string detail;
+            std::uint64_t start_us;
+            std::uint64_t duration_us;
+        };
+
+        // Each thread records into its own buffer; the lock is only contended
+        // when the trace is written
+        struct thread_buffer
+        {
+            std::mutex lock;
+            unsigned thread_id;
+            std::vector<event> events;
+        };
+
+        struct trace_state
+        {
+            std::mutex lock;
+            // The start of the trace, in ticks of the clock; atomic, as spans
+            // (i.e. of server requests) may end while a trace is started
+            std::atomic<std::chrono::steady_clock::rep> epoch{ std::chrono::steady_clock::now().time_since_epoch().count() };
+            // Buffers are kept alive after their thread exits, until written
+            std::vector<std::shared_ptr<thread_buffer>> buffers;
+            // Buffers of threads which have exited, for new threads to take
+            // over; the phases start threads of their own, so without this
+            // there would be a buffer per thread of every phase ever run
+            std::vector<std::shared_ptr<thread_buffer>> free_buffers;
+        };
+
+        trace_state& state()
+        {
+            static trace_state trace;
+            return trace;
+        }
+
+        // Hands the buffer of a thread back, when the thread exits; its
+        // events stay, and the next thread continues on the same track
+        struct buffer_holder
+        {
+            std::shared_ptr<thread_buffer> buffer;
+
+            ~buffer_holder()
+            {
+                if(buffer)
+                {
+                    trace_state& trace = state();
+                    std::lock_guard<std::mutex> guard(trace.lock);
+                    trace.free_buffers.push_back(std::move(buffer));
+                }
+            }
+        };
+
+        thread_buffer& this_thread_buffer()
+        {
+            thread_local buffer_holder holder;
+            if(!holder.buffer)
+            {
+                trace_state& trace = state();
+                std::lock_guard<std::mutex> guard(trace.lock);
+                if(trace.free_buffers.empty() == false)
+                {
+                    holder.buffer = std::move(trace.free_buffers.back());
+                    trace.free_buffers.pop_back();
+                }
+                else
+                {
+                    holder.buffer = std::make_shared<thread_buffer>();
+                    holder.buffer->thread_id = static_cast<unsigned>(trace.buffers.size()) + 1;
+                    trace.buffers.push_back(holder.buffer);
+                }
+            }
+            return *holder.buffer;
+        }
+    }
+
+    namespace detail
+    {
+        std::atomic<bool> recording(false);
+
+        std::uint64_t now_us()
+        {
+            std::chrono::steady_clock::duration epoch(state().epoch.load(std::memory_order_relaxed));
+            auto elapsed = std::chrono::steady_clock::now().time_since_epoch() - epoch;
+            return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+        }
+
+        void record(char const* name, char const* category, std::string const& detail, std::uint64_t start_us)
+        {
+            std::uint64_t end_us = now_us();
+            thread_buffer& buffer = this_thread_buffer();
+            std::lock_guard<std::mutex> guard(buffer.lock);
+            buffer.events.push_back({ name, category, detail, start_us, end_us - start_us });
+        }
+    }
+
+    void start()
+    {
+        trace_state& trace = state();
+        {
+            std::lock_guard<std::mutex> guard(trace.lock);
+            for(auto& buffer : trace.buffers)
+            {
+                std::lock_guard<std::mutex> buffer_guard(buffer->lock);
+                buffer->events.clear();
+            }
+            trace.epoch.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+        }
+        detail::recording.store(true, std::memory_order_relaxed);
+    }
+
+    void stop(output_sink& out)
+    {
+        detail::recording.store(false, std::memory_order_relaxed);
+
+        trace_state& trace = state();
+        std::lock_guard<std::mutex> guard(trace.lock);
+        out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+        bool first = true;
+        for(auto& buffer : trace.buffers)
+        {
+            std::lock_guard<std::mutex> buffer_guard(buffer->lock);
+            // Name the thread, such that the viewer groups it sensibly
+            out << (first ? "" : ",\n");
+            first = false;
+            out << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->thread_id
+                << ", \"args\": {\"name\": \"thread " << buffer->thread_id << "\"}}";
+            // And its spans, as complete events
+            for(event const& e : buffer->events)
+            {
+                out << ",\n{\"name\": ";
+                write_json_string(out, e.name);
+                out << ", \"cat\": ";
+                write_json_string(out, e.category);
+                out << ", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer->thread_id
+                    << ", \"ts\": " << e.start_us << ", \"dur\": " << e.duration_us;
+                if(e.detail.empty() == false)
+                {
+                    out << ", \"args\": {\"detail\": ";
+                    write_json_string(out, e.detail);
+                    out << "}";
+                }
+                out << "}";
+            }
+            buffer->events.clear();
+        }
+        out << "\n]}\n";
+    }
+}
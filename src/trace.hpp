@@ -0,0 +1,84 @@
+#ifndef _COMPILER_TRACE_HPP
+#define _COMPILER_TRACE_HPP
+
+#include "output_sink.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+/************************************************************************/
+/** {2 Timeline tracing}                                                */
+/************************************************************************/
+// Records spans of work per thread, for output in the Chrome trace event
+// format (viewable in chrome://tracing or Perfetto).
+//
+//      {
+//          Trace::span span("parse", "file", filename);
+//          ...
+//      }
+//
+// When not recording, a span is a single relaxed load, such that spans can
+// be left in everywhere. Recording is process wide; the compile server runs
+// a compile recording a trace on its own (see compile in compiler.cpp).
+namespace Trace
+{
+    namespace detail
+    {
+        extern std::atomic<bool> recording;
+
+        std::uint64_t now_us();
+        void record(char const* name, char const* category, std::string const& detail, std::uint64_t start_us);
+    }
+
+    /** Start recording spans, discarding any previously recorded */
+    void start();
+    /** Stop recording, and write the recorded spans as trace event JSON */
+    void stop(output_sink& out);
+
+    inline bool enabled()
+    {
+        return detail::recording.load(std::memory_order_relaxed);
+    }
+
+    // Records the time from its construction to its destruction; name and
+    // category must be string literals (or otherwise outlive the trace)
+    class span
+    {
+        public:
+            span(char const* name, char const* category)
+                : span(name, category, std::string())
+            {
+            }
+
+            span(char const* name, char const* category, std::string const& detail)
+                : active(enabled()), name(name), category(category)
+            {
+                if(active)
+                {
+                    description = detail;
+                    start_us = detail::now_us();
+                }
+            }
+
+            ~span()
+            {
+                if(active)
+                {
+                    detail::record(name, category, description, start_us);
+                }
+            }
+
+            span(span const&) = delete;
+            span& operator=(span const&) = delete;
+
+        private:
+            bool active;
+            char const* name;
+            char const* category;
+            std::string description;
+            std::uint64_t start_us;
+    };
+}
+
+#endif //_COMPILER_TRACE_HPP
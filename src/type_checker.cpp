@@ -0,0 +1,1149 @@
+#include "type_checker.hpp"
+
+#include "ast_helper.hpp"
+#include "ast_names.hpp"
+#include "ast_traversal.hpp"
+#include "trace.hpp"
+#include "view.hpp"
+#include "work_stealing.hpp"
+#include "Error.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <unordered_set>
+#include <utility>
+
+#include <boost/variant.hpp>
+
+namespace Typing
+{
+    namespace
+    {
+        Ast::name_id java_lang(std::string const& type)
+        {
+            return Ast::intern_name({ Ast::identifier("java"), Ast::identifier("lang"), Ast::identifier(type) });
+        }
+
+        // What every task reads; built before the tasks start
+        struct shared_context
+        {
+            Environment::class_environment const& environment;
+            Hierarchy::type_hierarchy const& hierarchy;
+            member_table const& members;
+            Ast::type_id string_type;
+            // The types every array is assignable to
+            Ast::name_id object;
+            Ast::name_id cloneable;
+            Ast::name_id serializable;
+        };
+
+        // The type index a name refers to in scope, no_type if none (and an
+        // error in error, if ambiguous)
+        Hierarchy::type_index resolve_name(Ast::name const& navn, Environment::type_scope const& scope,
+                                           Hierarchy::type_hierarchy const& hierarchy, std::string& error)
+        {
+            Ast::name_id id = Ast::root_name_id;
+            if(Ast::name_simple const* simple = boost::get<Ast::name_simple>(&navn))
+            {
+                try
+                {
+                    id = scope.find(Ast::name_component(simple->id));
+                }
+                catch(Error::Environment_Error& e)
+                {
+                    error = e.what();
+                    return Hierarchy::no_type;
+                }
+            }
+            else
+            {
+                id = Ast::name_to_id(navn);
+            }
+            Hierarchy::type_index type = id == Ast::root_name_id ? Hierarchy::no_type : hierarchy.index_of(id);
+            if(type == Hierarchy::no_type && error.empty())
+            {
+                error = "type " + Ast::name_to_string(navn) + " does not exist";
+            }
+            return type;
+        }
+
+        // The type a type expression denotes in scope, unknown_type (and an
+        // error in error) if it names no type
+        Ast::type_id resolve_type(Ast::type_expression const& type, Environment::type_scope const& scope,
+                                  Hierarchy::type_hierarchy const& hierarchy, std::vector<Ast::type_id> const& named_types,
+                                  std::string& error)
+        {
+            unsigned dimensions = 0;
+            Ast::type_expression const* element = &type;
+            while(Ast::type_expression_tarray const* array = boost::get<Ast::type_expression_tarray>(element))
+            {
+                element = &array->type;
+                dimensions++;
+            }
+            Ast::type_id id;
+            if(Ast::type_expression_named const* named = boost::get<Ast::type_expression_named>(element))
+            {
+                Hierarchy::type_index index = resolve_name(named->type, scope, hierarchy, error);
+                if(index == Hierarchy::no_type)
+                {
+                    return unknown_type;
+                }
+                id = named_types[index];
+            }
+            else
+            {
+                id = Ast::intern_type(boost::get<Ast::type_expression_base>(*element));
+            }
+            for(unsigned n = 0; n < dimensions; n++)
+            {
+                id = Ast::array_type(id);
+            }
+            return id;
+        }
+
+        bool is_numeric(Ast::type_id type)
+        {
+            return type == Ast::byte_type_id || type == Ast::short_type_id || type == Ast::int_type_id || type == Ast::char_type_id;
+        }
+
+        // Named types and arrays (the special types aren't in the type table)
+        bool is_composite(Ast::type_id type)
+        {
+            return type != unknown_type && type != null_type && !Ast::is_base_type_id(type);
+        }
+
+        // Checks a single method or constructor body
+        class body_checker
+        {
+            public:
+                body_checker(shared_context const& shared, Environment::type_scope const& scope, Hierarchy::type_index self,
+                             bool is_static, Ast::type_id return_type, std::string where)
+                    : shared(shared), scope(scope), self(self), is_static(is_static), return_type(return_type), where(std::move(where))
+                {
+                }
+
+                void check(std::list<Ast::formal_parameter> const& parameters, Ast::body const& b);
+
+                expression_types types;
+                std::vector<std::string> diagnostics;
+
+            private:
+                friend struct expression_typer;
+
+                void error(std::string const& message)
+                {
+                    diagnostics.push_back(where + ": " + message);
+                }
+
+                Ast::type_id type_of(Ast::expression const& exp) const
+                {
+                    auto found = types.find(&exp);
+                    return found != types.end() ? found->second : unknown_type;
+                }
+
+                std::vector<Ast::type_id> types_of(std::list<Ast::expression> const& expressions) const
+                {
+                    std::vector<Ast::type_id> result;
+                    for(Ast::expression const& exp : expressions)
+                    {
+                        result.push_back(type_of(exp));
+                    }
+                    return result;
+                }
+
+                Ast::type_id resolve(Ast::type_expression const& type)
+                {
+                    std::string message;
+                    Ast::type_id id = resolve_type(type, scope, shared.hierarchy, named_types(), message);
+                    if(!message.empty())
+                    {
+                        error(message);
+                    }
+                    return id;
+                }
+
+                std::vector<Ast::type_id> const& named_types() const
+                {
+                    return shared.members.named_types();
+                }
+
+                // The hierarchy index of a named type, no_type for others
+                Hierarchy::type_index index_of(Ast::type_id type) const
+                {
+                    if(!is_composite(type) || Ast::type_id_kind(type) != Ast::type_kind_named)
+                    {
+                        return Hierarchy::no_type;
+                    }
+                    return shared.hierarchy.index_of(Ast::type_name(type));
+                }
+
+                std::string to_string(Ast::type_id type) const
+                {
+                    return type == null_type ? "null" : type == unknown_type ? "<unknown>" : Ast::type_id_to_string(type);
+                }
+
+                bool assignable(Ast::type_id from, Ast::type_id to);
+                bool assignable_uncached(Ast::type_id from, Ast::type_id to);
+                bool castable(Ast::type_id from, Ast::type_id to);
+
+                /** {3 Members} */
+                field_info const* find_field(Hierarchy::type_index type, std::string const& name) const;
+                method_info const* find_method(Hierarchy::type_index type, std::string const& name, std::vector<Ast::type_id> const& arguments);
+                bool applicable(std::vector<Ast::type_id> const& parameters, std::vector<Ast::type_id> const& arguments, bool& exact);
+                Ast::type_id field_access(Ast::type_id type, std::string const& name);
+                Ast::type_id invoke(Ast::type_id type, std::string const& name, std::vector<Ast::type_id> const& arguments, bool static_call);
+                void check_constructor(Hierarchy::type_index type, std::vector<Ast::type_id> const& arguments);
+                Ast::type_id resolve_ambiguous(Ast::name const& navn, bool& is_type);
+
+                /** {3 Statements} */
+                void enter_statement(Ast::statement const& stm);
+                void leave_statement(Ast::statement const& stm);
+                void check_condition(Ast::expression const& condition);
+
+                shared_context const& shared;
+                Environment::type_scope const& scope;
+                Hierarchy::type_index self;
+                bool is_static;
+                Ast::type_id return_type;
+                std::string where;
+
+                // The type of every local, by slot
+                std::vector<Ast::type_id> locals;
+                std::unordered_map<Ast::statement const*, Ast::type_id> declared;
+                // Names that are the type of an ambiguous cast
+                std::unordered_set<Ast::expression const*> cast_types;
+                std::unordered_map<std::uint64_t, bool> assignable_cache;
+        };
+
+        // Types a node, given the types of its children
+        struct expression_typer : boost::static_visitor<Ast::type_id>
+        {
+            body_checker& checker;
+            Ast::expression const& node;
+
+            expression_typer(body_checker& checker, Ast::expression const& node)
+                : checker(checker), node(node)
+            {
+            }
+
+            // Constants
+            Ast::type_id operator()(Ast::expression_integer_constant const&) const
+            {
+                return Ast::int_type_id;
+            }
+
+            Ast::type_id operator()(Ast::expression_string_constant const&) const
+            {
+                return checker.shared.string_type;
+            }
+
+            Ast::type_id operator()(Ast::expression_boolean_constant const&) const
+            {
+                return Ast::boolean_type_id;
+            }
+
+            Ast::type_id operator()(Ast::expression_null const&) const
+            {
+                return null_type;
+            }
+
+            Ast::type_id operator()(Ast::expression_this const&) const
+            {
+                if(checker.is_static)
+                {
+                    checker.error("this used in a static method");
+                }
+                return checker.named_types()[checker.self];
+            }
+
+            // Names and l-values
+            Ast::type_id operator()(Ast::lvalue_ambiguous_name const& exp) const
+            {
+                bool is_type = false;
+                Ast::type_id type = checker.resolve_ambiguous(exp.ambiguous, is_type);
+                bool type_expected = checker.cast_types.count(&node) != 0;
+                if(is_type && !type_expected)
+                {
+                    checker.error("type " + Ast::name_to_string(exp.ambiguous) + " used as a value");
+                    return unknown_type;
+                }
+                if(!is_type && type_expected)
+                {
+                    checker.error(Ast::name_to_string(exp.ambiguous) + " is not a type");
+                    return unknown_type;
+                }
+                return type;
+            }
+
+            Ast::type_id operator()(Ast::lvalue_local const& exp) const
+            {
+                if(checker.cast_types.count(&node) != 0)
+                {
+                    checker.error(exp.name.identifier_string + " is not a type");
+                    return unknown_type;
+                }
+                return exp.slot < checker.locals.size() ? checker.locals[exp.slot] : unknown_type;
+            }
+
+            Ast::type_id operator()(Ast::lvalue_non_static_field const& exp) const
+            {
+                return checker.field_access(checker.type_of(exp.exp), exp.name.identifier_string);
+            }
+
+            Ast::type_id operator()(Ast::lvalue_array const& exp) const
+            {
+                Ast::type_id array = checker.type_of(exp.array_exp);
+                Ast::type_id index = checker.type_of(exp.index_exp);
+                if(index != unknown_type && !is_numeric(index))
+                {
+                    checker.error("array index of type " + checker.to_string(index));
+                }
+                if(array == unknown_type)
+                {
+                    return unknown_type;
+                }
+                if(!is_composite(array) || Ast::type_id_kind(array) != Ast::type_kind_array)
+                {
+                    checker.error("indexing " + checker.to_string(array) + ", which is not an array");
+                    return unknown_type;
+                }
+                return Ast::array_element(array);
+            }
+
+            Ast::type_id operator()(Ast::expression_lvalue const& exp) const
+            {
+                return boost::apply_visitor(*this, exp.variable);
+            }
+
+            // Operators
+            Ast::type_id operator()(Ast::expression_binop const& exp) const
+            {
+                Ast::type_id left = checker.type_of(exp.operand1);
+                Ast::type_id right = checker.type_of(exp.operand2);
+                std::string operatur = Ast::binop_to_string(exp.operatur);
+                auto numeric = [](Ast::type_id type){ return type == unknown_type || is_numeric(type); };
+                auto boolean = [](Ast::type_id type){ return type == unknown_type || type == Ast::boolean_type_id; };
+                auto fail = [&]()
+                {
+                    checker.error("operator " + operatur + " applied to " + checker.to_string(left) + " and " + checker.to_string(right));
+                    return unknown_type;
+                };
+
+                if(boost::get<Ast::binop_plus>(&exp.operatur))
+                {
+                    // String concatenation, if either side is a string
+                    if(left == checker.shared.string_type || right == checker.shared.string_type)
+                    {
+                        return (left == Ast::void_type_id || right == Ast::void_type_id) ? fail() : checker.shared.string_type;
+                    }
+                    if(left == unknown_type || right == unknown_type)
+                    {
+                        return unknown_type;
+                    }
+                    return numeric(left) && numeric(right) ? Ast::int_type_id : fail();
+                }
+                if(boost::get<Ast::binop_minus>(&exp.operatur) || boost::get<Ast::binop_times>(&exp.operatur) ||
+                   boost::get<Ast::binop_divide>(&exp.operatur) || boost::get<Ast::binop_modulo>(&exp.operatur))
+                {
+                    return numeric(left) && numeric(right) ? Ast::int_type_id : fail();
+                }
+                if(boost::get<Ast::binop_lt>(&exp.operatur) || boost::get<Ast::binop_le>(&exp.operatur) ||
+                   boost::get<Ast::binop_gt>(&exp.operatur) || boost::get<Ast::binop_ge>(&exp.operatur))
+                {
+                    return numeric(left) && numeric(right) ? Ast::boolean_type_id : fail();
+                }
+                if(boost::get<Ast::binop_eq>(&exp.operatur) || boost::get<Ast::binop_ne>(&exp.operatur))
+                {
+                    bool comparable = (numeric(left) && numeric(right)) || (boolean(left) && boolean(right)) ||
+                                      (!Ast::is_base_type_id(left) && !Ast::is_base_type_id(right) && checker.castable(left, right));
+                    return comparable ? Ast::boolean_type_id : fail();
+                }
+                // The boolean operators; &, |, ^, && and ||
+                return boolean(left) && boolean(right) ? Ast::boolean_type_id : fail();
+            }
+
+            Ast::type_id operator()(Ast::expression_unop const& exp) const
+            {
+                Ast::type_id operand = checker.type_of(exp.operand);
+                if(boost::get<Ast::unop_negate>(&exp.operatur))
+                {
+                    if(operand != unknown_type && !is_numeric(operand))
+                    {
+                        checker.error("negating " + checker.to_string(operand));
+                        return unknown_type;
+                    }
+                    return Ast::int_type_id;
+                }
+                if(operand != unknown_type && operand != Ast::boolean_type_id)
+                {
+                    checker.error("complementing " + checker.to_string(operand));
+                    return unknown_type;
+                }
+                return Ast::boolean_type_id;
+            }
+
+            Ast::type_id operator()(Ast::expression_incdec const& exp) const
+            {
+                Ast::type_id variable = boost::apply_visitor(*this, exp.variable);
+                if(variable != unknown_type && !is_numeric(variable))
+                {
+                    checker.error("incrementing or decrementing " + checker.to_string(variable));
+                    return unknown_type;
+                }
+                return variable;
+            }
+
+            Ast::type_id operator()(Ast::expression_assignment const& exp) const
+            {
+                Ast::type_id variable = boost::apply_visitor(*this, exp.variable);
+                Ast::type_id value = checker.type_of(exp.value);
+                if(!checker.assignable(value, variable))
+                {
+                    checker.error("assigning " + checker.to_string(value) + " to " + checker.to_string(variable));
+                }
+                return variable;
+            }
+
+            Ast::type_id operator()(Ast::expression_parentheses const& exp) const
+            {
+                return checker.type_of(exp.inside);
+            }
+
+            // Casts and instanceof
+            Ast::type_id operator()(Ast::expression_cast const& exp) const
+            {
+                Ast::type_id target = checker.resolve(exp.type);
+                Ast::type_id value = checker.type_of(exp.value);
+                if(!checker.castable(value, target))
+                {
+                    checker.error("casting " + checker.to_string(value) + " to " + checker.to_string(target));
+                }
+                return target;
+            }
+
+            Ast::type_id operator()(Ast::expression_ambiguous_cast const& exp) const
+            {
+                // The type was typed as a name of a type, see enter_expression;
+                // any other expression is a value (locals report themselves)
+                if(!boost::get<Ast::lvalue_ambiguous_name>(&exp.type) && !boost::get<Ast::lvalue_local>(&exp.type))
+                {
+                    checker.error("cast to an expression, rather than a type");
+                    return unknown_type;
+                }
+                Ast::type_id target = checker.type_of(exp.type);
+                Ast::type_id value = checker.type_of(exp.value);
+                if(!checker.castable(value, target))
+                {
+                    checker.error("casting " + checker.to_string(value) + " to " + checker.to_string(target));
+                }
+                return target;
+            }
+
+            Ast::type_id operator()(Ast::expression_instance_of const& exp) const
+            {
+                Ast::type_id value = checker.type_of(exp.value);
+                Ast::type_id type = checker.resolve(exp.type);
+                if(Ast::is_base_type_id(value) || Ast::is_base_type_id(type))
+                {
+                    checker.error("instanceof on " + checker.to_string(value) + " and " + checker.to_string(type));
+                }
+                else if(!checker.castable(value, type))
+                {
+                    checker.error(checker.to_string(value) + " can never be an instance of " + checker.to_string(type));
+                }
+                return Ast::boolean_type_id;
+            }
+
+            // Invocations
+            Ast::type_id operator()(Ast::expression_static_invoke const& exp) const
+            {
+                std::string message;
+                Hierarchy::type_index type = resolve_name(exp.type, checker.scope, checker.shared.hierarchy, message);
+                if(type == Hierarchy::no_type)
+                {
+                    checker.error(message);
+                    return unknown_type;
+                }
+                return checker.invoke(checker.named_types()[type], exp.method_name.identifier_string, checker.types_of(exp.arguments), true);
+            }
+
+            Ast::type_id operator()(Ast::expression_non_static_invoke const& exp) const
+            {
+                return checker.invoke(checker.type_of(exp.context), exp.method_name.identifier_string, checker.types_of(exp.arguments), false);
+            }
+
+            Ast::type_id operator()(Ast::expression_simple_invoke const& exp) const
+            {
+                std::vector<Ast::type_id> arguments = checker.types_of(exp.arguments);
+                method_info const* method = checker.find_method(checker.self, exp.method_name.identifier_string, arguments);
+                if(method == nullptr)
+                {
+                    checker.error("no method " + exp.method_name.identifier_string + " applicable to the arguments");
+                    return unknown_type;
+                }
+                if(checker.is_static && !method->is_static)
+                {
+                    checker.error("non static method " + exp.method_name.identifier_string + " called from a static method");
+                }
+                return method->return_type;
+            }
+
+            Ast::type_id operator()(Ast::expression_ambiguous_invoke const& exp) const
+            {
+                bool is_type = false;
+                Ast::type_id context = checker.resolve_ambiguous(exp.ambiguous, is_type);
+                return checker.invoke(context, exp.method_name.identifier_string, checker.types_of(exp.arguments), is_type);
+            }
+
+            // Instance creation
+            Ast::type_id operator()(Ast::expression_new const& exp) const
+            {
+                Ast::type_id type = checker.resolve(exp.type);
+                Hierarchy::type_index index = checker.index_of(type);
+                if(index == Hierarchy::no_type)
+                {
+                    if(type != unknown_type)
+                    {
+                        checker.error("creating an instance of " + checker.to_string(type));
+                    }
+                    return unknown_type;
+                }
+                if(checker.shared.members.members(index).is_abstract)
+                {
+                    checker.error("creating an instance of abstract type " + checker.to_string(type));
+                }
+                checker.check_constructor(index, checker.types_of(exp.arguments));
+                return type;
+            }
+
+            Ast::type_id operator()(Ast::expression_new_array const& exp) const
+            {
+                Ast::type_id element = checker.resolve(exp.type);
+                Ast::type_id size = checker.type_of(exp.context);
+                if(size != unknown_type && !is_numeric(size))
+                {
+                    checker.error("array size of type " + checker.to_string(size));
+                }
+                return element == unknown_type ? unknown_type : Ast::array_type(element);
+            }
+        };
+
+        bool body_checker::assignable(Ast::type_id from, Ast::type_id to)
+        {
+            if(from == to || from == unknown_type || to == unknown_type)
+            {
+                return true;
+            }
+            std::uint64_t key = Ast::type_pair_key(from, to);
+            auto found = assignable_cache.find(key);
+            if(found != assignable_cache.end())
+            {
+                return found->second;
+            }
+            bool result = assignable_uncached(from, to);
+            assignable_cache.emplace(key, result);
+            return result;
+        }
+
+        bool body_checker::assignable_uncached(Ast::type_id from, Ast::type_id to)
+        {
+            if(to == null_type)
+            {
+                return false;
+            }
+            if(from == null_type)
+            {
+                return !Ast::is_base_type_id(to);
+            }
+            // Widening of the numeric types
+            if(Ast::is_base_type_id(from) || Ast::is_base_type_id(to))
+            {
+                return (from == Ast::byte_type_id && (to == Ast::short_type_id || to == Ast::int_type_id)) ||
+                       (from == Ast::short_type_id && to == Ast::int_type_id) ||
+                       (from == Ast::char_type_id && to == Ast::int_type_id);
+            }
+            bool from_array = Ast::type_id_kind(from) == Ast::type_kind_array;
+            bool to_array = Ast::type_id_kind(to) == Ast::type_kind_array;
+            if(!from_array && !to_array)
+            {
+                Hierarchy::type_index sub = index_of(from);
+                Hierarchy::type_index super = index_of(to);
+                // Without the declarations (i.e. no library), we can't tell
+                if(sub == Hierarchy::no_type || super == Hierarchy::no_type)
+                {
+                    return Ast::type_name(to) == shared.object || sub == super;
+                }
+                return shared.hierarchy.is_subtype(sub, super);
+            }
+            if(from_array && !to_array)
+            {
+                Ast::name_id name = Ast::type_name(to);
+                return name == shared.object || name == shared.cloneable || name == shared.serializable;
+            }
+            if(!from_array)
+            {
+                return false;
+            }
+            // Arrays of references are covariant, arrays of base types are not
+            Ast::type_id from_element = Ast::array_element(from);
+            Ast::type_id to_element = Ast::array_element(to);
+            if(Ast::is_base_type_id(from_element) || Ast::is_base_type_id(to_element))
+            {
+                return from_element == to_element;
+            }
+            return assignable(from_element, to_element);
+        }
+
+        bool body_checker::castable(Ast::type_id from, Ast::type_id to)
+        {
+            if(assignable(from, to) || assignable(to, from))
+            {
+                return true;
+            }
+            if(is_numeric(from) && is_numeric(to))
+            {
+                return true;
+            }
+            // Some subclass may implement the interface
+            Hierarchy::type_index from_index = index_of(from);
+            Hierarchy::type_index to_index = index_of(to);
+            return from_index != Hierarchy::no_type && to_index != Hierarchy::no_type &&
+                   (shared.hierarchy.is_interface(from_index) || shared.hierarchy.is_interface(to_index));
+        }
+
+        field_info const* body_checker::find_field(Hierarchy::type_index type, std::string const& name) const
+        {
+            for(; type != Hierarchy::no_type; type = shared.hierarchy.superclass(type))
+            {
+                type_members const& members = shared.members.members(type);
+                auto found = members.fields.find(name);
+                if(found != members.fields.end())
+                {
+                    return &found->second;
+                }
+            }
+            return nullptr;
+        }
+
+        bool body_checker::applicable(std::vector<Ast::type_id> const& parameters, std::vector<Ast::type_id> const& arguments, bool& exact)
+        {
+            if(parameters.size() != arguments.size())
+            {
+                return false;
+            }
+            exact = true;
+            for(std::size_t n = 0; n < parameters.size(); n++)
+            {
+                if(!assignable(arguments[n], parameters[n]))
+                {
+                    return false;
+                }
+                exact = exact && arguments[n] == parameters[n];
+            }
+            return true;
+        }
+
+        method_info const* body_checker::find_method(Hierarchy::type_index type, std::string const& name,
+                                                     std::vector<Ast::type_id> const& arguments)
+        {
+            // The type, its superclasses, and every superinterface; interfaces
+            // have the methods of Object as well
+            std::vector<Hierarchy::type_index> pending{ type };
+            std::vector<Hierarchy::type_index> seen;
+            Hierarchy::type_index object = shared.hierarchy.index_of(shared.object);
+            if(shared.hierarchy.is_interface(type) && object != Hierarchy::no_type)
+            {
+                pending.push_back(object);
+            }
+            method_info const* applicable_method = nullptr;
+            for(std::size_t next = 0; next < pending.size(); next++)
+            {
+                Hierarchy::type_index current = pending[next];
+                if(std::find(seen.begin(), seen.end(), current) != seen.end())
+                {
+                    continue;
+                }
+                seen.push_back(current);
+                auto range = shared.members.members(current).methods.equal_range(name);
+                for(auto it = range.first; it != range.second; ++it)
+                {
+                    bool exact = false;
+                    if(applicable(it->second.parameters, arguments, exact))
+                    {
+                        if(exact)
+                        {
+                            return &it->second;
+                        }
+                        applicable_method = applicable_method ? applicable_method : &it->second;
+                    }
+                }
+                if(shared.hierarchy.superclass(current) != Hierarchy::no_type)
+                {
+                    pending.push_back(shared.hierarchy.superclass(current));
+                }
+                std::vector<Hierarchy::type_index> const& interfaces = shared.hierarchy.interfaces(current);
+                pending.insert(pending.end(), interfaces.begin(), interfaces.end());
+            }
+            return applicable_method;
+        }
+
+        Ast::type_id body_checker::field_access(Ast::type_id type, std::string const& name)
+        {
+            if(type == unknown_type)
+            {
+                return unknown_type;
+            }
+            if(is_composite(type) && Ast::type_id_kind(type) == Ast::type_kind_array)
+            {
+                if(name == "length")
+                {
+                    return Ast::int_type_id;
+                }
+                error("arrays have no field " + name);
+                return unknown_type;
+            }
+            Hierarchy::type_index index = index_of(type);
+            if(index == Hierarchy::no_type)
+            {
+                error(to_string(type) + " has no field " + name);
+                return unknown_type;
+            }
+            field_info const* field = find_field(index, name);
+            if(field == nullptr)
+            {
+                error(to_string(type) + " has no field " + name);
+                return unknown_type;
+            }
+            if(field->is_static)
+            {
+                error("static field " + name + " accessed through an instance of " + to_string(type));
+            }
+            return field->type;
+        }
+
+        Ast::type_id body_checker::invoke(Ast::type_id type, std::string const& name, std::vector<Ast::type_id> const& arguments, bool static_call)
+        {
+            if(type == unknown_type)
+            {
+                return unknown_type;
+            }
+            // Arrays have the methods of Object
+            Hierarchy::type_index index = is_composite(type) && Ast::type_id_kind(type) == Ast::type_kind_array ?
+                                          shared.hierarchy.index_of(shared.object) : index_of(type);
+            if(index == Hierarchy::no_type)
+            {
+                error("invoking " + name + " on " + to_string(type));
+                return unknown_type;
+            }
+            method_info const* method = find_method(index, name, arguments);
+            if(method == nullptr)
+            {
+                error(to_string(type) + " has no method " + name + " applicable to the arguments");
+                return unknown_type;
+            }
+            if(static_call && !method->is_static)
+            {
+                error("non static method " + name + " of " + to_string(type) + " invoked statically");
+            }
+            else if(!static_call && method->is_static)
+            {
+                error("static method " + name + " of " + to_string(type) + " invoked through an instance");
+            }
+            return method->return_type;
+        }
+
+        void body_checker::check_constructor(Hierarchy::type_index type, std::vector<Ast::type_id> const& arguments)
+        {
+            for(std::vector<Ast::type_id> const& parameters : shared.members.members(type).constructors)
+            {
+                bool exact = false;
+                if(applicable(parameters, arguments, exact))
+                {
+                    return;
+                }
+            }
+            error("no constructor of " + Ast::name_id_to_string(shared.hierarchy.name_of(type)) + " applicable to the arguments");
+        }
+
+        Ast::type_id body_checker::resolve_ambiguous(Ast::name const& navn, bool& is_type)
+        {
+            std::list<Ast::identifier> names = Ast::name_to_identifier_list(navn);
+            auto component = names.begin();
+            Ast::type_id current;
+            // A field of the class (locals were resolved already)
+            if(field_info const* field = find_field(self, component->identifier_string))
+            {
+                if(is_static && !field->is_static)
+                {
+                    error("non static field " + component->identifier_string + " used in a static method");
+                }
+                current = field->type;
+                ++component;
+            }
+            else
+            {
+                // Or the shortest prefix naming a type, followed by a static field
+                Hierarchy::type_index type = Hierarchy::no_type;
+                Ast::name_id prefix = Ast::root_name_id;
+                for(; component != names.end(); ++component)
+                {
+                    // Only looked up, as a prefix never interned names no type
+                    prefix = Ast::find_name(prefix, component->identifier_string);
+                    if(component == names.begin())
+                    {
+                        try
+                        {
+                            Ast::name_id found = scope.find(component->identifier_string);
+                            type = found == Ast::root_name_id ? Hierarchy::no_type : shared.hierarchy.index_of(found);
+                        }
+                        catch(Error::Environment_Error& e)
+                        {
+                            error(e.what());
+                            return unknown_type;
+                        }
+                    }
+                    else if(prefix != Ast::root_name_id)
+                    {
+                        type = shared.hierarchy.index_of(prefix);
+                    }
+                    // Nor do the longer prefixes of one never interned
+                    if(type != Hierarchy::no_type || prefix == Ast::root_name_id)
+                    {
+                        break;
+                    }
+                }
+                if(type == Hierarchy::no_type)
+                {
+                    error("cannot find symbol " + Ast::name_to_string(navn));
+                    return unknown_type;
+                }
+                if(++component == names.end())
+                {
+                    is_type = true;
+                    return named_types()[type];
+                }
+                field_info const* static_field = find_field(type, component->identifier_string);
+                if(static_field == nullptr || !static_field->is_static)
+                {
+                    error(Ast::name_id_to_string(shared.hierarchy.name_of(type)) + " has no static field " + component->identifier_string);
+                    return unknown_type;
+                }
+                current = static_field->type;
+                ++component;
+            }
+            // The remaining components are fields of instances
+            for(; component != names.end(); ++component)
+            {
+                current = field_access(current, component->identifier_string);
+            }
+            return current;
+        }
+
+        void body_checker::check_condition(Ast::expression const& condition)
+        {
+            Ast::type_id type = type_of(condition);
+            if(type != unknown_type && type != Ast::boolean_type_id)
+            {
+                error("condition of type " + to_string(type));
+            }
+        }
+
+        void body_checker::enter_statement(Ast::statement const& stm)
+        {
+            // Slots are handed out in this order by resolve_locals as well
+            if(Ast::statement_local_declaration const* local = boost::get<Ast::statement_local_declaration>(&stm))
+            {
+                Ast::type_id type = resolve(local->type);
+                if(type == Ast::void_type_id)
+                {
+                    error("local variable " + local->name.identifier_string + " of type void");
+                    type = unknown_type;
+                }
+                locals.push_back(type);
+                declared.emplace(&stm, type);
+            }
+        }
+
+        void body_checker::leave_statement(Ast::statement const& stm)
+        {
+            if(Ast::statement_local_declaration const* local = boost::get<Ast::statement_local_declaration>(&stm))
+            {
+                Ast::type_id type = declared[&stm];
+                if(local->optional_initializer && !assignable(type_of(*local->optional_initializer), type))
+                {
+                    error("initializing " + local->name.identifier_string + " of type " + to_string(type) +
+                          " with " + to_string(type_of(*local->optional_initializer)));
+                }
+            }
+            else if(Ast::statement_if_then const* if_then = boost::get<Ast::statement_if_then>(&stm))
+            {
+                check_condition(if_then->condition);
+            }
+            else if(Ast::statement_if_then_else const* if_then_else = boost::get<Ast::statement_if_then_else>(&stm))
+            {
+                check_condition(if_then_else->condition);
+            }
+            else if(Ast::statement_while const* loop = boost::get<Ast::statement_while>(&stm))
+            {
+                check_condition(loop->condition);
+            }
+            else if(Ast::statement_value_return const* value_return = boost::get<Ast::statement_value_return>(&stm))
+            {
+                Ast::type_id value = type_of(value_return->value);
+                if(return_type == Ast::void_type_id)
+                {
+                    error("returning a value from a void method or constructor");
+                }
+                else if(!assignable(value, return_type))
+                {
+                    error("returning " + to_string(value) + " from a method of type " + to_string(return_type));
+                }
+            }
+            else if(boost::get<Ast::statement_void_return>(&stm))
+            {
+                if(return_type != Ast::void_type_id && return_type != unknown_type)
+                {
+                    error("returning without a value from a method of type " + to_string(return_type));
+                }
+            }
+            else if(Ast::statement_throw const* thrown = boost::get<Ast::statement_throw>(&stm))
+            {
+                Ast::type_id throwee = type_of(thrown->throwee);
+                if(throwee != unknown_type && !is_composite(throwee))
+                {
+                    error("throwing " + to_string(throwee));
+                }
+            }
+            else if(Ast::statement_super_call const* super_call = boost::get<Ast::statement_super_call>(&stm))
+            {
+                Hierarchy::type_index super = shared.hierarchy.superclass(self);
+                if(super != Hierarchy::no_type)
+                {
+                    check_constructor(super, types_of(super_call->arguments));
+                }
+            }
+            else if(Ast::statement_this_call const* this_call = boost::get<Ast::statement_this_call>(&stm))
+            {
+                check_constructor(self, types_of(this_call->arguments));
+            }
+        }
+
+        void body_checker::check(std::list<Ast::formal_parameter> const& parameters, Ast::body const& b)
+        {
+            for(Ast::formal_parameter const& parameter : parameters)
+            {
+                std::string message;
+                locals.push_back(resolve_type(parameter.first, scope, shared.hierarchy, named_types(), message));
+                if(!message.empty())
+                {
+                    error(message);
+                }
+            }
+            Ast::traversal callbacks;
+            callbacks.enter_statement = [this](Ast::statement const& stm){ enter_statement(stm); };
+            callbacks.leave_statement = [this](Ast::statement const& stm){ leave_statement(stm); };
+            callbacks.enter_expression = [this](Ast::expression const& exp)
+            {
+                if(Ast::expression_ambiguous_cast const* cast = boost::get<Ast::expression_ambiguous_cast>(&exp))
+                {
+                    cast_types.insert(&cast->type);
+                }
+            };
+            // Children are done first, so their types are in the table
+            callbacks.leave_expression = [this](Ast::expression const& exp)
+            {
+                types.emplace(&exp, boost::apply_visitor(expression_typer(*this, exp), exp));
+            };
+            Ast::traverse(b, callbacks);
+        }
+
+        // A body to check, and what it needs besides the shared context
+        struct body_task
+        {
+            Ast::source_file const* file;
+            Hierarchy::type_index self;
+            std::list<Ast::formal_parameter> const* parameters;
+            Ast::body const* body;
+            bool is_static;
+            Ast::type_expression const* return_type;    // None for constructors
+            std::string where;
+        };
+
+        struct task_result
+        {
+            expression_types types;
+            std::vector<std::string> diagnostics;
+        };
+    }
+
+    member_table::member_table(Environment::class_environment const& environment, Environment::scope_cache& scopes,
+                               Hierarchy::type_hierarchy const& hierarchy, unsigned threads, std::vector<std::string>& diagnostics)
+    {
+        std::size_t count = hierarchy.size();
+        for(Hierarchy::type_index type = 0; type < count; type++)
+        {
+            named.push_back(Ast::named_type(hierarchy.name_of(type)));
+        }
+        types.resize(count);
+        std::vector<std::vector<std::string>> type_diagnostics(count);
+
+        std::vector<std::function<void()>> tasks;
+        for(Hierarchy::type_index type = 0; type < count; type++)
+        {
+            tasks.push_back([&, type]()
+            {
+                Ast::source_file const& sf = *environment.find(hierarchy.name_of(type));
+                std::shared_ptr<Environment::type_scope const> scope = scopes.scope_for(environment, sf);
+                type_members& members = types[type];
+                auto resolve = [&](Ast::type_expression const& type_expression)
+                {
+                    std::string message;
+                    Ast::type_id id = resolve_type(type_expression, *scope, hierarchy, named, message);
+                    if(!message.empty())
+                    {
+                        type_diagnostics[type].push_back(sf.name + ": " + message);
+                    }
+                    return id;
+                };
+                auto parameters = [&](std::list<Ast::formal_parameter> const& formal_parameters)
+                {
+                    std::vector<Ast::type_id> result;
+                    for(Ast::formal_parameter const& parameter : formal_parameters)
+                    {
+                        result.push_back(resolve(parameter.first));
+                    }
+                    return result;
+                };
+
+                std::list<Ast::declaration> const* declarations;
+                if(Ast::class_declaration const* klass = boost::get<Ast::class_declaration>(&sf.type))
+                {
+                    members.is_abstract = klass->is_abstract;
+                    declarations = &klass->members;
+                }
+                else
+                {
+                    members.is_abstract = true;
+                    declarations = &boost::get<Ast::interface_declaration>(sf.type).members;
+                }
+                for(Ast::declaration const& member : *declarations)
+                {
+                    if(Ast::declaration_field const* field = boost::get<Ast::declaration_field>(&member))
+                    {
+                        members.fields.emplace(field->decl.name.identifier_string, field_info{ resolve(field->decl.type), field->decl.is_static });
+                    }
+                    else if(Ast::declaration_method const* method = boost::get<Ast::declaration_method>(&member))
+                    {
+                        members.methods.emplace(method->decl.name.identifier_string,
+                                                method_info{ resolve(method->decl.return_type), parameters(method->decl.formal_parameters), method->decl.is_static });
+                    }
+                    else
+                    {
+                        members.constructors.push_back(parameters(boost::get<Ast::declaration_constructor>(member).decl.formal_parameters));
+                    }
+                }
+                // Without constructors, there's the default one
+                if(!hierarchy.is_interface(type) && members.constructors.empty())
+                {
+                    members.constructors.emplace_back();
+                }
+            });
+        }
+        Parallel::run_tasks(tasks, threads);
+        for(std::vector<std::string>& messages : type_diagnostics)
+        {
+            diagnostics.insert(diagnostics.end(), messages.begin(), messages.end());
+        }
+    }
+
+    expression_types check_program(Ast::program const& program, Environment::class_environment const& environment,
+                                   Environment::scope_cache& scopes, Hierarchy::type_hierarchy const& hierarchy, unsigned threads,
+                                   std::vector<bool> const& check_bodies)
+    {
+        std::vector<std::string> diagnostics;
+        member_table members(environment, scopes, hierarchy, threads, diagnostics);
+        shared_context shared{ environment, hierarchy, members, Ast::named_type(java_lang("String")), java_lang("Object"),
+                               java_lang("Cloneable"), Ast::intern_name({ Ast::identifier("java"), Ast::identifier("io"), Ast::identifier("Serializable") }) };
+
+        // One task per body, in the order of the files and their members
+        std::vector<body_task> bodies;
+        // Of the classes whose bodies are to be checked; interfaces have none
+        auto checked = [&check_bodies](std::pair<std::size_t, Ast::source_file const&> file)
+        {
+            return check_bodies[file.first] && boost::get<Ast::class_declaration>(&file.second.type) != nullptr;
+        };
+        for(auto file : View::filter(View::enumerate(program), checked))
+        {
+            Ast::source_file const& sf = file.second;
+            Ast::class_declaration const* klass = &boost::get<Ast::class_declaration>(sf.type);
+            Hierarchy::type_index self = hierarchy.index_of(Environment::qualified_type_name(sf));
+            for(Ast::declaration const& member : klass->members)
+            {
+                if(Ast::declaration_method const* method = boost::get<Ast::declaration_method>(&member))
+                {
+                    if(method->decl.method_body)
+                    {
+                        bodies.push_back({ &sf, self, &method->decl.formal_parameters, &*method->decl.method_body, method->decl.is_static,
+                                           &method->decl.return_type, sf.name + ": in method " + method->decl.name.identifier_string });
+                    }
+                }
+                else if(Ast::declaration_constructor const* constructor = boost::get<Ast::declaration_constructor>(&member))
+                {
+                    if(constructor->decl.method_body)
+                    {
+                        bodies.push_back({ &sf, self, &constructor->decl.formal_parameters, &*constructor->decl.method_body, false,
+                                           nullptr, sf.name + ": in constructor" });
+                    }
+                }
+            }
+        }
+
+        std::vector<task_result> results(bodies.size());
+        std::vector<std::function<void()>> tasks;
+        for(std::size_t n = 0; n < bodies.size(); n++)
+        {
+            tasks.push_back([&, n]()
+            {
+                body_task const& task = bodies[n];
+                Trace::span span("typecheck", "types", task.where);
+                std::shared_ptr<Environment::type_scope const> scope = scopes.scope_for(environment, *task.file);
+                // The member table reported return types that don't exist
+                Ast::type_id return_type = Ast::void_type_id;
+                std::string message;
+                if(task.return_type)
+                {
+                    return_type = resolve_type(*task.return_type, *scope, hierarchy, members.named_types(), message);
+                }
+                body_checker checker(shared, *scope, task.self, task.is_static, return_type, task.where);
+                checker.check(*task.parameters, *task.body);
+                results[n].types = std::move(checker.types);
+                results[n].diagnostics = std::move(checker.diagnostics);
+            });
+        }
+        Parallel::run_tasks(tasks, threads);
+
+        // Merge the tables of the tasks, in order
+        std::size_t total = 0;
+        for(task_result const& result : results)
+        {
+            total += result.types.size();
+        }
+        expression_types types;
+        types.reserve(total);
+        for(task_result& result : results)
+        {
+            types.insert(result.types.begin(), result.types.end());
+            diagnostics.insert(diagnostics.end(), result.diagnostics.begin(), result.diagnostics.end());
+        }
+        if(!diagnostics.empty())
+        {
+            std::string message = std::to_string(diagnostics.size()) + " errors";
+            for(std::string const& diagnostic : diagnostics)
+            {
+                message += "\n  " + diagnostic;
+            }
+            throw Error::Type_Error(message);
+        }
+        return types;
+    }
+}
@@ -0,0 +1,100 @@
+#ifndef _COMPILER_TYPE_CHECKER_HPP
+#define _COMPILER_TYPE_CHECKER_HPP
+
+#include "ast.hpp"
+#include "ast_types.hpp"
+#include "environment.hpp"
+#include "hierarchy.hpp"
+#include "type_scope.hpp"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/************************************************************************/
+/** {2 Type checking}                                                   */
+/************************************************************************/
+// Every method and constructor body is checked on its own, as a task on a
+// work stealing pool (see work_stealing.hpp). The tasks only read what's
+// shared (the environment, the hierarchy and the member table), and write
+// to tables of their own; the types of their expressions, and their
+// diagnostics, which are merged in the order of the files and members once
+// every task is done, such that the output does not depend on scheduling.
+//
+// Expressions are typed bottom-up, by the iterative traversal, so bodies
+// of any depth are checked without deep recursion. Names left ambiguous by
+// the resolution of locals (see ast_locals.hpp) are disambiguated on the
+// way; as fields of the class, or as types, followed by static fields.
+namespace Typing
+{
+    // Besides the types of the type table, the null literal has a type of
+    // its own, and expressions whose type can't be determined (after an
+    // error) are of the unknown type, which is compatible with everything,
+    // such that one error isn't reported over and over
+    const Ast::type_id unknown_type = ~Ast::type_id(0);
+    const Ast::type_id null_type = ~Ast::type_id(0) - 1;
+
+    /** The type of every expression in the checked bodies */
+    using expression_types = std::unordered_map<Ast::expression const*, Ast::type_id>;
+
+    /** {3 Members} */
+    struct field_info
+    {
+        Ast::type_id type;
+        bool is_static;
+    };
+
+    struct method_info
+    {
+        Ast::type_id return_type;
+        std::vector<Ast::type_id> parameters;
+        bool is_static;
+    };
+
+    struct type_members
+    {
+        bool is_abstract;
+        std::unordered_map<std::string, field_info> fields;
+        std::unordered_multimap<std::string, method_info> methods;
+        // The parameters of each constructor
+        std::vector<std::vector<Ast::type_id>> constructors;
+    };
+
+    /** The declared members of every type in the hierarchy, with their types
+     *  resolved in the scope of their file; read only once built */
+    class member_table
+    {
+        public:
+            /** Built concurrently, on threads threads; the diagnostics (of
+             *  member types that don't exist) are appended, in type order */
+            member_table(Environment::class_environment const& environment, Environment::scope_cache& scopes,
+                         Hierarchy::type_hierarchy const& hierarchy, unsigned threads, std::vector<std::string>& diagnostics);
+
+            type_members const& members(Hierarchy::type_index type) const
+            {
+                return types[type];
+            }
+            /** The named type of every type in the hierarchy, by index */
+            std::vector<Ast::type_id> const& named_types() const
+            {
+                return named;
+            }
+
+        private:
+            std::vector<type_members> types;
+            std::vector<Ast::type_id> named;
+    };
+
+    /** {3 Checking} */
+    /** Check every method and constructor body of program, on threads
+     *  threads (0 for one per core), and return the type of every expression.
+     *  Only the bodies of files with check_bodies set are checked (one per
+     *  file, in order; the declarations of every file are checked).
+     *  Throws Error::Type_Error listing every diagnostic, in the order of the
+     *  files and their members */
+    expression_types check_program(Ast::program const& program, Environment::class_environment const& environment,
+                                   Environment::scope_cache& scopes, Hierarchy::type_hierarchy const& hierarchy, unsigned threads,
+                                   std::vector<bool> const& check_bodies);
+}
+
+#endif //_COMPILER_TYPE_CHECKER_HPP
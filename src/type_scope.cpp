@@ -0,0 +1,173 @@
+#include "type_scope.hpp"
+
+#include "ast_names.hpp"
+#include "Error.hpp"
+
+#include "Match/match.hpp"
+
+#include <algorithm>
+#include <set>
+#include <string>
+
+namespace Environment
+{
+    namespace
+    {
+        Ast::name_id java_lang()
+        {
+            static Ast::name_id const id = Ast::intern_name(Ast::intern_name(Ast::root_name_id, "java"), "lang");
+            return id;
+        }
+
+        void sort_unique(std::vector<Ast::name_id>& ids)
+        {
+            std::sort(ids.begin(), ids.end());
+            ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+        }
+
+        std::string type_name(Ast::source_file const& sf)
+        {
+            return
+            Match(sf.type, std::string)
+                Case(const Ast::class_declaration& klass)
+                {
+                    return klass.name.identifier_string;
+                }
+                Case(const Ast::interface_declaration& interface)
+                {
+                    return interface.name.identifier_string;
+                }
+            EndMatch;
+        }
+    }
+
+    import_list imports_of(Ast::source_file const& sf)
+    {
+        import_list imports;
+        imports.package = sf.package ? Ast::name_to_id(*sf.package) : Ast::root_name_id;
+        for(Ast::import_declaration const& import : sf.imports)
+        {
+            Match(import, void)
+                Case(const Ast::import_declaration_single& single)
+                {
+                    imports.single_types.push_back(Ast::intern_name(Ast::name_to_id(single.import), single.class_name.identifier_string));
+                }
+                Case(const Ast::import_declaration_on_demand& on_demand)
+                {
+                    imports.on_demand_packages.push_back(Ast::name_to_id(on_demand.import));
+                }
+            EndMatch;
+        }
+        imports.on_demand_packages.push_back(java_lang());
+        sort_unique(imports.single_types);
+        sort_unique(imports.on_demand_packages);
+        return imports;
+    }
+
+    type_scope::type_scope(class_environment const& environment, import_list const& imports, std::string const& file)
+    {
+        // Lowest precedence first, each step overriding the previous; the
+        // packages imported on demand only clash once a clashing name is used
+        for(Ast::name_id package : imports.on_demand_packages)
+        {
+            // java.lang is imported whether it's there or not
+            if(package != java_lang() && !environment.package_exists(package))
+            {
+                throw Error::Environment_Error("package " + Ast::name_id_to_string(package) + " imported in " + file + " does not exist");
+            }
+            for(type_entry const& entry : environment.package_types(package))
+            {
+                auto inserted = types.emplace(Ast::name_component(entry.name), resolution{ entry.name, Ast::root_name_id });
+                if(!inserted.second && inserted.first->second.type != entry.name)
+                {
+                    inserted.first->second.ambiguous_with = entry.name;
+                }
+            }
+        }
+        for(type_entry const& entry : environment.package_types(imports.package))
+        {
+            types[Ast::name_component(entry.name)] = resolution{ entry.name, Ast::root_name_id };
+        }
+        std::set<std::string> imported;
+        for(Ast::name_id type : imports.single_types)
+        {
+            if(environment.find(type) == nullptr)
+            {
+                throw Error::Environment_Error("type " + Ast::name_id_to_string(type) + " imported in " + file + " does not exist");
+            }
+            std::string const& simple_name = Ast::name_component(type);
+            if(!imported.insert(simple_name).second)
+            {
+                throw Error::Environment_Error("type " + Ast::name_id_to_string(type) + " imported in " + file +
+                                               " clashes with " + Ast::name_id_to_string(types[simple_name].type));
+            }
+            types[simple_name] = resolution{ type, Ast::root_name_id };
+        }
+    }
+
+    Ast::name_id type_scope::find(std::string const& simple_name) const
+    {
+        auto found = types.find(simple_name);
+        if(found == types.end())
+        {
+            return Ast::root_name_id;
+        }
+        if(found->second.ambiguous_with != Ast::root_name_id)
+        {
+            throw Error::Environment_Error("type " + simple_name + " is ambiguous, both " + Ast::name_id_to_string(found->second.type) +
+                                           " and " + Ast::name_id_to_string(found->second.ambiguous_with) + " are imported");
+        }
+        return found->second.type;
+    }
+
+    std::size_t scope_cache::import_list_hash::operator()(import_list const& imports) const
+    {
+        std::size_t hash = imports.package;
+        for(Ast::name_id type : imports.single_types)
+        {
+            hash = hash * 31 + type;
+        }
+        for(Ast::name_id package : imports.on_demand_packages)
+        {
+            hash = hash * 37 + package;
+        }
+        return hash;
+    }
+
+    std::shared_ptr<type_scope const> scope_cache::scope_for(class_environment const& environment, Ast::source_file const& sf)
+    {
+        import_list imports = imports_of(sf);
+        // The type of the file is in its package, and so in its scope, but
+        // a single type import of the same simple name would hide it
+        std::string own_name = type_name(sf);
+        Ast::name_id own_type = Environment::qualified_type_name(sf);
+        for(Ast::name_id type : imports.single_types)
+        {
+            if(type != own_type && Ast::name_component(type) == own_name)
+            {
+                throw Error::Environment_Error("type " + Ast::name_id_to_string(type) + " imported in " + sf.name +
+                                               " clashes with the type declared there");
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            auto found = scopes.find(imports);
+            if(found != scopes.end())
+            {
+                return found->second;
+            }
+        }
+        // Resolve it outside the lock, such that other scopes can be resolved
+        // meanwhile; if another file got there first, its scope is used
+        std::shared_ptr<type_scope const> scope = std::make_shared<type_scope const>(environment, imports, sf.name);
+        std::lock_guard<std::mutex> guard(lock);
+        return scopes.emplace(std::move(imports), std::move(scope)).first->second;
+    }
+
+    std::size_t scope_cache::size() const
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        return scopes.size();
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef _COMPILER_TYPE_SCOPE_HPP
+#define _COMPILER_TYPE_SCOPE_HPP
+
+#include "ast.hpp"
+#include "environment.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/************************************************************************/
+/** {2 Resolving simple type names}                                     */
+/************************************************************************/
+// The types a simple name may refer to in a file, are given by its package
+// and imports alone; in order of precedence, the single type imports, the
+// types of the package (the type of the file among them), and the types of
+// the packages imported on demand (java.lang always among them).
+//
+// A scope is resolved once per distinct package and imports, into a single
+// table from simple names to types, and shared between the files with the
+// same imports, such that looking up a type is one probe of the scope, and
+// one of the class environment.
+namespace Environment
+{
+    /** The package and imports of a file, that decides its scope */
+    struct import_list
+    {
+        Ast::name_id package;
+        // Sorted, and without duplicates
+        std::vector<Ast::name_id> single_types;
+        std::vector<Ast::name_id> on_demand_packages;
+
+        bool operator==(import_list const& other) const
+        {
+            return package == other.package && single_types == other.single_types &&
+                   on_demand_packages == other.on_demand_packages;
+        }
+    };
+
+    /** The imports of sf, including the implicit 'import java.lang.*;' */
+    import_list imports_of(Ast::source_file const& sf);
+
+    class type_scope
+    {
+        public:
+            /** Resolve the imports, against environment, which must be frozen.
+             *  Throws Error::Environment_Error if a single type import names
+             *  no type, or clashes with another, or an on demand import
+             *  names no package; file is named in the errors */
+            type_scope(class_environment const& environment, import_list const& imports, std::string const& file);
+
+            /** The qualified name of the type simple_name refers to, or
+             *  root_name_id if there is none; throws Error::Environment_Error
+             *  if it's imported on demand from more than one package */
+            Ast::name_id find(std::string const& simple_name) const;
+
+        private:
+            struct resolution
+            {
+                Ast::name_id type;
+                // Another type of the same name, if ambiguous
+                Ast::name_id ambiguous_with;
+            };
+
+            std::unordered_map<std::string, resolution> types;
+    };
+
+    /** Shares scopes between the files with the same imports */
+    class scope_cache
+    {
+        public:
+            /** The scope of sf; may be called concurrently. Throws
+             *  Error::Environment_Error as type_scope does, or if a single
+             *  type import clashes with the type of sf */
+            std::shared_ptr<type_scope const> scope_for(class_environment const& environment, Ast::source_file const& sf);
+
+            /** The number of distinct scopes */
+            std::size_t size() const;
+
+        private:
+            struct import_list_hash
+            {
+                std::size_t operator()(import_list const& imports) const;
+            };
+
+            mutable std::mutex lock;
+            std::unordered_map<import_list, std::shared_ptr<type_scope const>, import_list_hash> scopes;
+    };
+}
+
+#endif //_COMPILER_TYPE_SCOPE_HPP
@@ -2,53 +2,48 @@
 #define _COMPILER_UTILITY_HPP
 
 #include <iostream>
+#include <sstream>
+#include <string>
 #include <list>
 #include <type_traits>
 
 #include <Maybe/Maybe.hpp>
 
-// Function pointer template, to ease implementing apply_phase
-template<typename ReturnType, typename... Parameters>
-using FunctionPointer = ReturnType (*)(Parameters...);
-
-// Applies a phase, given by the function pointer phase.
-template<typename FunctionReturnType, typename... Parameters>
-FunctionReturnType apply_phase(std::string phase_name, FunctionPointer<FunctionReturnType, Parameters...> phase, Parameters... arguments)
-{
-    std::cout << " *** " << phase_name << std::endl;
-    return phase(arguments...);
-}
+#include "view.hpp"
 
 // The same as std::transform
-template<typename T, typename FunctionReturnType>
-std::list<FunctionReturnType> unpack_list(std::list<T> list, FunctionPointer<FunctionReturnType,T> function)
+template<typename T, typename Function,
+         typename FunctionReturnType = typename std::decay<typename std::result_of<Function(T const&)>::type>::type>
+typename std::enable_if<std::is_void<FunctionReturnType>::value == false, std::list<FunctionReturnType>>::type
+unpack_list(std::list<T> const& list, Function function)
 {
     std::list<FunctionReturnType> return_value;
-    for(T t : list)
+    for(T const& t : list)
     {
-        FunctionReturnType ret = function(t);
-        return_value.push_back(ret);
+        return_value.push_back(function(t));
     }
     return return_value;
 }
 
 // Call function for each, just for side effects
-template<typename T>
-void unpack_list(std::list<T> list, FunctionPointer<void,T> function)
+template<typename T, typename Function,
+         typename FunctionReturnType = typename std::result_of<Function(T const&)>::type>
+typename std::enable_if<std::is_void<FunctionReturnType>::value>::type
+unpack_list(std::list<T> const& list, Function function)
 {
-    for(T t : list)
+    for(T const& t : list)
     {
         function(t);
     }
 }
 
-template<typename T, typename FunctionReturnType>
-void call_if(Maybe<T> maybe, FunctionPointer<FunctionReturnType, T> function)
+template<typename T, typename Function>
+void call_if(Maybe<T> const& maybe, Function function)
 {
-     maybe_if(maybe, [function](T value)
-     {
-        function(value);
-     });
+    if(maybe)
+    {
+        function(*maybe);
+    }
 }
 
 /*
@@ -63,26 +58,21 @@ void call_if(Maybe<T> maybe, FunctionPointer<FunctionReturnType, T> function)
  * };
  */
 
-template<typename T> // TODO FIXME couldn't see why invocations no longer compiler (assumed pointers?)
-std::string concat(std::list<T> input, FunctionPointer<std::string, T> string_convert_function, std::string seperator)
+// Write the elements of input to sink (i.e. an std::ostream), converted by
+// string_convert_function, and seperated by seperator.
+template<typename Sink, typename T, typename Function>
+void concat(Sink& sink, std::list<T> const& input, Function string_convert_function, std::string const& seperator)
 {
-    std::string output_string = "";
-    if(input.empty() == false)
-    {
-        // Get the first element
-        std::string temp = string_convert_function(input.front());
-        // And append it
-        output_string.append(temp);
-        // Now loop the remaining elements
-        // (the ++ in init, is to skip the element we already read).
-        for (typename std::list<T>::iterator it=(++input.begin()); it != input.end(); ++it)
-        {
-            temp = string_convert_function(*it);
-            output_string.append(seperator);
-            output_string.append(temp);
-        }
-    }
-    return output_string;
+    View::join(sink, View::map(input, string_convert_function), seperator);
+}
+
+// As above, but collecting the output in a string
+template<typename T, typename Function>
+std::string concat(std::list<T> const& input, Function string_convert_function, std::string const& seperator)
+{
+    std::ostringstream output_string;
+    concat(output_string, input, string_convert_function, seperator);
+    return output_string.str();
 }
 
 #endif //_COMPILER_UTILITY_HPP
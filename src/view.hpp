@@ -0,0 +1,201 @@
+#ifndef _COMPILER_VIEW_HPP
+#define _COMPILER_VIEW_HPP
+
+#include <cstddef>
+#include <iterator>
+#include <string>
+#include <utility>
+
+/************************************************************************/
+/** {2 Lazy, non-copying views over containers}                         */
+/************************************************************************/
+// Views only hold iterators into the underlying container (or view), and
+// compute their elements on demand, when iterated; that is nothing is ever
+// copied, however the container must outlive the views made from it.
+//
+//      for(auto& element : View::filter(klass.members, is_method)) ...
+//      View::join(std::cout, View::map(info.implements, name_to_string), ", ");
+namespace View
+{
+    /** {3 Ranges} */
+    template<typename Iterator>
+    struct range
+    {
+        Iterator first;
+        Iterator last;
+
+        Iterator begin() const
+        {
+            return first;
+        }
+
+        Iterator end() const
+        {
+            return last;
+        }
+
+        bool empty() const
+        {
+            return first == last;
+        }
+    };
+
+    template<typename Iterator>
+    range<Iterator> make_range(Iterator first, Iterator last)
+    {
+        return { first, last };
+    }
+
+    // The iterator type of a container or view
+    template<typename Range>
+    using iterator_of = decltype(std::begin(std::declval<Range const&>()));
+
+    /** {3 Map} */
+    template<typename Iterator, typename Function>
+    struct map_iterator
+    {
+        using value_type = decltype(std::declval<Function const&>()(*std::declval<Iterator const&>()));
+
+        Iterator current;
+        Function function;
+
+        value_type operator*() const
+        {
+            return function(*current);
+        }
+
+        map_iterator& operator++()
+        {
+            ++current;
+            return *this;
+        }
+
+        bool operator==(map_iterator const& other) const
+        {
+            return current == other.current;
+        }
+
+        bool operator!=(map_iterator const& other) const
+        {
+            return current != other.current;
+        }
+    };
+
+    /** Apply function to each element, as they are iterated */
+    template<typename Range, typename Function>
+    range<map_iterator<iterator_of<Range>, Function>> map(Range const& input, Function function)
+    {
+        return { { std::begin(input), function }, { std::end(input), function } };
+    }
+
+    /** {3 Filter} */
+    template<typename Iterator, typename Predicate>
+    struct filter_iterator
+    {
+        Iterator current;
+        Iterator last;
+        Predicate predicate;
+
+        filter_iterator(Iterator current, Iterator last, Predicate predicate)
+            : current(current), last(last), predicate(predicate)
+        {
+            skip();
+        }
+
+        // Advance until we're at an element satisfying the predicate
+        void skip()
+        {
+            while(current != last && !predicate(*current))
+            {
+                ++current;
+            }
+        }
+
+        auto operator*() const -> decltype(*std::declval<Iterator const&>())
+        {
+            return *current;
+        }
+
+        filter_iterator& operator++()
+        {
+            ++current;
+            skip();
+            return *this;
+        }
+
+        bool operator==(filter_iterator const& other) const
+        {
+            return current == other.current;
+        }
+
+        bool operator!=(filter_iterator const& other) const
+        {
+            return current != other.current;
+        }
+    };
+
+    /** Skip the elements not satisfying predicate, as they are iterated */
+    template<typename Range, typename Predicate>
+    range<filter_iterator<iterator_of<Range>, Predicate>> filter(Range const& input, Predicate predicate)
+    {
+        return { { std::begin(input), std::end(input), predicate }, { std::end(input), std::end(input), predicate } };
+    }
+
+    /** {3 Enumerate} */
+    template<typename Iterator>
+    struct enumerate_iterator
+    {
+        using value_type = std::pair<std::size_t, decltype(*std::declval<Iterator const&>())>;
+
+        Iterator current;
+        std::size_t index;
+
+        value_type operator*() const
+        {
+            return value_type(index, *current);
+        }
+
+        enumerate_iterator& operator++()
+        {
+            ++current;
+            ++index;
+            return *this;
+        }
+
+        bool operator==(enumerate_iterator const& other) const
+        {
+            return current == other.current;
+        }
+
+        bool operator!=(enumerate_iterator const& other) const
+        {
+            return current != other.current;
+        }
+    };
+
+    /** Pair each element with its index, as they are iterated */
+    template<typename Range>
+    range<enumerate_iterator<iterator_of<Range>>> enumerate(Range const& input)
+    {
+        return { { std::begin(input), 0 }, { std::end(input), 0 } };
+    }
+
+    /** {3 Output} */
+    /** Write the elements to sink, seperated by seperator */
+    template<typename Sink, typename Range>
+    void join(Sink& sink, Range const& input, std::string const& seperator)
+    {
+        bool first = true;
+        for(auto&& element : input)
+        {
+            if(first == false)
+            {
+                sink << seperator;
+            }
+            sink << element;
+            first = false;
+        }
+    }
+}
+
+#endif //_COMPILER_VIEW_HPP
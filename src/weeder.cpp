@@ -0,0 +1,175 @@
+#include "weeder.hpp"
+
+#include "ast_helper.hpp"
+#include "Error.hpp"
+
+namespace Weeder
+{
+    namespace
+    {
+        void fail(std::string const& reason)
+        {
+            throw Error::Weeding_Error(reason);
+        }
+
+        void check_field(Ast::field_declaration const& field, std::string const& type_name)
+        {
+            std::string const where = "field " + type_name + "." + field.name.identifier_string;
+            if (Ast::is_void(field.type))
+            {
+                fail(where + " has type void, which is only allowed as the return type of a method");
+            }
+            if (field.is_final && !field.optional_initializer)
+            {
+                fail(where + " is final, but has no initializer");
+            }
+        }
+
+        void check_method(Ast::method_declaration const& method, Ast::class_declaration const& klass)
+        {
+            std::string const where = "method " + klass.name.identifier_string + "." + method.name.identifier_string;
+            // Abstract methods, and only those, are without a body
+            if (method.is_abstract && method.method_body)
+            {
+                fail(where + " is abstract, but has a body");
+            }
+            if (!method.is_abstract && !method.method_body)
+            {
+                fail(where + " has no body, but is not abstract");
+            }
+            if (method.is_abstract && (method.is_static || method.is_final))
+            {
+                fail(where + " is abstract, and cannot be static or final");
+            }
+            if (method.is_static && method.is_final)
+            {
+                fail(where + " is static, and cannot be final");
+            }
+            if (method.is_abstract && !klass.is_abstract)
+            {
+                fail(where + " is abstract, but the class is not");
+            }
+        }
+
+        void check_constructor(Ast::constructor_declaration const& constructor, std::string const& type_name)
+        {
+            if (constructor.name.identifier_string != type_name)
+            {
+                fail("constructor " + constructor.name.identifier_string + " is declared in class " + type_name);
+            }
+            if (!constructor.method_body)
+            {
+                fail("constructor of " + type_name + " has no body");
+            }
+        }
+
+        // The digits of an unsigned decimal, without leading zeros
+        std::string significant_digits(std::string const& digits)
+        {
+            std::string::size_type first = digits.find_first_not_of('0');
+            return first == std::string::npos ? "0" : digits.substr(first);
+        }
+
+        // Whether a <= b, for unsigned decimals without leading zeros
+        bool decimal_less_equal(std::string const& a, std::string const& b)
+        {
+            return a.size() != b.size() ? a.size() < b.size() : a <= b;
+        }
+    }
+
+    void check_class(Ast::class_declaration const& decl)
+    {
+        std::string const& type_name = decl.name.identifier_string;
+        if (decl.is_abstract && decl.is_final)
+        {
+            fail("class " + type_name + " cannot be both abstract and final");
+        }
+        for (Ast::declaration const& member : decl.members)
+        {
+            Match(member, void)
+                Case(const Ast::declaration_field& field)
+                {
+                    check_field(field.decl, type_name);
+                }
+                Case(const Ast::declaration_method& method)
+                {
+                    check_method(method.decl, decl);
+                }
+                Case(const Ast::declaration_constructor& constructor)
+                {
+                    check_constructor(constructor.decl, type_name);
+                }
+            EndMatch;
+        }
+    }
+
+    void check_interface(Ast::interface_declaration const& decl)
+    {
+        std::string const& type_name = decl.name.identifier_string;
+        for (Ast::declaration const& member : decl.members)
+        {
+            Match(member, void)
+                Case(const Ast::declaration_field& field)
+                {
+                    fail("interface " + type_name + " cannot declare field " + field.decl.name.identifier_string);
+                }
+                Case(const Ast::declaration_method& method)
+                {
+                    std::string const where = "method " + type_name + "." + method.decl.name.identifier_string;
+                    if (method.decl.method_body)
+                    {
+                        fail(where + " is declared in an interface, and cannot have a body");
+                    }
+                    if (method.decl.is_static || method.decl.is_final)
+                    {
+                        fail(where + " is declared in an interface, and cannot be static or final");
+                    }
+                }
+                Case(const Ast::declaration_constructor&)
+                {
+                    fail("interface " + type_name + " cannot declare a constructor");
+                }
+            EndMatch;
+        }
+    }
+
+    void check_integer_literal(Ast::expression_integer_constant const& literal, bool negated)
+    {
+        static const std::string int_max = "2147483647";
+        static const std::string int_min_magnitude = "2147483648";
+        if (!decimal_less_equal(significant_digits(literal.value), negated ? int_min_magnitude : int_max))
+        {
+            fail("integer literal " + std::string(negated ? "-" : "") + literal.value + " is out of range for int");
+        }
+    }
+
+    void check_source_file(Ast::source_file const& sf)
+    {
+        // Only file names are checked, other names (i.e. of in memory
+        // sources) are left alone
+        std::string const suffix = ".java";
+        if (sf.name.size() < suffix.size() || sf.name.compare(sf.name.size() - suffix.size(), suffix.size(), suffix) != 0)
+        {
+            return;
+        }
+        std::string::size_type slash = sf.name.rfind('/');
+        std::string::size_type start = slash == std::string::npos ? 0 : slash + 1;
+        std::string base_name = sf.name.substr(start, sf.name.size() - suffix.size() - start);
+
+        std::string type_name =
+        Match(sf.type, std::string)
+            Case(const Ast::class_declaration& klass)
+            {
+                return klass.name.identifier_string;
+            }
+            Case(const Ast::interface_declaration& interface)
+            {
+                return interface.name.identifier_string;
+            }
+        EndMatch;
+        if (type_name != base_name)
+        {
+            fail("type " + type_name + " must be declared in " + type_name + suffix + ", not in " + sf.name);
+        }
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef _COMPILER_WEEDER_HPP
+#define _COMPILER_WEEDER_HPP
+
+#include "ast.hpp"
+
+#include <string>
+
+/************************************************************************/
+/** {2 Weeding}                                                         */
+/************************************************************************/
+// The Joos restrictions which the grammar does not express. Nearly all of
+// them only concern a single node, so they're checked by the semantic
+// actions of the parser, as each node is built, rather than by walking the
+// finished tree again; only the rules needing more than the node itself
+// (the name of the file) are left for a pass over each source file.
+//
+// Every check throws Error::Weeding_Error on violation.
+namespace Weeder
+{
+    /** {3 Checks run by the parser} */
+    /** Modifiers of the class, and every rule local to its members */
+    void check_class(Ast::class_declaration const& decl);
+    /** Interfaces only hold method signatures, without static or final */
+    void check_interface(Ast::interface_declaration const& decl);
+    /** The literal must fit an int; 2147483648 only as the operand of a
+     *  unary minus, so the rule for negated literals passes negated */
+    void check_integer_literal(Ast::expression_integer_constant const& literal, bool negated);
+    // Not checked yet, as the grammar does not parse members: that every
+    // class declares a constructor. Nor is the literal check called yet, as
+    // the grammar does not parse expressions either
+
+    /** {3 Checks run per source file, after parsing} */
+    /** The type must be declared in a file of the same (base) name */
+    void check_source_file(Ast::source_file const& sf);
+}
+
+#endif //_COMPILER_WEEDER_HPP
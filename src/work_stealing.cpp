@@ -0,0 +1,114 @@
+#include "work_stealing.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace Parallel
+{
+    namespace
+    {
+        // The tasks of a thread; it takes from the front, others steal the back
+        struct task_queue
+        {
+            std::mutex lock;
+            std::deque<std::size_t> tasks;
+
+            bool take(std::size_t& task)
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                if(tasks.empty())
+                {
+                    return false;
+                }
+                task = tasks.front();
+                tasks.pop_front();
+                return true;
+            }
+
+            bool steal(std::size_t& task)
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                if(tasks.empty())
+                {
+                    return false;
+                }
+                task = tasks.back();
+                tasks.pop_back();
+                return true;
+            }
+        };
+    }
+
+    void run_tasks(std::vector<std::function<void()>> const& tasks, unsigned threads)
+    {
+        if(threads == 0)
+        {
+            threads = std::max(std::thread::hardware_concurrency(), 1u);
+        }
+        std::size_t num_workers = std::max<std::size_t>(std::min<std::size_t>(threads, tasks.size()), 1);
+
+        // Deal out the tasks in contiguous shares
+        std::vector<std::unique_ptr<task_queue>> queues;
+        for(std::size_t n = 0; n < num_workers; n++)
+        {
+            queues.emplace_back(new task_queue());
+            std::size_t begin = tasks.size() * n / num_workers;
+            std::size_t end = tasks.size() * (n + 1) / num_workers;
+            for(std::size_t task = begin; task < end; task++)
+            {
+                queues[n]->tasks.push_back(task);
+            }
+        }
+
+        std::vector<std::exception_ptr> errors(tasks.size());
+        auto worker = [&](std::size_t self)
+        {
+            std::size_t task;
+            while(true)
+            {
+                // Our own tasks first, then those of the others, starting
+                // with our neighbour, such that thieves spread out
+                bool found = queues[self]->take(task);
+                for(std::size_t n = 1; !found && n < num_workers; n++)
+                {
+                    found = queues[(self + n) % num_workers]->steal(task);
+                }
+                // No tasks are added while running, so none are left anywhere
+                if(!found)
+                {
+                    return;
+                }
+                try
+                {
+                    tasks[task]();
+                }
+                catch(...)
+                {
+                    errors[task] = std::current_exception();
+                }
+            }
+        };
+        std::vector<std::thread> workers;
+        for(std::size_t n = 1; n < num_workers; n++)
+        {
+            workers.emplace_back(worker, n);
+        }
+        // This thread works too
+        worker(0);
+        for(auto& thread : workers)
+        {
+            thread.join();
+        }
+        for(std::exception_ptr& error : errors)
+        {
+            if(error)
+            {
+                std::rethrow_exception(error);
+            }
+        }
+    }
+}
@@ -0,0 +1,24 @@
+#ifndef _COMPILER_WORK_STEALING_HPP
+#define _COMPILER_WORK_STEALING_HPP
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+/************************************************************************/
+/** {2 Work stealing task pool}                                         */
+/************************************************************************/
+// For phases of many small tasks of uneven size (i.e. one per method body),
+// where handing out whole files would leave threads idle behind the largest
+// file. Each thread starts on its own contiguous share of the tasks, taking
+// them from the front, in order; a thread out of work steals the last task
+// of another thread, that is the one the other would get to last.
+namespace Parallel
+{
+    /** Run every task, on threads threads (0 for one per core), and return
+     *  once all are done. Tasks may run in any order, and concurrently; the
+     *  error of the first failing task (by index) is rethrown. */
+    void run_tasks(std::vector<std::function<void()>> const& tasks, unsigned threads);
+}
+
+#endif //_COMPILER_WORK_STEALING_HPP
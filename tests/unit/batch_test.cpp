@@ -0,0 +1,38 @@
+#define BOOST_TEST_MODULE batch
+#include <boost/test/included/unit_test.hpp>
+
+#include "batch.hpp"
+
+#include <string>
+#include <vector>
+
+namespace
+{
+    std::vector<std::string> split(std::string const& line)
+    {
+        std::vector<std::string> arguments;
+        BOOST_REQUIRE(Batch::split_arguments(line, arguments));
+        return arguments;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(arguments_are_seperated_by_whitespace)
+{
+    BOOST_CHECK((split("--debug-file lexer  A.java\tB.java ") == std::vector<std::string>{ "--debug-file", "lexer", "A.java", "B.java" }));
+    BOOST_CHECK(split("   ").empty());
+}
+
+BOOST_AUTO_TEST_CASE(quoted_arguments_keep_their_whitespace)
+{
+    BOOST_CHECK((split("\"My Files/A.java\" B.java") == std::vector<std::string>{ "My Files/A.java", "B.java" }));
+    BOOST_CHECK((split("dir/\"with space\"/A.java") == std::vector<std::string>{ "dir/with space/A.java" }));
+    BOOST_CHECK((split("\"\"") == std::vector<std::string>{ "" }));
+    // Backslashes only escape inside quotes
+    BOOST_CHECK((split("\"a \\\"b\\\" \\\\c\" d\\e") == std::vector<std::string>{ "a \"b\" \\c", "d\\e" }));
+}
+
+BOOST_AUTO_TEST_CASE(open_quotes_are_rejected)
+{
+    std::vector<std::string> arguments;
+    BOOST_CHECK(!Batch::split_arguments("A.java \"B.java", arguments));
+}
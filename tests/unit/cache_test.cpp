@@ -0,0 +1,133 @@
+#define BOOST_TEST_MODULE cache
+#include <boost/test/included/unit_test.hpp>
+
+#include "ast.hpp"
+#include "ast_cache.hpp"
+#include "ast_names.hpp"
+#include "ast_pp.hpp"
+#include "output_sink.hpp"
+
+#include <cstdlib>
+#include <string>
+
+namespace
+{
+    std::string cache_directory()
+    {
+        char directory[] = "/tmp/joos-cache-XXXXXX";
+        BOOST_REQUIRE(mkdtemp(directory) != nullptr);
+        return directory;
+    }
+
+    Ast::expression one()
+    {
+        return Ast::expression_integer_constant{ "1" };
+    }
+
+    Ast::expression variable(std::string name)
+    {
+        return Ast::lvalue_ambiguous_name{ Ast::name(Ast::make_simple_name(Ast::identifier(name))) };
+    }
+
+    std::string print(Ast::source_file const& sf)
+    {
+        std::string buffer;
+        output_sink out(buffer);
+        Ast::pretty_print(sf, out);
+        out.flush();
+        return buffer;
+    }
+
+    // A class A, with a method f, whose body is left to the caller
+    Ast::body& method_body(Ast::source_file& sf)
+    {
+        sf.name = "A.java";
+        sf.type = Ast::class_declaration();
+        Ast::class_declaration& klass = boost::get<Ast::class_declaration>(sf.type);
+        klass.name = Ast::identifier("A");
+        klass.members.emplace_back(Ast::declaration_method());
+        Ast::method_declaration& method = boost::get<Ast::declaration_method>(klass.members.back()).decl;
+        method.access_type = Ast::access_public();
+        method.is_static = false;
+        method.is_final = false;
+        method.is_abstract = false;
+        method.return_type = Ast::type_expression_base(Ast::base_type_void());
+        method.name = Ast::identifier("f");
+        method.method_body = Ast::body();
+        return *method.method_body;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(entries_are_named_by_the_loader)
+{
+    Ast::parse_cache cache(cache_directory());
+    const std::string contents = "public class A { }";
+    Ast::source_file sf;
+    sf.name = "first/A.java";
+    sf.type = Ast::class_declaration();
+    cache.store(contents, sf);
+
+    // A copy of the file hits the same entry, but keeps its own name
+    Maybe<Ast::source_file> copy = cache.load("second/A.java", contents);
+    BOOST_REQUIRE(copy);
+    BOOST_CHECK_EQUAL(copy->name, "second/A.java");
+
+    // Other contents miss
+    BOOST_CHECK(!cache.load("first/A.java", contents + " "));
+}
+
+BOOST_AUTO_TEST_CASE(trees_survive_the_round_trip)
+{
+    Ast::parse_cache cache(cache_directory());
+    Ast::source_file sf;
+    Ast::body& body = method_body(sf);
+    // int[][] a = new int[n][1][]; a[0] = (T) b.g(1, x.y++); while(!c) { h(); }
+    Ast::type_expression int_type = Ast::type_expression_base(Ast::base_type_int());
+    Ast::expression sized = Ast::expression_new_array{ int_type, variable("n"), { Maybe<Ast::expression>(one()), Maybe<Ast::expression>() } };
+    Ast::type_expression array_type = Ast::type_expression_tarray{ int_type };
+    array_type = Ast::type_expression_tarray{ array_type };
+    body.emplace_back(Ast::statement_local_declaration{ array_type, Ast::identifier("a"), sized });
+    Ast::expression field = Ast::expression_incdec{ Ast::lvalue_non_static_field{ variable("x"), Ast::identifier("y") }, Ast::inc_dec_op_postinc() };
+    Ast::expression invoke = Ast::expression_non_static_invoke{ variable("b"), Ast::identifier("g"), { one(), field } };
+    Ast::expression cast = Ast::expression_ambiguous_cast{ variable("T"), invoke };
+    body.emplace_back(Ast::statement_expression{ Ast::expression_assignment{ Ast::lvalue_array{ variable("a"), one() }, cast } });
+    Ast::statement call = Ast::statement_expression{ Ast::expression_simple_invoke{ Ast::identifier("h"), {} } };
+    Ast::expression negated = Ast::expression_unop{ Ast::unop_complement(), variable("c") };
+    body.emplace_back(Ast::statement_while{ negated, Ast::statement_block{ Ast::block{ call } } });
+    body.emplace_back(Ast::statement_local_declaration{ int_type, Ast::identifier("z"), Maybe<Ast::expression>() });
+    body.emplace_back(Ast::statement_void_return());
+
+    const std::string contents = "class A { void f() { ... } }";
+    cache.store(contents, sf);
+    Maybe<Ast::source_file> copy = cache.load("A.java", contents);
+    BOOST_REQUIRE(copy);
+    BOOST_CHECK_EQUAL(print(*copy), print(sf));
+}
+
+BOOST_AUTO_TEST_CASE(deep_trees_survive_the_round_trip)
+{
+    // Neither writing nor reading recurses per level
+    const std::size_t depth = 1000000;
+    Ast::parse_cache cache(cache_directory());
+    Ast::source_file sf;
+    Ast::body& body = method_body(sf);
+    // '1 + 1 + ... + 1;' nested to the left, and 'while(x) while(x) ... ;',
+    // both built in place, as moving them would recurse
+    body.emplace_back(Ast::statement_expression{ one() });
+    Ast::expression* leftmost = &boost::get<Ast::statement_expression>(body.back()).value;
+    body.emplace_back(Ast::statement_empty());
+    Ast::statement* innermost = &body.back();
+    for(std::size_t n = 0; n < depth; n++)
+    {
+        *leftmost = Ast::expression_binop{ one(), Ast::binop_plus(), one() };
+        leftmost = &boost::get<Ast::expression_binop>(*leftmost).operand1;
+        *innermost = Ast::statement_while{ variable("x"), Ast::statement_empty() };
+        innermost = &boost::get<Ast::statement_while>(*innermost).loop_statement;
+    }
+
+    const std::string contents = "class A { void f() { 1 + ... } }";
+    cache.store(contents, sf);
+    Maybe<Ast::source_file> copy = cache.load("A.java", contents);
+    BOOST_REQUIRE(copy);
+    BOOST_CHECK(print(*copy) == print(sf));
+}
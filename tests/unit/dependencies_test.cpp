@@ -0,0 +1,107 @@
+#define BOOST_TEST_MODULE dependencies
+#include <boost/test/included/unit_test.hpp>
+
+#include "ast.hpp"
+#include "ast_dependencies.hpp"
+#include "ast_names.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    // 'package p; public class <name> { void m() { <used>; } }'
+    Ast::source_file unit(std::string name, std::string used)
+    {
+        Ast::method_declaration method;
+        method.name = Ast::identifier("m");
+        method.return_type = Ast::type_expression_base(Ast::base_type_void());
+        method.method_body = Ast::body();
+        if(used.empty() == false)
+        {
+            Ast::expression reference = Ast::lvalue_ambiguous_name{ Ast::name(Ast::make_simple_name(Ast::identifier(used))) };
+            method.method_body->push_back(Ast::statement_expression{ reference });
+        }
+        Ast::class_declaration klass;
+        klass.name = Ast::identifier(name);
+        klass.members.push_back(Ast::declaration_method{ method });
+
+        Ast::source_file sf;
+        sf.name = name + ".java";
+        sf.package = Ast::name(Ast::make_simple_name(Ast::identifier("p")));
+        sf.type = klass;
+        return sf;
+    }
+
+    using files = std::vector<std::pair<std::string, std::string>>;
+}
+
+BOOST_AUTO_TEST_CASE(only_dependents_are_affected)
+{
+    // A uses B, C uses nothing; all in package p
+    Ast::program prog{ unit("A", "B"), unit("B", ""), unit("C", "") };
+    files before{ { "A.java", "a" }, { "B.java", "b" }, { "C.java", "c" } };
+    files after{ { "A.java", "a" }, { "B.java", "b changed" }, { "C.java", "c" } };
+    Ast::dependency_graph previous(prog, before);
+    Ast::dependency_graph current(prog, after);
+
+    std::set<std::string> affected = current.affected_units(previous);
+    BOOST_CHECK(affected == (std::set<std::string>{ "A.java", "B.java" }));
+    BOOST_CHECK(current.affected_units(current).empty());
+    // Without a previous run, everything is
+    BOOST_CHECK_EQUAL(current.affected_units(Ast::dependency_graph()).size(), 3u);
+}
+
+BOOST_AUTO_TEST_CASE(save_and_load)
+{
+    Ast::program prog{ unit("A", "B"), unit("B", "") };
+    files contents{ { "A.java", "a" }, { "B.java", "b" } };
+    Ast::dependency_graph graph(prog, contents);
+    std::string path = "/tmp/joos-dependencies-test";
+    graph.save(path);
+    Maybe<Ast::dependency_graph> loaded = Ast::dependency_graph::load(path);
+    BOOST_REQUIRE(loaded);
+    BOOST_CHECK(graph.affected_units(*loaded).empty());
+    BOOST_CHECK_EQUAL(loaded->units()[0].simple_names.size(), 1u);
+
+    // A corrupt hash is no graph, rather than an error
+    {
+        std::ofstream corrupt(path);
+        corrupt << "jast-dependencies 3\nlibrary\t0\nA.java\tnothex\tp\tp.A\t\t\t\n";
+    }
+    BOOST_CHECK(!Ast::dependency_graph::load(path));
+    std::remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(a_changed_library_affects_every_unit)
+{
+    Ast::program prog{ unit("A", "B"), unit("B", ""), unit("C", "") };
+    files contents{ { "A.java", "a" }, { "B.java", "b" }, { "C.java", "c" } };
+    Ast::dependency_graph previous(prog, contents, 1);
+    BOOST_CHECK(Ast::dependency_graph(prog, contents, 1).affected_units(previous).empty());
+    BOOST_CHECK_EQUAL(Ast::dependency_graph(prog, contents, 2).affected_units(previous).size(), 3u);
+    BOOST_CHECK_EQUAL(Ast::dependency_graph(prog, contents).affected_units(previous).size(), 3u);
+
+    // Which survives saving
+    std::string path = "/tmp/joos-dependencies-library-test";
+    previous.save(path);
+    Maybe<Ast::dependency_graph> loaded = Ast::dependency_graph::load(path);
+    BOOST_REQUIRE(loaded);
+    BOOST_CHECK(Ast::dependency_graph(prog, contents, 1).affected_units(*loaded).empty());
+    BOOST_CHECK_EQUAL(Ast::dependency_graph(prog, contents, 2).affected_units(*loaded).size(), 3u);
+    std::remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(programs_are_saved_apart)
+{
+    // The same files, in any order, are the same program
+    files ab{ { "A.java", "a" }, { "B.java", "b" } };
+    files ba{ { "B.java", "b changed" }, { "A.java", "a" } };
+    files ac{ { "A.java", "a" }, { "C.java", "c" } };
+    BOOST_CHECK_EQUAL(Ast::dependency_graph::saved_path("/cache", ab), Ast::dependency_graph::saved_path("/cache", ba));
+    BOOST_CHECK(Ast::dependency_graph::saved_path("/cache", ab) != Ast::dependency_graph::saved_path("/cache", ac));
+    BOOST_CHECK_EQUAL(Ast::dependency_graph::saved_path("/cache", ab).compare(0, 7, "/cache/"), 0);
+}
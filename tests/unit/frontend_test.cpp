@@ -0,0 +1,49 @@
+#define BOOST_TEST_MODULE frontend
+#include <boost/test/included/unit_test.hpp>
+
+#include "ast.hpp"
+#include "frontend.hpp"
+
+#include <string>
+
+namespace
+{
+    std::string type_name(Ast::source_file const& sf)
+    {
+        if(Ast::class_declaration const* klass = boost::get<Ast::class_declaration>(&sf.type))
+        {
+            return "class " + klass->name.identifier_string;
+        }
+        return "interface " + boost::get<Ast::interface_declaration>(sf.type).name.identifier_string;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(sources_make_a_program)
+{
+    Frontend::result r = Frontend::compile_sources({ { "A.java", "public class A { }" },
+                                                     { "B.java", "public interface B { }" } });
+    BOOST_CHECK(r.success());
+    BOOST_REQUIRE_EQUAL(r.program.size(), 2u);
+    // In the order given, named as given
+    BOOST_CHECK_EQUAL(r.program.front().name, "A.java");
+    BOOST_CHECK_EQUAL(type_name(r.program.front()), "class A");
+    BOOST_CHECK_EQUAL(r.program.back().name, "B.java");
+    BOOST_CHECK_EQUAL(type_name(r.program.back()), "interface B");
+}
+
+BOOST_AUTO_TEST_CASE(sources_with_errors_are_left_out)
+{
+    // A syntax error, and a weeding error, around a source without either
+    Frontend::result r = Frontend::compile_sources({ { "Broken.java", "public class Broken {" },
+                                                     { "A.java", "public class A { }" },
+                                                     { "C.java", "public class D { }" } });
+    BOOST_CHECK(!r.success());
+    BOOST_REQUIRE_EQUAL(r.diagnostics.size(), 2u);
+    BOOST_CHECK_EQUAL(r.diagnostics[0].source_name, "Broken.java");
+    BOOST_CHECK(r.diagnostics[0].message.empty() == false);
+    BOOST_CHECK_EQUAL(r.diagnostics[1].source_name, "C.java");
+    BOOST_CHECK(r.diagnostics[1].message.find("D.java") != std::string::npos);
+    // The remaining source is still parsed
+    BOOST_REQUIRE_EQUAL(r.program.size(), 1u);
+    BOOST_CHECK_EQUAL(type_name(r.program.front()), "class A");
+}
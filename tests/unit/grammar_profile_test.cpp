@@ -0,0 +1,80 @@
+#define BOOST_TEST_MODULE grammar_profile
+#include <boost/test/included/unit_test.hpp>
+
+#include "grammar_profile.hpp"
+#include "output_sink.hpp"
+
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+    namespace qi = boost::spirit::qi;
+
+    // Drive a profiler as qi::debug would
+    void call(Profile::rule_profiler const& profiler, qi::debug_handler_state state)
+    {
+        int position = 0;
+        int context = 0;
+        profiler(position, position, context, state, "");
+    }
+
+    std::string report()
+    {
+        std::string text;
+        output_sink out(text);
+        Profile::write_report(out);
+        out.flush();
+        return text;
+    }
+
+    // The line of the report for a rule
+    std::string rule_line(std::string const& name)
+    {
+        std::string text = report();
+        std::size_t at = text.find("  " + name + " ");
+        BOOST_REQUIRE(at != std::string::npos);
+        return text.substr(at, text.find('\n', at) - at);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(exceptions_unwind_active_rules)
+{
+    Profile::rule_profiler outer("outer_rule");
+    Profile::rule_profiler inner("inner_rule");
+    try
+    {
+        Profile::parse_scope scope;
+        call(outer, qi::pre_parse);
+        call(inner, qi::pre_parse);
+        // A semantic action throws; neither rule is left through the handler
+        throw std::runtime_error("weeding error");
+    }
+    catch(std::runtime_error&)
+    {
+    }
+    // Both were counted as failures, and the next parse starts balanced
+    BOOST_CHECK(rule_line("outer_rule").find("1            0            1") != std::string::npos);
+    {
+        Profile::parse_scope scope;
+        call(outer, qi::pre_parse);
+        call(outer, qi::successful_parse);
+    }
+    BOOST_CHECK(rule_line("outer_rule").find("2            1            1") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(reset_and_disable)
+{
+    Profile::rule_profiler rule("reset_rule");
+    call(rule, qi::pre_parse);
+    call(rule, qi::failed_parse);
+    Profile::count_token(1);
+    Profile::reset();
+    BOOST_CHECK(rule_line("reset_rule").find("0            0            0") != std::string::npos);
+    BOOST_CHECK(report().find("Tokens (0 in total") != std::string::npos);
+
+    Profile::enable();
+    BOOST_CHECK(Profile::enabled());
+    Profile::disable();
+    BOOST_CHECK(!Profile::enabled());
+}
@@ -0,0 +1,193 @@
+#define BOOST_TEST_MODULE hierarchy
+#include <boost/test/included/unit_test.hpp>
+
+#include "ast.hpp"
+#include "ast_names.hpp"
+#include "environment.hpp"
+#include "hierarchy.hpp"
+#include "type_scope.hpp"
+
+#include <list>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // A type of package p, T<n>, with its supertypes by number
+    struct type_spec
+    {
+        bool is_interface;
+        int superclass;
+        std::vector<int> interfaces;
+    };
+
+    std::string type_name(int n)
+    {
+        return "T" + std::to_string(n);
+    }
+
+    Ast::namedtype simple(std::string name)
+    {
+        return Ast::namedtype(Ast::make_simple_name(Ast::identifier(name)));
+    }
+
+    std::list<Ast::source_file> sources(std::vector<type_spec> const& specs)
+    {
+        std::list<Ast::source_file> files;
+        for(std::size_t n = 0; n < specs.size(); n++)
+        {
+            std::list<Ast::namedtype> interfaces;
+            for(int interface : specs[n].interfaces)
+            {
+                interfaces.push_back(simple(type_name(interface)));
+            }
+            Ast::source_file sf;
+            sf.name = type_name(n) + ".java";
+            sf.package = Ast::name(Ast::make_simple_name(Ast::identifier("p")));
+            if(specs[n].is_interface)
+            {
+                sf.type = Ast::interface_declaration{ Ast::identifier(type_name(n)), interfaces, {} };
+            }
+            else
+            {
+                Ast::namedtype extends = specs[n].superclass < 0
+                                       ? Ast::namedtype(Ast::name_qualified(Ast::intern_name({ Ast::identifier("java"), Ast::identifier("lang"), Ast::identifier("Object") })))
+                                       : simple(type_name(specs[n].superclass));
+                sf.type = Ast::class_declaration{ false, false, Ast::identifier(type_name(n)), extends, interfaces, {} };
+            }
+            files.push_back(sf);
+        }
+        return files;
+    }
+
+    // The supertypes of every type, itself included; supertypes are numbered
+    // before their subtypes
+    std::vector<std::vector<bool>> closure(std::vector<type_spec> const& specs)
+    {
+        std::vector<std::vector<bool>> supertypes(specs.size(), std::vector<bool>(specs.size(), false));
+        for(std::size_t type = 0; type < specs.size(); type++)
+        {
+            std::vector<int> direct = specs[type].interfaces;
+            if(specs[type].superclass >= 0)
+            {
+                direct.push_back(specs[type].superclass);
+            }
+            for(int super : direct)
+            {
+                for(std::size_t n = 0; n < specs.size(); n++)
+                {
+                    if(supertypes[super][n])
+                    {
+                        supertypes[type][n] = true;
+                    }
+                }
+            }
+            supertypes[type][type] = true;
+        }
+        return supertypes;
+    }
+
+    // Check every pair of types against the closure; returns whether the
+    // interfaces were labelled
+    bool check_all(std::vector<type_spec> const& specs)
+    {
+        std::list<Ast::source_file> files = sources(specs);
+        Environment::class_environment environment(files.size());
+        for(Ast::source_file const& sf : files)
+        {
+            environment.insert(Environment::qualified_type_name(sf), sf);
+        }
+        environment.freeze();
+        Environment::scope_cache scopes;
+        Hierarchy::type_hierarchy hierarchy(environment, scopes);
+
+        std::vector<Hierarchy::type_index> index(specs.size());
+        for(std::size_t n = 0; n < specs.size(); n++)
+        {
+            index[n] = hierarchy.index_of(Ast::intern_name({ Ast::identifier("p"), Ast::identifier(type_name(n)) }));
+        }
+        std::vector<std::vector<bool>> supertypes = closure(specs);
+        std::size_t mismatches = 0;
+        for(std::size_t sub = 0; sub < specs.size(); sub++)
+        {
+            for(std::size_t super = 0; super < specs.size(); super++)
+            {
+                if(hierarchy.is_subtype(index[sub], index[super]) != supertypes[sub][super])
+                {
+                    mismatches++;
+                }
+            }
+        }
+        BOOST_CHECK_EQUAL(mismatches, 0u);
+        return hierarchy.interfaces_labelled();
+    }
+
+    // Interfaces 0..interfaces-1, each extending the one before, and some
+    // one further back; then classes implementing some of them
+    std::vector<type_spec> chain(int interfaces)
+    {
+        std::vector<type_spec> specs;
+        for(int n = 0; n < interfaces; n++)
+        {
+            type_spec spec{ true, -1, {} };
+            if(n > 0)
+            {
+                spec.interfaces.push_back(n - 1);
+            }
+            if(n > 2 && n % 3 == 0)
+            {
+                spec.interfaces.push_back(n / 2 - 1);
+            }
+            specs.push_back(spec);
+        }
+        specs.push_back({ false, -1, { interfaces / 2 } });
+        specs.push_back({ false, interfaces, { 0, interfaces - 1 } });
+        specs.push_back({ false, interfaces + 1, {} });
+        return specs;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(sparse_interfaces_are_bucketed)
+{
+    // Two separate families, and a class implementing one of each
+    std::vector<type_spec> specs{
+        { true, -1, {} }, { true, -1, { 0 } }, { true, -1, {} }, { true, -1, { 2 } },
+        { false, -1, { 1, 3 } }, { false, 4, {} }, { false, -1, { 2 } } };
+    BOOST_CHECK(check_all(specs) == false);
+    BOOST_CHECK(check_all(chain(40)) == false);
+}
+
+BOOST_AUTO_TEST_CASE(deep_interface_chains_are_labelled)
+{
+    BOOST_CHECK(check_all(chain(600)) == true);
+}
+
+BOOST_AUTO_TEST_CASE(long_interface_chain)
+{
+    // Quadratic in the length, if every type kept all its superinterfaces
+    const int length = 100000;
+    std::vector<type_spec> specs;
+    for(int n = 0; n < length; n++)
+    {
+        specs.push_back({ true, -1, n > 0 ? std::vector<int>{ n - 1 } : std::vector<int>() });
+    }
+    std::list<Ast::source_file> files = sources(specs);
+    Environment::class_environment environment(files.size());
+    for(Ast::source_file const& sf : files)
+    {
+        environment.insert(Environment::qualified_type_name(sf), sf);
+    }
+    environment.freeze();
+    Environment::scope_cache scopes;
+    Hierarchy::type_hierarchy hierarchy(environment, scopes);
+    BOOST_CHECK(hierarchy.interfaces_labelled());
+
+    auto index = [&hierarchy](int n)
+    {
+        return hierarchy.index_of(Ast::intern_name({ Ast::identifier("p"), Ast::identifier(type_name(n)) }));
+    };
+    BOOST_CHECK(hierarchy.is_subtype(index(length - 1), index(0)));
+    BOOST_CHECK(hierarchy.is_subtype(index(length / 2), index(length / 2 - 1)));
+    BOOST_CHECK(!hierarchy.is_subtype(index(0), index(length - 1)));
+    BOOST_CHECK(!hierarchy.is_subtype(index(length / 2), index(length / 2 + 1)));
+}
@@ -0,0 +1,48 @@
+#define BOOST_TEST_MODULE incremental
+#include <boost/test/included/unit_test.hpp>
+
+#include "ast.hpp"
+#include "ast_incremental.hpp"
+#include "Error.hpp"
+
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+    std::string class_name(Ast::incremental_source_file const& file)
+    {
+        return boost::get<Ast::class_declaration>(file.ast().type).name.identifier_string;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(edits_to_whitespace_and_comments_keep_the_ast)
+{
+    Ast::incremental_source_file file("A.java", "public class A { }");
+    BOOST_CHECK(!file.apply_edit(14, 0, " /* A comment */"));
+    BOOST_CHECK_EQUAL(file.contents(), "public class A /* A comment */ { }");
+    BOOST_CHECK(!file.apply_edit(0, 0, "// Leading\n"));
+    BOOST_CHECK_EQUAL(class_name(file), "A");
+}
+
+BOOST_AUTO_TEST_CASE(edits_to_tokens_parse_again)
+{
+    Ast::incremental_source_file file("A.java", "public class A { }");
+    // Growing a token, at its end
+    BOOST_CHECK(file.apply_edit(14, 0, "B"));
+    BOOST_CHECK_EQUAL(class_name(file), "AB");
+    BOOST_CHECK(file.apply_edit(13, 2, "C"));
+    BOOST_CHECK_EQUAL(file.contents(), "public class C { }");
+    BOOST_CHECK_EQUAL(class_name(file), "C");
+}
+
+BOOST_AUTO_TEST_CASE(failed_edits_leave_the_file)
+{
+    Ast::incremental_source_file file("A.java", "public class A { }");
+    BOOST_CHECK_THROW(file.apply_edit(15, 1, ""), Error::Syntax_Error);
+    BOOST_CHECK_THROW(file.apply_edit(18, 1, ""), std::out_of_range);
+    BOOST_CHECK_EQUAL(file.contents(), "public class A { }");
+    BOOST_CHECK_EQUAL(class_name(file), "A");
+    // And later edits still apply
+    BOOST_CHECK(!file.apply_edit(16, 0, "\n"));
+}
@@ -0,0 +1,88 @@
+#define BOOST_TEST_MODULE locals
+#include <boost/test/included/unit_test.hpp>
+
+#include "ast.hpp"
+#include "ast_locals.hpp"
+#include "ast_names.hpp"
+#include "Error.hpp"
+
+#include <list>
+#include <string>
+
+namespace
+{
+    Ast::name simple(std::string name)
+    {
+        return Ast::name(Ast::make_simple_name(Ast::identifier(name)));
+    }
+
+    Ast::lvalue target(std::string name)
+    {
+        return Ast::lvalue_ambiguous_name{ simple(name) };
+    }
+
+    Ast::lvalue const& target_of(Ast::statement const& stm)
+    {
+        Ast::expression const& exp = boost::get<Ast::statement_expression>(stm).value;
+        if(Ast::expression_assignment const* assignment = boost::get<Ast::expression_assignment>(&exp))
+        {
+            return assignment->variable;
+        }
+        return boost::get<Ast::expression_incdec>(exp).variable;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(assignment_targets)
+{
+    // 'int x = 0; x = 1; x++; x.f = 1; y = 1;'
+    Ast::body b;
+    b.push_back(Ast::statement_local_declaration{ Ast::type_expression_base(Ast::base_type_int()), Ast::identifier("x"),
+                                                   Ast::expression(Ast::expression_integer_constant{ "0" }) });
+    b.push_back(Ast::statement_expression{ Ast::expression_assignment{ target("x"), Ast::expression_integer_constant{ "1" } } });
+    b.push_back(Ast::statement_expression{ Ast::expression_incdec{ target("x"), Ast::inc_dec_op_postinc() } });
+    Ast::name field = Ast::name(Ast::name_qualified(Ast::intern_name(Ast::intern_name(Ast::root_name_id, "x"), "f")));
+    b.push_back(Ast::statement_expression{ Ast::expression_assignment{ Ast::lvalue_ambiguous_name{ field }, Ast::expression_integer_constant{ "1" } } });
+    b.push_back(Ast::statement_expression{ Ast::expression_assignment{ target("y"), Ast::expression_integer_constant{ "1" } } });
+
+    BOOST_CHECK_EQUAL(Ast::resolve_locals(std::list<Ast::formal_parameter>(), b, "A.java"), 1u);
+
+    auto stm = b.begin();
+    ++stm;
+    // The local itself, assigned and incremented
+    BOOST_CHECK_EQUAL(boost::get<Ast::lvalue_local>(target_of(*stm)).slot, 0u);
+    ++stm;
+    BOOST_CHECK_EQUAL(boost::get<Ast::lvalue_local>(target_of(*stm)).slot, 0u);
+    // A field of it
+    ++stm;
+    Ast::lvalue_non_static_field const& access = boost::get<Ast::lvalue_non_static_field>(target_of(*stm));
+    BOOST_CHECK_EQUAL(access.name.identifier_string, "f");
+    BOOST_CHECK_EQUAL(boost::get<Ast::lvalue_local>(access.exp).slot, 0u);
+    // Not a local, left for disambiguation
+    ++stm;
+    BOOST_CHECK(boost::get<Ast::lvalue_ambiguous_name>(&target_of(*stm)) != nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(redeclaration)
+{
+    // '{ int x; } int x; int x;'
+    Ast::statement_local_declaration local{ Ast::type_expression_base(Ast::base_type_int()), Ast::identifier("x"), Maybe<Ast::expression>() };
+    Ast::body b;
+    b.push_back(Ast::statement_block{ Ast::block{ local } });
+    b.push_back(local);
+    BOOST_CHECK_EQUAL(Ast::resolve_locals(std::list<Ast::formal_parameter>(), b, "A.java"), 2u);
+    b.push_back(local);
+    BOOST_CHECK_THROW(Ast::resolve_locals(std::list<Ast::formal_parameter>(), b, "A.java"), Error::Environment_Error);
+}
+
+BOOST_AUTO_TEST_CASE(cast_types_are_not_locals)
+{
+    // 'int x; (x) x;', the type of the cast names a type, even with x in scope
+    Ast::body b;
+    b.push_back(Ast::statement_local_declaration{ Ast::type_expression_base(Ast::base_type_int()), Ast::identifier("x"), Maybe<Ast::expression>() });
+    b.push_back(Ast::statement_expression{ Ast::expression_ambiguous_cast{ Ast::lvalue_ambiguous_name{ simple("x") }, Ast::lvalue_ambiguous_name{ simple("x") } } });
+    BOOST_CHECK_EQUAL(Ast::resolve_locals(std::list<Ast::formal_parameter>(), b, "A.java"), 1u);
+
+    Ast::expression_ambiguous_cast const& cast = boost::get<Ast::expression_ambiguous_cast>(boost::get<Ast::statement_expression>(b.back()).value);
+    BOOST_CHECK(boost::get<Ast::lvalue_ambiguous_name>(&cast.type) != nullptr);
+    BOOST_CHECK_EQUAL(boost::get<Ast::lvalue_local>(cast.value).slot, 0u);
+}
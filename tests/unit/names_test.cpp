@@ -0,0 +1,110 @@
+#define BOOST_TEST_MODULE names
+#include <boost/test/included/unit_test.hpp>
+
+#include "ast.hpp"
+#include "ast_helper.hpp"
+#include "ast_names.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_CASE(intern_and_query)
+{
+    Ast::name_qualified navn = Ast::make_qualified_name({ {"java"}, {"lang"}, {"Object"} });
+    Ast::name_id id = Ast::name_to_id(navn);
+    BOOST_CHECK_EQUAL(Ast::name_id_to_string(id), "java.lang.Object");
+    BOOST_CHECK_EQUAL(Ast::name_length(id), 3u);
+    BOOST_CHECK_EQUAL(Ast::name_component(id), "Object");
+
+    // The same name is only stored once
+    Ast::name_id lang = Ast::name_parent(id);
+    BOOST_CHECK_EQUAL(Ast::intern_name(Ast::intern_name(Ast::root_name_id, "java"), "lang"), lang);
+    BOOST_CHECK(Ast::name_in_package(id, lang));
+    BOOST_CHECK(Ast::name_has_prefix(id, lang));
+    BOOST_CHECK(!Ast::name_has_prefix(lang, id));
+
+    // And the components can be read back from the id alone
+    std::list<Ast::identifier> components = Ast::name_to_identifier_list(Ast::name(navn));
+    BOOST_CHECK_EQUAL(components.size(), 3u);
+    BOOST_CHECK_EQUAL(components.back().identifier_string, "Object");
+}
+
+BOOST_AUTO_TEST_CASE(find_does_not_insert)
+{
+    Ast::name_id java = Ast::intern_name(Ast::root_name_id, "java");
+    std::size_t before = Ast::name_children(java).size();
+    BOOST_CHECK_EQUAL(Ast::find_name(java, "nothere"), Ast::root_name_id);
+    BOOST_CHECK_EQUAL(Ast::name_children(java).size(), before);
+    Ast::name_id added = Ast::intern_name(java, "nothere");
+    BOOST_CHECK_EQUAL(Ast::find_name(java, "nothere"), added);
+    BOOST_CHECK_EQUAL(Ast::name_children(java).size(), before + 1);
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_interning)
+{
+    // Threads interning overlapping names agree on the ids, while others query
+    const unsigned threads = 4;
+    const unsigned names = 20000;
+    std::vector<std::vector<Ast::name_id>> ids(threads, std::vector<Ast::name_id>(names));
+    std::atomic<unsigned> mismatches(0);
+    std::vector<std::thread> workers;
+    for(unsigned t = 0; t < threads; t++)
+    {
+        workers.emplace_back([&, t]()
+        {
+            Ast::name_id package = Ast::intern_name(Ast::root_name_id, "concurrent");
+            for(unsigned n = 0; n < names; n++)
+            {
+                ids[t][n] = Ast::intern_name(package, "T" + std::to_string(n));
+                // Boost.Test checks are not thread safe, so count the failures
+                if(Ast::name_component(ids[t][n]) != "T" + std::to_string(n) ||
+                   Ast::find_name(package, "T" + std::to_string(n)) != ids[t][n])
+                {
+                    mismatches++;
+                }
+            }
+        });
+    }
+    for(auto& worker : workers)
+    {
+        worker.join();
+    }
+    BOOST_CHECK_EQUAL(mismatches.load(), 0u);
+    for(unsigned t = 1; t < threads; t++)
+    {
+        BOOST_CHECK(ids[t] == ids[0]);
+    }
+    // The children, once the threads are done
+    Ast::name_id package = Ast::find_name(Ast::root_name_id, "concurrent");
+    std::vector<Ast::name_id> children = Ast::name_children(package);
+    std::sort(children.begin(), children.end());
+    std::vector<Ast::name_id> expected = ids[0];
+    std::sort(expected.begin(), expected.end());
+    BOOST_CHECK(children == expected);
+}
+
+BOOST_AUTO_TEST_CASE(truncation_drops_the_later_names)
+{
+    Ast::name_id package = Ast::intern_name(Ast::root_name_id, "truncated");
+    Ast::name_id kept = Ast::intern_name(package, "Kept");
+    std::size_t count = Ast::name_count();
+    Ast::name_id dropped = Ast::intern_name(package, "Dropped");
+    Ast::intern_name(Ast::intern_name(Ast::root_name_id, "gone"), "Gone");
+    BOOST_CHECK_EQUAL(Ast::name_count(), count + 3);
+
+    Ast::truncate_names(count);
+    BOOST_CHECK_EQUAL(Ast::name_count(), count);
+    BOOST_CHECK_EQUAL(Ast::find_name(package, "Dropped"), Ast::root_name_id);
+    BOOST_CHECK_EQUAL(Ast::find_name(Ast::root_name_id, "gone"), Ast::root_name_id);
+    BOOST_CHECK(Ast::name_children(package) == std::vector<Ast::name_id>{ kept });
+    BOOST_CHECK_EQUAL(Ast::find_name(package, "Kept"), kept);
+
+    // The ids are handed out again, and linked as children again
+    Ast::name_id again = Ast::intern_name(package, "Again");
+    BOOST_CHECK_EQUAL(again, dropped);
+    BOOST_CHECK_EQUAL(Ast::name_id_to_string(again), "truncated.Again");
+    BOOST_CHECK((Ast::name_children(package) == std::vector<Ast::name_id>{ kept, again }));
+}
@@ -0,0 +1,41 @@
+#define BOOST_TEST_MODULE trace
+#include <boost/test/included/unit_test.hpp>
+
+#include "output_sink.hpp"
+#include "trace.hpp"
+
+#include <string>
+#include <thread>
+
+namespace
+{
+    std::size_t occurrences(std::string const& text, std::string const& what)
+    {
+        std::size_t count = 0;
+        for(std::size_t at = text.find(what); at != std::string::npos; at = text.find(what, at + 1))
+        {
+            count++;
+        }
+        return count;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(exited_threads_hand_back_their_buffers)
+{
+    Trace::start();
+    // As the phases do, start threads one after another
+    for(unsigned n = 0; n < 100; n++)
+    {
+        std::thread worker([]{ Trace::span span("work", "test"); });
+        worker.join();
+    }
+    std::string trace;
+    {
+        output_sink out(trace);
+        Trace::stop(out);
+        out.flush();
+    }
+    // Every span is kept, on the track of the one buffer they took turns on
+    BOOST_CHECK_EQUAL(occurrences(trace, "\"name\": \"work\""), 100u);
+    BOOST_CHECK_EQUAL(occurrences(trace, "\"thread_name\""), 1u);
+}
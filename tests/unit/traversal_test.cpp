@@ -0,0 +1,164 @@
+#define BOOST_TEST_MODULE traversal
+#include <boost/test/included/unit_test.hpp>
+
+#include "ast.hpp"
+#include "ast_names.hpp"
+#include "ast_pp.hpp"
+#include "ast_traversal.hpp"
+#include "output_sink.hpp"
+
+#include <string>
+
+namespace
+{
+    const std::size_t depth = 1000000;
+
+    Ast::expression one()
+    {
+        return Ast::expression_integer_constant{ "1" };
+    }
+
+    Ast::expression variable(std::string name)
+    {
+        return Ast::lvalue_ambiguous_name{ Ast::name(Ast::make_simple_name(Ast::identifier(name))) };
+    }
+
+    // '1 + 1 + ... + 1', nested to the left; built top-down, as building it
+    // bottom-up would move (and thereby recurse through) the chain built so far
+    void build_binop_chain(Ast::expression& root, std::size_t operators)
+    {
+        Ast::expression* leftmost = &root;
+        for(std::size_t n = 0; n < operators; n++)
+        {
+            *leftmost = Ast::expression_binop{ one(), Ast::binop_plus(), one() };
+            leftmost = &boost::get<Ast::expression_binop>(*leftmost).operand1;
+        }
+    }
+
+    template<typename T>
+    std::string print(T const& node)
+    {
+        std::string buffer;
+        output_sink out(buffer);
+        Ast::pretty_print(node, out);
+        out.flush();
+        return buffer;
+    }
+
+    // 'while(x) while(x) ... ;', built in place, as moving it would recurse
+    void build_while_chain(Ast::statement& root, std::size_t loops)
+    {
+        Ast::statement* innermost = &root;
+        for(std::size_t n = 0; n < loops; n++)
+        {
+            *innermost = Ast::statement_while{ variable("x"), Ast::statement_empty() };
+            innermost = &boost::get<Ast::statement_while>(*innermost).loop_statement;
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(deep_binop_chain)
+{
+    Ast::expression chain = one();
+    build_binop_chain(chain, depth);
+
+    // Every node is entered and left once, children before their parents
+    std::size_t entered = 0;
+    std::size_t left = 0;
+    std::size_t leafs_before_root = 0;
+    Ast::traversal counter;
+    counter.enter_expression = [&](Ast::expression const&){ entered++; };
+    counter.leave_expression = [&](Ast::expression const& exp)
+    {
+        left++;
+        if(boost::get<Ast::expression_integer_constant>(&exp))
+        {
+            leafs_before_root++;
+        }
+        else if(&exp == &chain)
+        {
+            BOOST_CHECK_EQUAL(leafs_before_root, depth + 1);
+        }
+    };
+    Ast::traverse(chain, counter);
+    BOOST_CHECK_EQUAL(entered, 2 * depth + 1);
+    BOOST_CHECK_EQUAL(left, 2 * depth + 1);
+
+    // '1' followed by ' + 1' per operator
+    std::string printed = print(chain);
+    BOOST_CHECK_EQUAL(printed.size(), 1 + 4 * depth);
+    BOOST_CHECK_EQUAL(printed.substr(0, 9), "1 + 1 + 1");
+
+    // Destroying it must not recurse either
+    Ast::dismantle(chain);
+    BOOST_CHECK(boost::get<Ast::expression_null>(&chain) != nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(deep_statement_nesting)
+{
+    Ast::statement root = Ast::statement_empty();
+    build_while_chain(root, depth);
+    std::size_t statements = 0;
+    std::size_t expressions = 0;
+    Ast::traversal counter;
+    counter.enter_statement = [&](Ast::statement const&){ statements++; };
+    counter.enter_expression = [&](Ast::expression const&){ expressions++; };
+    Ast::traverse(root, counter);
+    BOOST_CHECK_EQUAL(statements, depth + 1);
+    BOOST_CHECK_EQUAL(expressions, depth);
+
+    // 'while( x)' and a newline per loop, then ';'
+    std::string printed = print(root);
+    BOOST_CHECK_EQUAL(printed.size(), 10 * depth + 1);
+    BOOST_CHECK_EQUAL(printed.substr(0, 20), "while( x)\nwhile( x)\n");
+    Ast::dismantle(root);
+}
+
+BOOST_AUTO_TEST_CASE(declarations_dismantle_their_trees)
+{
+    // Neither is dismantled here, their destructors must not recurse
+    Ast::method_declaration method;
+    method.method_body = Ast::body(1, Ast::statement_empty());
+    build_while_chain(method.method_body->front(), depth);
+    Ast::field_declaration field;
+    field.optional_initializer = one();
+    build_binop_chain(*field.optional_initializer, depth);
+}
+
+BOOST_AUTO_TEST_CASE(pretty_print_statements)
+{
+    // if(x) { y; } else while(x) ;
+    Ast::statement block = Ast::statement_block{ Ast::block{ Ast::statement_expression{ variable("y") } } };
+    Ast::statement loop = Ast::statement_empty();
+    build_while_chain(loop, 1);
+    Ast::statement branch = Ast::statement_if_then_else{ variable("x"), block, loop };
+    BOOST_CHECK_EQUAL(print(branch), "if( x)\n{\ny;}\n\nelse\nwhile( x)\n;");
+}
+
+BOOST_AUTO_TEST_CASE(pretty_print_layout)
+{
+    // a[i] = b.f(1, c)
+    Ast::expression invoke = Ast::expression_non_static_invoke{ variable("b"), Ast::identifier("f"), { one(), variable("c") } };
+    Ast::expression element = Ast::expression_assignment{ Ast::lvalue_array{ variable("a"), variable("i") }, invoke };
+    BOOST_CHECK_EQUAL(print(element), "a[i] = b.f(1, c)");
+
+    // x.y++, -(x), g()
+    Ast::expression field = Ast::expression_incdec{ Ast::lvalue_non_static_field{ variable("x"), Ast::identifier("y") }, Ast::inc_dec_op_postinc() };
+    BOOST_CHECK_EQUAL(print(field), "x.y++");
+    Ast::expression negated = Ast::expression_unop{ Ast::unop_negate(), Ast::expression_parentheses{ variable("x") } };
+    BOOST_CHECK_EQUAL(print(negated), "-(x)");
+    Ast::expression call = Ast::expression_simple_invoke{ Ast::identifier("g"), {} };
+    BOOST_CHECK_EQUAL(print(call), "g()");
+
+    // new int[n][1][], new int[n][][1]
+    Ast::type_expression int_type = Ast::type_expression_base(Ast::base_type_int());
+    Ast::expression sized = Ast::expression_new_array{ int_type, variable("n"), { Maybe<Ast::expression>(one()), Maybe<Ast::expression>() } };
+    BOOST_CHECK_EQUAL(print(sized), "new int[n][1][]");
+    Ast::expression gap = Ast::expression_new_array{ int_type, variable("n"), { Maybe<Ast::expression>(), Maybe<Ast::expression>(one()) } };
+    BOOST_CHECK_EQUAL(print(gap), "new int[n][][1]");
+
+    // o.x = (T) y
+    Ast::expression cast = Ast::expression_ambiguous_cast{ variable("T"), variable("y") };
+    Ast::expression assignment = Ast::expression_assignment{ Ast::lvalue_non_static_field{ variable("o"), Ast::identifier("x") }, cast };
+    BOOST_CHECK_EQUAL(print(assignment), "o.x = (T) y");
+}
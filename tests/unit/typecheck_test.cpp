@@ -0,0 +1,273 @@
+#define BOOST_TEST_MODULE typecheck
+#include <boost/test/included/unit_test.hpp>
+
+#include "ast.hpp"
+#include "ast_locals.hpp"
+#include "ast_names.hpp"
+#include "ast_types.hpp"
+#include "environment.hpp"
+#include "Error.hpp"
+#include "hierarchy.hpp"
+#include "type_checker.hpp"
+#include "type_scope.hpp"
+
+#include <list>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+    Ast::name simple(std::string name)
+    {
+        return Ast::name(Ast::make_simple_name(Ast::identifier(name)));
+    }
+
+    Ast::type_expression base(Ast::type_expression_base type)
+    {
+        return type;
+    }
+
+    Ast::type_expression named(std::string name)
+    {
+        return Ast::type_expression_named(simple(name));
+    }
+
+    Ast::expression variable(std::string name)
+    {
+        return Ast::lvalue_ambiguous_name{ simple(name) };
+    }
+
+    Ast::expression integer(std::string digits)
+    {
+        return Ast::expression_integer_constant{ digits };
+    }
+
+    Ast::expression boolean(bool value)
+    {
+        return Ast::expression_boolean_constant{ value };
+    }
+
+    Ast::statement local(Ast::type_expression type, std::string name, Ast::expression initializer)
+    {
+        return Ast::statement_local_declaration{ type, Ast::identifier(name), initializer };
+    }
+
+    Ast::statement call(std::string method, std::list<Ast::expression> arguments)
+    {
+        return Ast::statement_expression{ Ast::expression_simple_invoke{ Ast::identifier(method), arguments } };
+    }
+
+    Ast::formal_parameter parameter(Ast::type_expression type, std::string name)
+    {
+        return Ast::formal_parameter(type, Ast::identifier(name));
+    }
+
+    Ast::declaration method(std::string name, bool is_static, Ast::type_expression return_type,
+                            std::list<Ast::formal_parameter> parameters, Ast::body b)
+    {
+        Ast::method_declaration decl;
+        decl.is_static = is_static;
+        decl.is_final = false;
+        decl.is_abstract = false;
+        decl.return_type = return_type;
+        decl.name = Ast::identifier(name);
+        decl.formal_parameters = parameters;
+        decl.method_body = b;
+        return Ast::declaration_method{ decl };
+    }
+
+    Ast::declaration field(std::string name, bool is_static, Ast::type_expression type)
+    {
+        Ast::field_declaration decl;
+        decl.is_static = is_static;
+        decl.is_final = false;
+        decl.type = type;
+        decl.name = Ast::identifier(name);
+        return Ast::declaration_field{ decl };
+    }
+
+    // A class of package p, extending superclass, or Object if empty
+    Ast::source_file klass(std::string name, std::string superclass, std::list<Ast::declaration> members)
+    {
+        Ast::source_file sf;
+        sf.name = name + ".java";
+        sf.package = simple("p");
+        Ast::namedtype extends = superclass.empty()
+                               ? Ast::namedtype(Ast::name_qualified(Ast::intern_name({ Ast::identifier("java"), Ast::identifier("lang"), Ast::identifier("Object") })))
+                               : simple(superclass);
+        sf.type = Ast::class_declaration{ false, false, Ast::identifier(name), extends, {}, members };
+        return sf;
+    }
+
+    // The body of the named method of the class
+    Ast::body const& body_of(Ast::source_file const& sf, std::string name)
+    {
+        for(Ast::declaration const& member : boost::get<Ast::class_declaration>(sf.type).members)
+        {
+            Ast::declaration_method const* m = boost::get<Ast::declaration_method>(&member);
+            if(m && m->decl.name.identifier_string == name)
+            {
+                return *m->decl.method_body;
+            }
+        }
+        throw std::logic_error("no method " + name);
+    }
+
+    // Resolve the locals and check every body, on threads threads; returns
+    // the diagnostics, in the order reported
+    std::vector<std::string> check(Ast::program& program, unsigned threads, Typing::expression_types& types)
+    {
+        for(Ast::source_file& sf : program)
+        {
+            Ast::resolve_locals(sf);
+        }
+        Environment::class_environment environment(program.size());
+        for(Ast::source_file const& sf : program)
+        {
+            environment.insert(Environment::qualified_type_name(sf), sf);
+        }
+        environment.freeze();
+        Environment::scope_cache scopes;
+        Hierarchy::type_hierarchy hierarchy(environment, scopes);
+
+        std::vector<std::string> diagnostics;
+        try
+        {
+            types = Typing::check_program(program, environment, scopes, hierarchy, threads, std::vector<bool>(program.size(), true));
+        }
+        catch(Error::Type_Error& e)
+        {
+            // A count, and then one indented diagnostic per line
+            std::istringstream lines(e.what());
+            std::string line;
+            std::getline(lines, line);
+            while(std::getline(lines, line))
+            {
+                diagnostics.push_back(line.substr(2));
+            }
+        }
+        return diagnostics;
+    }
+
+    std::vector<std::string> check(Ast::program& program, unsigned threads = 1)
+    {
+        Typing::expression_types types;
+        return check(program, threads, types);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(assignability)
+{
+    // 'void m(byte y, int i) { int a = y; byte c = i; boolean d = i;
+    //  A e = new B(); B f = new A(); A g = null; int h = null; }'
+    Ast::body b;
+    b.push_back(local(base(Ast::base_type_int()), "a", variable("y")));
+    b.push_back(local(base(Ast::base_type_byte()), "c", variable("i")));
+    b.push_back(local(base(Ast::base_type_boolean()), "d", variable("i")));
+    b.push_back(local(named("A"), "e", Ast::expression_new{ named("B"), {} }));
+    b.push_back(local(named("B"), "f", Ast::expression_new{ named("A"), {} }));
+    b.push_back(local(named("A"), "g", Ast::expression_null()));
+    b.push_back(local(base(Ast::base_type_int()), "h", Ast::expression_null()));
+    Ast::program program;
+    program.push_back(klass("A", "", { method("m", false, base(Ast::base_type_void()),
+                                              { parameter(base(Ast::base_type_byte()), "y"), parameter(base(Ast::base_type_int()), "i") }, b) }));
+    program.push_back(klass("B", "A", {}));
+
+    std::vector<std::string> expected{
+        "A.java: in method m: initializing c of type byte with int",
+        "A.java: in method m: initializing d of type boolean with int",
+        "A.java: in method m: initializing f of type p.B with p.A",
+        "A.java: in method m: initializing h of type int with null" };
+    BOOST_CHECK(check(program) == expected);
+}
+
+BOOST_AUTO_TEST_CASE(overload_choice)
+{
+    // 'boolean pick(short s); int pick(int i); void t(short s) { pick(s); pick(1); pick(true); }'
+    Ast::body t;
+    t.push_back(call("pick", { variable("s") }));
+    t.push_back(call("pick", { integer("1") }));
+    t.push_back(call("pick", { boolean(true) }));
+    Ast::program program;
+    program.push_back(klass("A", "", {
+        method("pick", false, base(Ast::base_type_boolean()), { parameter(base(Ast::base_type_short()), "s") }, Ast::body{ Ast::statement_value_return{ boolean(true) } }),
+        method("pick", false, base(Ast::base_type_int()), { parameter(base(Ast::base_type_int()), "i") }, Ast::body{ Ast::statement_value_return{ integer("1") } }),
+        method("t", false, base(Ast::base_type_void()), { parameter(base(Ast::base_type_short()), "s") }, t) }));
+
+    Typing::expression_types types;
+    std::vector<std::string> expected{ "A.java: in method t: no method pick applicable to the arguments" };
+    BOOST_CHECK(check(program, 1, types) == expected);
+
+    // The exact match is chosen over the one the argument widens to; no
+    // types are returned along with errors, so check again without them
+    program.front() = klass("A", "", {
+        method("pick", false, base(Ast::base_type_boolean()), { parameter(base(Ast::base_type_short()), "s") }, Ast::body{ Ast::statement_value_return{ boolean(true) } }),
+        method("pick", false, base(Ast::base_type_int()), { parameter(base(Ast::base_type_int()), "i") }, Ast::body{ Ast::statement_value_return{ integer("1") } }),
+        method("t", false, base(Ast::base_type_void()), { parameter(base(Ast::base_type_short()), "s") },
+               Ast::body{ call("pick", { variable("s") }), call("pick", { integer("1") }) }) });
+    BOOST_CHECK(check(program, 1, types).empty());
+    Ast::body const& calls = body_of(program.front(), "t");
+    BOOST_CHECK_EQUAL(types.at(&boost::get<Ast::statement_expression>(calls.front()).value), Ast::boolean_type_id);
+    BOOST_CHECK_EQUAL(types.at(&boost::get<Ast::statement_expression>(calls.back()).value), Ast::int_type_id);
+}
+
+BOOST_AUTO_TEST_CASE(static_and_instance_misuse)
+{
+    // 'int f; static int g; void inst() {} static void stat() {}
+    //  static void s() { inst(); int x = f; A.inst(); int y = g; }
+    //  void i() { this.stat(); stat(); }'
+    Ast::body s;
+    s.push_back(call("inst", {}));
+    s.push_back(local(base(Ast::base_type_int()), "x", variable("f")));
+    s.push_back(Ast::statement_expression{ Ast::expression_ambiguous_invoke{ simple("A"), Ast::identifier("inst"), {} } });
+    s.push_back(local(base(Ast::base_type_int()), "y", variable("g")));
+    Ast::body i;
+    i.push_back(Ast::statement_expression{ Ast::expression_non_static_invoke{ Ast::expression_this(), Ast::identifier("stat"), {} } });
+    i.push_back(call("stat", {}));
+    Ast::program program;
+    program.push_back(klass("A", "", {
+        field("f", false, base(Ast::base_type_int())),
+        field("g", true, base(Ast::base_type_int())),
+        method("inst", false, base(Ast::base_type_void()), {}, Ast::body()),
+        method("stat", true, base(Ast::base_type_void()), {}, Ast::body()),
+        method("s", true, base(Ast::base_type_void()), {}, s),
+        method("i", false, base(Ast::base_type_void()), {}, i) }));
+
+    std::vector<std::string> expected{
+        "A.java: in method s: non static method inst called from a static method",
+        "A.java: in method s: non static field f used in a static method",
+        "A.java: in method s: non static method inst of p.A invoked statically",
+        "A.java: in method i: static method stat of p.A invoked through an instance" };
+    BOOST_CHECK(check(program) == expected);
+}
+
+BOOST_AUTO_TEST_CASE(diagnostics_do_not_depend_on_threads)
+{
+    // Many classes of many methods, each with two errors
+    const unsigned classes = 16;
+    const unsigned methods = 8;
+    Ast::program program;
+    std::vector<std::string> expected;
+    for(unsigned c = 0; c < classes; c++)
+    {
+        std::string name = "C" + std::to_string(c);
+        std::list<Ast::declaration> members;
+        for(unsigned m = 0; m < methods; m++)
+        {
+            std::string method_name = "m" + std::to_string(m);
+            members.push_back(method(method_name, false, base(Ast::base_type_void()), {},
+                                     Ast::body{ local(base(Ast::base_type_boolean()), "b", integer("1")),
+                                                local(base(Ast::base_type_int()), "i", boolean(false)) }));
+            expected.push_back(name + ".java: in method " + method_name + ": initializing b of type boolean with int");
+            expected.push_back(name + ".java: in method " + method_name + ": initializing i of type int with boolean");
+        }
+        program.push_back(klass(name, "", members));
+    }
+    BOOST_CHECK(check(program, 1) == expected);
+    for(unsigned run = 0; run < 4; run++)
+    {
+        BOOST_CHECK(check(program, 4) == expected);
+    }
+}
@@ -0,0 +1,152 @@
+#define BOOST_TEST_MODULE types
+#include <boost/test/included/unit_test.hpp>
+
+#include "ast.hpp"
+#include "ast_names.hpp"
+#include "ast_types.hpp"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    Ast::name_id type_name(std::string name)
+    {
+        return Ast::intern_name({ Ast::identifier("types"), Ast::identifier(name) });
+    }
+}
+
+BOOST_AUTO_TEST_CASE(interning_twice)
+{
+    // The same type, however built, is the same id
+    Ast::type_id named = Ast::named_type(type_name("Foo"));
+    BOOST_CHECK_EQUAL(Ast::named_type(type_name("Foo")), named);
+    Ast::type_expression expression = Ast::type_expression_named(Ast::namedtype(Ast::name_qualified(type_name("Foo"))));
+    BOOST_CHECK_EQUAL(Ast::intern_type(expression), named);
+    BOOST_CHECK(Ast::named_type(type_name("Bar")) != named);
+
+    // The base types have their fixed ids
+    BOOST_CHECK_EQUAL(Ast::intern_type(Ast::type_expression_base(Ast::base_type_int())), Ast::int_type_id);
+    BOOST_CHECK(Ast::is_base_type_id(Ast::boolean_type_id));
+    BOOST_CHECK(!Ast::is_base_type_id(named));
+    BOOST_CHECK_EQUAL(Ast::type_id_kind(named), Ast::type_kind_named);
+    BOOST_CHECK_EQUAL(Ast::type_name(named), type_name("Foo"));
+}
+
+BOOST_AUTO_TEST_CASE(array_nesting)
+{
+    // 'Foo[][]' shares 'Foo[]' and 'Foo'
+    Ast::type_id named = Ast::named_type(type_name("Foo"));
+    Ast::type_id array = Ast::array_type(named);
+    Ast::type_id nested = Ast::array_type(array);
+    BOOST_CHECK(array != named && nested != array);
+    BOOST_CHECK_EQUAL(Ast::array_element(nested), array);
+    BOOST_CHECK_EQUAL(Ast::array_element(array), named);
+    BOOST_CHECK_EQUAL(Ast::type_id_kind(nested), Ast::type_kind_array);
+    BOOST_CHECK_EQUAL(Ast::type_id_to_string(nested), "types.Foo[][]");
+
+    Ast::type_expression foo = Ast::type_expression_named(Ast::namedtype(Ast::name_qualified(type_name("Foo"))));
+    Ast::type_expression foo_array = Ast::type_expression_tarray{ foo };
+    Ast::type_expression expression = Ast::type_expression_tarray{ foo_array };
+    BOOST_CHECK_EQUAL(Ast::intern_type(expression), nested);
+    BOOST_CHECK_EQUAL(Ast::type_id_to_string(Ast::array_type(Ast::int_type_id)), "int[]");
+}
+
+BOOST_AUTO_TEST_CASE(reading_while_interning)
+{
+    // One thread interns deeper and deeper arrays, past a chunk of the
+    // table, while the others read every id handed out so far
+    const unsigned depth = 10000;
+    const unsigned readers = 3;
+    Ast::type_id element = Ast::named_type(type_name("Deep"));
+    std::vector<std::atomic<Ast::type_id>> ids(depth);
+    std::atomic<unsigned> published(0);
+    std::atomic<unsigned> mismatches(0);
+    std::vector<std::thread> threads;
+    threads.emplace_back([&]()
+    {
+        Ast::type_id current = element;
+        for(unsigned n = 0; n < depth; n++)
+        {
+            current = Ast::array_type(current);
+            ids[n].store(current);
+            published.store(n + 1);
+        }
+    });
+    for(unsigned t = 0; t < readers; t++)
+    {
+        threads.emplace_back([&]()
+        {
+            // Boost.Test checks are not thread safe, so count the failures
+            unsigned seen = 0;
+            while(seen < depth)
+            {
+                unsigned available = published.load();
+                for(; seen < available; seen++)
+                {
+                    Ast::type_id expected_element = seen == 0 ? element : ids[seen - 1].load();
+                    if(Ast::type_id_kind(ids[seen]) != Ast::type_kind_array || Ast::array_element(ids[seen]) != expected_element)
+                    {
+                        mismatches++;
+                    }
+                }
+            }
+        });
+    }
+    for(auto& thread : threads)
+    {
+        thread.join();
+    }
+    BOOST_CHECK_EQUAL(mismatches.load(), 0u);
+    // And interning them again gives the same ids
+    BOOST_CHECK_EQUAL(Ast::array_type(ids[depth - 1]), Ast::array_type(ids[depth - 1]));
+    BOOST_CHECK_EQUAL(Ast::array_type(element), ids[0].load());
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_array_types)
+{
+    // Threads racing to intern the same arrays agree on their ids
+    const unsigned threads = 4;
+    const unsigned depth = 5000;
+    std::vector<std::vector<Ast::type_id>> ids(threads, std::vector<Ast::type_id>(depth));
+    std::vector<std::thread> workers;
+    for(unsigned t = 0; t < threads; t++)
+    {
+        workers.emplace_back([&, t]()
+        {
+            Ast::type_id type = Ast::named_type(type_name("Racing"));
+            for(unsigned n = 0; n < depth; n++)
+            {
+                type = ids[t][n] = Ast::array_type(type);
+            }
+        });
+    }
+    for(auto& worker : workers)
+    {
+        worker.join();
+    }
+    for(unsigned t = 1; t < threads; t++)
+    {
+        BOOST_CHECK(ids[t] == ids[0]);
+    }
+    BOOST_CHECK_EQUAL(Ast::array_element(ids[0][1]), ids[0][0]);
+}
+
+BOOST_AUTO_TEST_CASE(truncation_drops_the_later_types)
+{
+    Ast::type_id kept = Ast::array_type(Ast::int_type_id);
+    std::size_t count = Ast::type_count();
+    Ast::type_id dropped = Ast::array_type(kept);
+    BOOST_CHECK_EQUAL(Ast::type_count(), count + 1);
+
+    Ast::truncate_types(count);
+    BOOST_CHECK_EQUAL(Ast::type_count(), count);
+    BOOST_CHECK_EQUAL(Ast::array_type(Ast::int_type_id), kept);
+    // Interned anew, under the id handed out again
+    Ast::type_id again = Ast::array_type(Ast::char_type_id);
+    BOOST_CHECK_EQUAL(again, dropped);
+    BOOST_CHECK_EQUAL(Ast::type_id_to_string(again), "char[]");
+    BOOST_CHECK(Ast::array_type(kept) != again);
+}
@@ -0,0 +1,96 @@
+#define BOOST_TEST_MODULE view
+#include <boost/test/included/unit_test.hpp>
+
+#include "view.hpp"
+
+#include <list>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    // Counts its copies, which views must not make
+    struct counted
+    {
+        static int copies;
+
+        int value;
+
+        explicit counted(int value)
+            : value(value)
+        {
+        }
+
+        counted(counted const& other)
+            : value(other.value)
+        {
+            copies++;
+        }
+    };
+
+    int counted::copies = 0;
+}
+
+BOOST_AUTO_TEST_CASE(map_and_join)
+{
+    std::list<int> numbers{ 1, 2, 3 };
+    std::ostringstream out;
+    View::join(out, View::map(numbers, [](int n) { return n * n; }), ", ");
+    BOOST_CHECK_EQUAL(out.str(), "1, 4, 9");
+
+    std::ostringstream empty;
+    View::join(empty, View::map(std::list<int>(), [](int n) { return n; }), ", ");
+    BOOST_CHECK_EQUAL(empty.str(), "");
+}
+
+BOOST_AUTO_TEST_CASE(filter_skips_without_copying)
+{
+    std::list<counted> elements;
+    for(int n = 0; n < 6; n++)
+    {
+        elements.emplace_back(n);
+    }
+    counted::copies = 0;
+    std::vector<counted const*> odd;
+    for(counted const& element : View::filter(elements, [](counted const& c) { return c.value % 2 == 1; }))
+    {
+        odd.push_back(&element);
+    }
+    BOOST_CHECK_EQUAL(counted::copies, 0);
+    BOOST_REQUIRE_EQUAL(odd.size(), 3u);
+    BOOST_CHECK(odd[0] == &*std::next(elements.begin()));
+    BOOST_CHECK_EQUAL(odd[2]->value, 5);
+
+    // Nothing, and everything, satisfying the predicate
+    BOOST_CHECK(View::filter(elements, [](counted const&) { return false; }).empty());
+    int all = 0;
+    for(counted const& element : View::filter(elements, [](counted const&) { return true; }))
+    {
+        all += element.value;
+    }
+    BOOST_CHECK_EQUAL(all, 15);
+}
+
+BOOST_AUTO_TEST_CASE(enumerate_pairs_indices)
+{
+    std::list<std::string> names{ "a", "b", "c" };
+    std::vector<std::size_t> indices;
+    std::string joined;
+    for(auto element : View::enumerate(names))
+    {
+        indices.push_back(element.first);
+        joined += element.second;
+    }
+    BOOST_CHECK(indices == (std::vector<std::size_t>{ 0, 1, 2 }));
+    BOOST_CHECK_EQUAL(joined, "abc");
+
+    // Composed; the indices are those of the underlying list
+    std::vector<std::size_t> kept;
+    for(auto element : View::filter(View::enumerate(names), [](std::pair<std::size_t, std::string const&> e) { return e.second != "b"; }))
+    {
+        kept.push_back(element.first);
+    }
+    BOOST_CHECK(kept == (std::vector<std::size_t>{ 0, 2 }));
+}
@@ -0,0 +1,32 @@
+#define BOOST_TEST_MODULE weeder
+#include <boost/test/included/unit_test.hpp>
+
+#include "ast.hpp"
+#include "Error.hpp"
+#include "weeder.hpp"
+
+namespace
+{
+    Ast::expression_integer_constant literal(std::string digits)
+    {
+        Ast::expression_integer_constant constant;
+        constant.value = std::move(digits);
+        return constant;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(literals_fitting_an_int_pass)
+{
+    BOOST_CHECK_NO_THROW(Weeder::check_integer_literal(literal("0"), false));
+    BOOST_CHECK_NO_THROW(Weeder::check_integer_literal(literal("2147483647"), false));
+    BOOST_CHECK_NO_THROW(Weeder::check_integer_literal(literal("0002147483647"), false));
+    BOOST_CHECK_NO_THROW(Weeder::check_integer_literal(literal("2147483648"), true));
+}
+
+BOOST_AUTO_TEST_CASE(literals_out_of_range_are_rejected)
+{
+    // 2147483648 only fits once negated
+    BOOST_CHECK_THROW(Weeder::check_integer_literal(literal("2147483648"), false), Error::Weeding_Error);
+    BOOST_CHECK_THROW(Weeder::check_integer_literal(literal("2147483649"), true), Error::Weeding_Error);
+    BOOST_CHECK_THROW(Weeder::check_integer_literal(literal("10000000000"), false), Error::Weeding_Error);
+}
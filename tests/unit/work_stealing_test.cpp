@@ -0,0 +1,95 @@
+#define BOOST_TEST_MODULE work_stealing
+#include <boost/test/included/unit_test.hpp>
+
+#include "work_stealing.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_CASE(every_task_runs_once)
+{
+    std::vector<std::atomic<unsigned>> runs(1000);
+    std::vector<std::function<void()>> tasks;
+    for(std::size_t n = 0; n < runs.size(); n++)
+    {
+        runs[n].store(0);
+        tasks.push_back([&runs, n]() { runs[n]++; });
+    }
+    Parallel::run_tasks(tasks, 4);
+    for(auto& count : runs)
+    {
+        BOOST_CHECK_EQUAL(count.load(), 1u);
+    }
+    // Without any tasks, or threads to spare
+    Parallel::run_tasks(std::vector<std::function<void()>>(), 4);
+    Parallel::run_tasks(tasks, 1);
+    BOOST_CHECK_EQUAL(runs.front().load(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(idle_threads_steal)
+{
+    // Two threads, dealt tasks 0 and 1, and 2 and 3. Task 0 blocks until the
+    // others are done, so task 1, behind it in the same share, must be stolen
+    std::mutex lock;
+    std::condition_variable done;
+    unsigned finished = 0;
+    bool waited = false;
+    std::vector<std::function<void()>> tasks;
+    tasks.push_back([&]()
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        waited = done.wait_for(guard, std::chrono::seconds(10), [&]() { return finished == 3; });
+    });
+    for(unsigned n = 1; n < 4; n++)
+    {
+        tasks.push_back([&]()
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            finished++;
+            done.notify_all();
+        });
+    }
+    Parallel::run_tasks(tasks, 2);
+    BOOST_CHECK(waited);
+}
+
+BOOST_AUTO_TEST_CASE(first_error_by_index_is_rethrown)
+{
+    // Task 3 fails first, yet the error of task 1 is the one rethrown, and
+    // the remaining tasks still run
+    std::atomic<unsigned> ran(0);
+    std::vector<std::function<void()>> tasks;
+    for(unsigned n = 0; n < 8; n++)
+    {
+        tasks.push_back([&ran, n]()
+        {
+            if(n == 1)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                throw std::runtime_error("task 1");
+            }
+            if(n == 3)
+            {
+                throw std::runtime_error("task 3");
+            }
+            ran++;
+        });
+    }
+    std::string message;
+    try
+    {
+        Parallel::run_tasks(tasks, 4);
+    }
+    catch(std::runtime_error& e)
+    {
+        message = e.what();
+    }
+    BOOST_CHECK_EQUAL(message, "task 1");
+    BOOST_CHECK_EQUAL(ran.load(), 6u);
+}